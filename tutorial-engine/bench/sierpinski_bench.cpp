@@ -0,0 +1,69 @@
+// one sierpinski subdivision of 1k to 1M input vertices, no window or device
+// needed. results go to the json path given as the first argument,
+// sierpinski_bench.json by default
+#include "sierpinski.hpp"
+
+#include "bench_json.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+	constexpr std::chrono::milliseconds MIN_TIME{250};
+	constexpr size_t SIZES[] = {1002, 10002, 100002, 1000002};
+}
+
+int main(int argc, char *argv[])
+{
+	std::string outputPath = argc > 1 ? argv[1] : "sierpinski_bench.json";
+	std::vector<vkr::bench::BenchResult> results;
+
+	for (size_t size : SIZES)
+	{
+		// sizes are whole triangles
+		std::vector<vkr::Model::Vertex> vertices;
+		vertices.reserve(size);
+		for (size_t i = 0; i < size / 3; i++)
+		{
+			float x = float(i % 1000) * 0.001f;
+			vertices.emplace_back(glm::vec2{x, 0.0f}, glm::vec3{1.0f, 0.0f, 0.0f});
+			vertices.emplace_back(glm::vec2{x + 0.001f, 0.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+			vertices.emplace_back(glm::vec2{x, 0.001f}, glm::vec3{0.0f, 0.0f, 1.0f});
+		}
+
+		// one untimed warm up, then repeat until MIN_TIME has passed
+		size_t subdivided = vkr::sierpinski(vertices).size();
+		Clock::duration total{};
+		size_t iterations = 0;
+		while (total < MIN_TIME)
+		{
+			auto start = Clock::now();
+			subdivided += vkr::sierpinski(vertices).size();
+			total += Clock::now() - start;
+			iterations++;
+		}
+
+		double ns = std::chrono::duration<double, std::nano>(total).count() / iterations;
+		vkr::bench::BenchResult result;
+		result.name = "sierpinski/" + std::to_string(size);
+		result.size = size;
+		result.iterations = iterations;
+		result.nsPerIteration = ns;
+		result.itemsPerSecond = size * 1e9 / ns;
+		results.push_back(result);
+		std::cout << "sierpinski/" << size << ": " << ns / 1e6 << "ms, "
+				  << size * 1e3 / ns << "M vertices/s (" << iterations << " iterations, "
+				  << subdivided << " vertices out)" << std::endl;
+	}
+
+	if (!vkr::bench::write_json(outputPath, results))
+	{
+		std::cerr << "Could not write " << outputPath << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -4,8 +4,11 @@
 #include "window.hpp"
 #include "swapchain.hpp"
 #include "model.hpp"
+#include "frame_pacer.hpp"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace vkr
@@ -27,6 +30,7 @@ namespace vkr
 		void loadModels();
 		Window window{WIDTH, HEIGHT, "Hello Vulkan!"};
 		Device device{window};
+		ShaderModuleCache shaderModules{device};
 		std::unique_ptr<Pipeline> pipeline;
 		std::unique_ptr<SwapChain> swapchain;
 
@@ -41,5 +45,25 @@ namespace vkr
 		void drawFrame();
 		void recreateSwapChain();
 		void recordCommandBuffer(int imageIndex);
+
+		// frame pacing
+		// limiter, then latency wait, then input, so frames are built from the
+		// freshest input the gpu allows
+		FramePacer framePacer;
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+		// frames the cpu may run ahead of the gpu when polling input
+		uint32_t maxFrameLatency = SwapChain::MAX_FRAMES_IN_FLIGHT;
+		uint64_t frameCount = 0;
+		FramePacer::Clock::time_point inputSampleTime;
+		// per frame in flight, pending until its fence is seen signaled
+		std::array<FramePacer::Clock::time_point, SwapChain::MAX_FRAMES_IN_FLIGHT> frameInputTimes{};
+		std::array<bool, SwapChain::MAX_FRAMES_IN_FLIGHT> latencyPending{};
+		std::unordered_map<int, bool> previousKeyStates;
+		void waitForFrameLatency();
+		// input to gpu completion, an upper bound that excludes scanout
+		void collectFrameLatencies();
+		bool keyReleased(int key);
+		void handlePacingKeys();
+		void logFramePacing();
 	};
 }
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace vkr
+{
+	struct FramePercentiles
+	{
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+		size_t samples = 0;
+	};
+
+	// cpu side frame limiter plus rolling frame time and latency statistics
+	// sleeps until shortly before the deadline and spins the rest, os sleeps
+	// routinely overshoot by a millisecond or more
+	class FramePacer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+		static constexpr size_t HISTORY_SIZE = 4096;
+
+		// 0 disables the limiter
+		void setTargetFps(double fps);
+		double targetFps() const { return targetFramesPerSecond; }
+		// deadlines advance by whole periods, a very late frame restarts the
+		// cadence instead of letting the next frames catch up
+		void waitForNextFrame();
+
+		// once per presented frame, the time between calls is the frame time
+		void recordFrame(Clock::time_point now = Clock::now());
+		void recordLatency(double ms);
+
+		FramePercentiles frameTimePercentiles() const;
+		FramePercentiles latencyPercentiles() const;
+		void resetStats();
+		// one row of percentiles per metric, in ms
+		bool writeCsv(const std::string &path) const;
+
+	private:
+		static void pushSample(std::vector<double> &history, size_t &next, double sample);
+		static FramePercentiles percentiles(std::vector<double> samples);
+
+		double targetFramesPerSecond = 0.0;
+		Clock::duration period{};
+		Clock::time_point deadline{};
+		// remaining time below which the limiter stops sleeping and spins
+		Clock::duration spinThreshold = std::chrono::microseconds(1500);
+
+		Clock::time_point lastFrame{};
+		// ring buffers of the last HISTORY_SIZE samples
+		std::vector<double> frameTimesMs;
+		std::vector<double> latenciesMs;
+		size_t frameTimeNext = 0;
+		size_t latencyNext = 0;
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "device.hpp"
@@ -25,11 +26,33 @@ namespace vkr
 		uint32_t subpass = 0;
 	};
 
+	// shader modules by spir-v file path, read and created once and shared by
+	// every pipeline using them, including ones rebuilt after a resize
+	class ShaderModuleCache
+	{
+	public:
+		ShaderModuleCache(Device &device) : device(device) {}
+		~ShaderModuleCache();
+
+		ShaderModuleCache(const ShaderModuleCache &) = delete;
+		ShaderModuleCache &operator=(const ShaderModuleCache &) = delete;
+
+		VkShaderModule get(const std::string &fp);
+
+	private:
+		static std::vector<char> readFile(const std::string &fp);
+
+		Device &device; // will always outlive the cache
+		std::unordered_map<std::string, VkShaderModule> modules;
+	};
+
 	class Pipeline
 	{
 	public:
+		// the modules belong to shaderModules
 		Pipeline(
 			Device &device,
+			ShaderModuleCache &shaderModules,
 			const std::string &vertFP,
 			const std::string &fragFP,
 			const PipelineConfigInfo &configInfo);
@@ -42,15 +65,12 @@ namespace vkr
 		static void defaultPipelineConfigInfo(PipelineConfigInfo &configInfo);
 
 	private:
-		static std::vector<char> readFile(const std::string &fp);
-		void createGraphicsPipeline(const std::string &vertFP,
+		void createGraphicsPipeline(ShaderModuleCache &shaderModules,
+									const std::string &vertFP,
 									const std::string &fragFP,
 									const PipelineConfigInfo &configInfo);
 
-		void createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule);
 		Device &device; // will always outlive pipeline
 		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
 	};
 } // namespace vkr
\ No newline at end of file
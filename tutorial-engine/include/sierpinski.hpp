@@ -0,0 +1,12 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <vector>
+
+namespace vkr
+{
+	// splits every triangle into three at its edge midpoints, vertices is a
+	// triangle list
+	std::vector<Model::Vertex> sierpinski(std::vector<Model::Vertex> vertices);
+}
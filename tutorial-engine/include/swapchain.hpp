@@ -18,8 +18,11 @@ namespace vkr
     public:
         static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-        SwapChain(Device &deviceRef, VkExtent2D windowExtent);
-        SwapChain(Device &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
+        // falls back to fifo when the preferred present mode is unsupported
+        SwapChain(Device &deviceRef, VkExtent2D windowExtent,
+                  VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR);
+        SwapChain(Device &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous,
+                  VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR);
         ~SwapChain();
 
         SwapChain(const SwapChain &) = delete;
@@ -39,6 +42,20 @@ namespace vkr
             return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
         }
         VkFormat findDepthFormat();
+        // render passes with the same attachment formats are compatible, so
+        // pipelines built against the other chain's pass still work with ours
+        bool compareSwapFormats(const SwapChain &other) const
+        {
+            return swapChainImageFormat == other.swapChainImageFormat &&
+                   swapChainDepthFormat == other.swapChainDepthFormat;
+        }
+        VkPresentModeKHR getPresentMode() { return presentMode; }
+        static const char *presentModeName(VkPresentModeKHR mode);
+
+        // frame in flight slot the next acquire and submit use
+        size_t getCurrentFrame() { return currentFrame; }
+        void waitForFrame(size_t frameIndex);
+        bool isFrameComplete(size_t frameIndex);
 
         VkResult acquireNextImage(uint32_t *imageIndex);
         VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
@@ -60,6 +77,7 @@ namespace vkr
         VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
         VkFormat swapChainImageFormat;
+        VkFormat swapChainDepthFormat;
         VkExtent2D swapChainExtent;
 
         std::vector<VkFramebuffer> swapChainFramebuffers;
@@ -73,6 +91,8 @@ namespace vkr
 
         Device &device;
         VkExtent2D windowExtent;
+        VkPresentModeKHR preferredPresentMode;
+        VkPresentModeKHR presentMode;
 
         VkSwapchainKHR swapChain;
         std::shared_ptr<SwapChain> oldSwapchain;
@@ -23,6 +23,7 @@ namespace vkr
 		}
 		bool wasWindowResize() { return frameBufferResized; }
 		void resetWindowResizedFlag() { frameBufferResized = false; }
+		bool isKeyPressed(int key) { return glfwGetKey(window, key) == GLFW_PRESS; }
 
 		void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface);
 
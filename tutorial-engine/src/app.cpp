@@ -1,5 +1,7 @@
 #include "app.hpp"
+#include "sierpinski.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 namespace vkr
@@ -21,41 +23,119 @@ namespace vkr
 	{
 		while (!window.shouldClose())
 		{
+			framePacer.waitForNextFrame();
+			waitForFrameLatency();
+			inputSampleTime = FramePacer::Clock::now();
+
 			glfwPollEvents();
+			handlePacingKeys();
 			drawFrame();
+
+			if (++frameCount % 500 == 0)
+			{
+				logFramePacing();
+			}
 		}
 
 		vkDeviceWaitIdle(device.device());
+		collectFrameLatencies();
+		logFramePacing();
+		if (!framePacer.writeCsv("frame_pacing.csv"))
+		{
+			std::cout << "Could not write frame_pacing.csv" << std::endl;
+		}
 	}
 
-	std::vector<Model::Vertex> sierpinski(std::vector<Model::Vertex> vertices)
+	void App::waitForFrameLatency()
 	{
-		// demonstration, not very efficient (need inplace for that)
-		std::vector<Model::Vertex> newVertices;
-		// assume vertices is multiple of 3
-		for (size_t i = 0; i < vertices.size() / 3; i++)
+		uint32_t latency = std::clamp<uint32_t>(maxFrameLatency, 1, SwapChain::MAX_FRAMES_IN_FLIGHT);
+		// acquireNextImage waits for the oldest frame anyway
+		if (latency >= SwapChain::MAX_FRAMES_IN_FLIGHT)
 		{
-			auto v0 = vertices[3 * i];
-			auto v1 = vertices[3 * i + 1];
-			auto v2 = vertices[3 * i + 2];
+			return;
+		}
 
-			auto v01 = (v0 + v1) * 0.5f;
-			auto v12 = (v1 + v2) * 0.5f;
-			auto v20 = (v2 + v0) * 0.5f;
+		size_t frameIndex = (swapchain->getCurrentFrame() + SwapChain::MAX_FRAMES_IN_FLIGHT - latency) %
+							SwapChain::MAX_FRAMES_IN_FLIGHT;
+		swapchain->waitForFrame(frameIndex);
+		collectFrameLatencies();
+	}
 
-			newVertices.push_back(v0);
-			newVertices.push_back(v01);
-			newVertices.push_back(v20);
+	void App::collectFrameLatencies()
+	{
+		for (size_t i = 0; i < latencyPending.size(); i++)
+		{
+			if (!latencyPending[i] || !swapchain->isFrameComplete(i))
+			{
+				continue;
+			}
+			latencyPending[i] = false;
+			framePacer.recordLatency(
+				std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - frameInputTimes[i]).count());
+		}
+	}
 
-			newVertices.push_back(v01);
-			newVertices.push_back(v1);
-			newVertices.push_back(v12);
+	bool App::keyReleased(int key)
+	{
+		bool pressed = window.isKeyPressed(key);
+		bool released = previousKeyStates[key] && !pressed;
+		previousKeyStates[key] = pressed;
+		return released;
+	}
 
-			newVertices.push_back(v20);
-			newVertices.push_back(v12);
-			newVertices.push_back(v2);
+	void App::handlePacingKeys()
+	{
+		const std::array<std::pair<int, VkPresentModeKHR>, 4> presentModeKeys{{
+			{GLFW_KEY_1, VK_PRESENT_MODE_FIFO_KHR},
+			{GLFW_KEY_2, VK_PRESENT_MODE_FIFO_RELAXED_KHR},
+			{GLFW_KEY_3, VK_PRESENT_MODE_MAILBOX_KHR},
+			{GLFW_KEY_4, VK_PRESENT_MODE_IMMEDIATE_KHR},
+		}};
+		for (const auto &[key, mode] : presentModeKeys)
+		{
+			if (keyReleased(key))
+			{
+				presentMode = mode;
+				recreateSwapChain();
+				framePacer.resetStats();
+			}
+		}
+
+		if (keyReleased(GLFW_KEY_L))
+		{
+			// unlimited and a few common refresh rates
+			const std::array<double, 4> limits{0.0, 30.0, 60.0, 144.0};
+			auto current = std::find(limits.begin(), limits.end(), framePacer.targetFps());
+			size_t next = current == limits.end() ? 0 : (current - limits.begin() + 1) % limits.size();
+			framePacer.setTargetFps(limits[next]);
+			framePacer.resetStats();
+			std::cout << "Frame limit: " << limits[next] << " fps" << std::endl;
+		}
+
+		if (keyReleased(GLFW_KEY_K))
+		{
+			maxFrameLatency = maxFrameLatency % SwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+			framePacer.resetStats();
+			std::cout << "Max frame latency: " << maxFrameLatency << std::endl;
+		}
+	}
+
+	void App::logFramePacing()
+	{
+		auto frameTimes = framePacer.frameTimePercentiles();
+		auto latencies = framePacer.latencyPercentiles();
+		if (frameTimes.samples == 0)
+		{
+			return;
 		}
-		return newVertices;
+
+		std::cout << "Frame time over " << frameTimes.samples << " frames: p50 " << frameTimes.p50
+				  << "ms, p95 " << frameTimes.p95 << "ms, p99 " << frameTimes.p99 << "ms, max "
+				  << frameTimes.max << "ms" << std::endl;
+		std::cout << "Input to gpu completion latency: p50 " << latencies.p50 << "ms, p99 "
+				  << latencies.p99 << "ms (" << SwapChain::presentModeName(swapchain->getPresentMode())
+				  << ", limit " << framePacer.targetFps() << " fps, max frame latency "
+				  << maxFrameLatency << ")" << std::endl;
 	}
 
 	void App::loadModels()
@@ -103,6 +183,7 @@ namespace vkr
 		pipelineConfig.pipelineLayout = pipelineLayout;
 		pipeline = std::make_unique<Pipeline>(
 			device,
+			shaderModules,
 			"shaders/simple_shader.vert.spv",
 			"shaders/simple_shader.frag.spv",
 			pipelineConfig);
@@ -118,13 +199,18 @@ namespace vkr
 		}
 		vkDeviceWaitIdle(device.device());
 
+		// the new chain has new fences, pending frames are already done
+		latencyPending.fill(false);
+		bool renderPassCompatible = false;
 		if (swapchain == nullptr)
 		{
-			swapchain = std::make_unique<SwapChain>(device, extent);
+			swapchain = std::make_unique<SwapChain>(device, extent, presentMode);
 		}
 		else
 		{
-			swapchain = std::make_unique<SwapChain>(device, extent, std::move(swapchain));
+			std::shared_ptr<SwapChain> oldSwapChain = std::move(swapchain);
+			swapchain = std::make_unique<SwapChain>(device, extent, oldSwapChain, presentMode);
+			renderPassCompatible = oldSwapChain->compareSwapFormats(*swapchain);
 			if (swapchain->imageCount() != commandBuffers.size())
 			{
 				freeCommandBuffers();
@@ -132,8 +218,13 @@ namespace vkr
 			}
 		}
 
-		// TODO: if render pass compatible do not recreate
-		createPipeline();
+		// viewport and scissor are dynamic, so a pipeline only depends on the
+		// render pass, and any compatible one will do. a resize usually keeps
+		// the formats and skips the pipeline compile entirely
+		if (pipeline == nullptr || !renderPassCompatible)
+		{
+			createPipeline();
+		}
 	}
 
 	void App::createCommandBuffers()
@@ -228,8 +319,15 @@ namespace vkr
 			throw std::runtime_error("failed to acquire swap chain image!");
 		}
 
+		// the acquire waited on this slot's fence and the submit resets it
+		collectFrameLatencies();
+		size_t frameIndex = swapchain->getCurrentFrame();
+
 		recordCommandBuffer(imageIndex);
 		result = swapchain->submitCommandBuffers(&commandBuffers[imageIndex], &imageIndex);
+		frameInputTimes[frameIndex] = inputSampleTime;
+		latencyPending[frameIndex] = true;
+		framePacer.recordFrame();
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.wasWindowResize())
 		{
 			window.resetWindowResizedFlag();
@@ -0,0 +1,140 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+namespace vkr
+{
+	void FramePacer::setTargetFps(double fps)
+	{
+		targetFramesPerSecond = std::max(fps, 0.0);
+		period = Clock::duration{};
+		if (targetFramesPerSecond > 0.0)
+		{
+			period = std::chrono::duration_cast<Clock::duration>(
+				std::chrono::duration<double>(1.0 / targetFramesPerSecond));
+		}
+		deadline = Clock::time_point{};
+	}
+
+	void FramePacer::waitForNextFrame()
+	{
+		if (targetFramesPerSecond <= 0.0)
+		{
+			return;
+		}
+
+		auto now = Clock::now();
+		if (deadline == Clock::time_point{} || now - deadline >= period)
+		{
+			deadline = now + period;
+			return;
+		}
+		if (now >= deadline)
+		{
+			deadline += period;
+			return;
+		}
+
+		auto remaining = deadline - now;
+		if (remaining > spinThreshold)
+		{
+			std::this_thread::sleep_for(remaining - spinThreshold);
+		}
+		while (Clock::now() < deadline)
+		{
+			// busy wait, costs one core for at most spinThreshold
+		}
+		deadline += period;
+	}
+
+	void FramePacer::recordFrame(Clock::time_point now)
+	{
+		if (lastFrame != Clock::time_point{})
+		{
+			pushSample(frameTimesMs, frameTimeNext,
+					   std::chrono::duration<double, std::milli>(now - lastFrame).count());
+		}
+		lastFrame = now;
+	}
+
+	void FramePacer::recordLatency(double ms)
+	{
+		pushSample(latenciesMs, latencyNext, ms);
+	}
+
+	FramePercentiles FramePacer::frameTimePercentiles() const
+	{
+		return percentiles(frameTimesMs);
+	}
+
+	FramePercentiles FramePacer::latencyPercentiles() const
+	{
+		return percentiles(latenciesMs);
+	}
+
+	void FramePacer::resetStats()
+	{
+		frameTimesMs.clear();
+		latenciesMs.clear();
+		frameTimeNext = 0;
+		latencyNext = 0;
+		lastFrame = Clock::time_point{};
+	}
+
+	bool FramePacer::writeCsv(const std::string &path) const
+	{
+		std::ofstream file(path);
+		if (!file)
+		{
+			return false;
+		}
+		file << "metric,samples,p50_ms,p95_ms,p99_ms,max_ms\n";
+		auto writeRow = [&](const char *name, const FramePercentiles &p)
+		{
+			file << name << "," << p.samples << "," << p.p50 << "," << p.p95
+				 << "," << p.p99 << "," << p.max << "\n";
+		};
+		writeRow("frame_time", frameTimePercentiles());
+		writeRow("input_latency", latencyPercentiles());
+		return file.good();
+	}
+
+	void FramePacer::pushSample(std::vector<double> &history, size_t &next, double sample)
+	{
+		if (history.size() < HISTORY_SIZE)
+		{
+			history.push_back(sample);
+		}
+		else
+		{
+			history[next] = sample;
+		}
+		next = (next + 1) % HISTORY_SIZE;
+	}
+
+	FramePercentiles FramePacer::percentiles(std::vector<double> samples)
+	{
+		FramePercentiles result;
+		result.samples = samples.size();
+		if (samples.empty())
+		{
+			return result;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		// nearest rank
+		auto rank = [&](double p)
+		{
+			size_t index = static_cast<size_t>(std::ceil(p * samples.size()));
+			return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+		};
+		result.p50 = rank(0.50);
+		result.p95 = rank(0.95);
+		result.p99 = rank(0.99);
+		result.max = samples.back();
+		return result;
+	}
+}
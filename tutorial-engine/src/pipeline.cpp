@@ -9,19 +9,51 @@
 
 namespace vkr
 {
+	ShaderModuleCache::~ShaderModuleCache()
+	{
+		for (auto &[fp, module] : modules)
+		{
+			vkDestroyShaderModule(device.device(), module, nullptr);
+		}
+	}
+
+	VkShaderModule ShaderModuleCache::get(const std::string &fp)
+	{
+		auto it = modules.find(fp);
+		if (it != modules.end())
+		{
+			return it->second;
+		}
+
+		auto code = readFile(fp);
+		std::cout << "Shader " << fp << " code size: " << code.size() << std::endl;
+
+		VkShaderModuleCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = code.size();
+		createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data()); // would not be valid with c array
+
+		VkShaderModule shaderModule;
+		if (vkCreateShaderModule(device.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create shader module");
+		}
+		modules.emplace(fp, shaderModule);
+		return shaderModule;
+	}
+
 	Pipeline::Pipeline(
 		Device &device,
+		ShaderModuleCache &shaderModules,
 		const std::string &vertFP,
 		const std::string &fragFP,
 		const PipelineConfigInfo &configInfo) : device(device)
 	{
-		createGraphicsPipeline(vertFP, fragFP, configInfo);
+		createGraphicsPipeline(shaderModules, vertFP, fragFP, configInfo);
 	}
 
 	Pipeline::~Pipeline()
 	{
-		vkDestroyShaderModule(device.device(), vertShaderModule, nullptr);
-		vkDestroyShaderModule(device.device(), fragShaderModule, nullptr);
 		vkDestroyPipeline(device.device(), graphicsPipeline, nullptr);
 	}
 
@@ -30,7 +62,7 @@ namespace vkr
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 	}
 
-	std::vector<char> Pipeline::readFile(const std::string &fp)
+	std::vector<char> ShaderModuleCache::readFile(const std::string &fp)
 	{
 		std::ifstream file{fp, std::ios::ate | std::ios::binary};
 
@@ -50,7 +82,7 @@ namespace vkr
 		return buffer;
 	}
 
-	void Pipeline::createGraphicsPipeline(const std::string &vertFP, const std::string &fragFP, const PipelineConfigInfo &configInfo)
+	void Pipeline::createGraphicsPipeline(ShaderModuleCache &shaderModules, const std::string &vertFP, const std::string &fragFP, const PipelineConfigInfo &configInfo)
 	{
 
 		assert(configInfo.pipelineLayout != VK_NULL_HANDLE &&
@@ -58,14 +90,8 @@ namespace vkr
 		assert(configInfo.renderPass != VK_NULL_HANDLE &&
 			   "Cannot create graphics pipeline:: no renderPass provided in configInfo");
 
-		auto vertCode = readFile(vertFP);
-		auto fragCode = readFile(fragFP);
-
-		std::cout << "Vertex Shader Code Size: " << vertCode.size() << std::endl;
-		std::cout << "Fragment Shader Code Size: " << fragCode.size() << std::endl;
-
-		createShaderModule(vertCode, &vertShaderModule);
-		createShaderModule(fragCode, &fragShaderModule);
+		VkShaderModule vertShaderModule = shaderModules.get(vertFP);
+		VkShaderModule fragShaderModule = shaderModules.get(fragFP);
 
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -127,19 +153,6 @@ namespace vkr
 		}
 	}
 
-	void Pipeline::createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule)
-	{
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data()); // would not be valid with c array
-
-		if (vkCreateShaderModule(device.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create shader module");
-		}
-	}
-
 	void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo &configInfo)
 	{
 		// input assembler stage
@@ -12,14 +12,16 @@
 namespace vkr
 {
 
-    SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent)
-        : device{deviceRef}, windowExtent{extent}
+    SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent, VkPresentModeKHR preferredPresentMode)
+        : device{deviceRef}, windowExtent{extent}, preferredPresentMode{preferredPresentMode}
     {
         init();
     }
 
-    SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous)
-        : device{deviceRef}, windowExtent{extent}, oldSwapchain{previous}
+    SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous,
+                         VkPresentModeKHR preferredPresentMode)
+        : device{deviceRef}, windowExtent{extent}, preferredPresentMode{preferredPresentMode},
+          oldSwapchain{previous}
     {
         init();
 
@@ -94,6 +96,21 @@ namespace vkr
         return result;
     }
 
+    void SwapChain::waitForFrame(size_t frameIndex)
+    {
+        vkWaitForFences(
+            device.device(),
+            1,
+            &inFlightFences[frameIndex],
+            VK_TRUE,
+            std::numeric_limits<uint64_t>::max());
+    }
+
+    bool SwapChain::isFrameComplete(size_t frameIndex)
+    {
+        return vkGetFenceStatus(device.device(), inFlightFences[frameIndex]) == VK_SUCCESS;
+    }
+
     VkResult SwapChain::submitCommandBuffers(
         const VkCommandBuffer *buffers, uint32_t *imageIndex)
     {
@@ -151,7 +168,7 @@ namespace vkr
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
         // how sync with display is handled
-        VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+        presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
         VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
         uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -239,8 +256,9 @@ namespace vkr
 
     void SwapChain::createRenderPass()
     {
+        swapChainDepthFormat = findDepthFormat();
         VkAttachmentDescription depthAttachment{};
-        depthAttachment.format = findDepthFormat();
+        depthAttachment.format = swapChainDepthFormat;
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -330,7 +348,7 @@ namespace vkr
 
     void SwapChain::createDepthResources()
     {
-        VkFormat depthFormat = findDepthFormat();
+        VkFormat depthFormat = swapChainDepthFormat;
         VkExtent2D swapChainExtent = getSwapChainExtent();
 
         depthImages.resize(imageCount());
@@ -424,28 +442,39 @@ namespace vkr
     VkPresentModeKHR SwapChain::chooseSwapPresentMode(
         const std::vector<VkPresentModeKHR> &availablePresentModes)
     {
-        // mailbox vs fifo vs immediate
+        // mailbox vs fifo vs fifo relaxed vs immediate
         for (const auto &availablePresentMode : availablePresentModes)
         {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+            if (availablePresentMode == preferredPresentMode)
             {
-                std::cout << "Present mode: Mailbox" << std::endl;
+                std::cout << "Present mode: " << presentModeName(availablePresentMode) << std::endl;
                 return availablePresentMode;
             }
         }
 
-        // for (const auto &availablePresentMode : availablePresentModes) {
-        //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-        //     std::cout << "Present mode: Immediate" << std::endl;
-        //     return availablePresentMode;
-        //   }
-        // }
-
-        std::cout << "Present mode: V-Sync" << std::endl;
+        std::cout << "Present mode " << presentModeName(preferredPresentMode)
+                  << " not supported, falling back to V-Sync" << std::endl;
         // fifo is always supported
         return VK_PRESENT_MODE_FIFO_KHR;
     }
 
+    const char *SwapChain::presentModeName(VkPresentModeKHR mode)
+    {
+        switch (mode)
+        {
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "V-Sync";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "Relaxed V-Sync";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "Mailbox";
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "Immediate";
+        default:
+            return "Unknown";
+        }
+    }
+
     VkExtent2D SwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities)
     {
         if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
@@ -7,6 +7,12 @@ layout(location=3)in vec2 vTexCoord;
 
 layout(location=0)out vec3 outColor;
 layout(location=1)out vec2 texCoord;
+layout(location=2)flat out uint outMaterialIndex;
+// world space, only read by lit materials
+layout(location=3)out vec3 outNormal;
+
+// must match depth_only.vert bit for bit for the eEqual main pass
+invariant gl_Position;
 
 layout(set=0,binding=0)uniform CameraBuffer{
 	mat4 view;
@@ -16,6 +22,7 @@ layout(set=0,binding=0)uniform CameraBuffer{
 
 struct ObjectData{
 	mat4 model;
+	uvec4 material;// x is the material ssbo index
 };
 layout(std140,set=1,binding=0)readonly buffer ObjectBuffer{
 	ObjectData objects[];
@@ -40,4 +47,6 @@ void main(){
 	outColor=(vNormal+1)/2;
 	outColor=(outColor+objectLightingBuffer.objectLightings[gl_BaseInstance].objectAmbientLighting.xyz)/2;
 	texCoord=vTexCoord;
+	outMaterialIndex=objectBuffer.objects[gl_BaseInstance].material.x;
+	outNormal=mat3(modelMatrix)*vNormal;
 }
\ No newline at end of file
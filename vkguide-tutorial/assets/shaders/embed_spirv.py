@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# writes a c++ source with every spir-v binary as a constexpr uint32_t array
+# plus the name to blob table declared in include/embedded_shaders.hpp
+# usage: embed_spirv.py output.cpp input.spv...
+import os
+import re
+import struct
+import sys
+
+SPIRV_MAGIC = 0x07230203
+WORDS_PER_LINE = 8
+
+
+def main():
+    output_path, input_paths = sys.argv[1], sys.argv[2:]
+    shaders = []
+    for path in sorted(input_paths, key=os.path.basename):
+        with open(path, 'rb') as file:
+            data = file.read()
+        if len(data) % 4 != 0:
+            sys.exit(f'{path}: size is not a multiple of 4')
+        words = struct.unpack(f'<{len(data) // 4}I', data)
+        if not words or words[0] != SPIRV_MAGIC:
+            sys.exit(f'{path}: not little endian spir-v')
+        # mesh_single.frag.spv is looked up as mesh_single.frag
+        name = os.path.basename(path)[:-len('.spv')]
+        identifier = re.sub(r'\W', '_', name)
+        shaders.append((name, identifier, words))
+
+    lines = [
+        '// generated by assets/shaders/embed_spirv.py, do not edit',
+        '#include "embedded_shaders.hpp"',
+        '',
+        'namespace vkr {',
+        '',
+        'namespace {',
+        '',
+    ]
+    for name, identifier, words in shaders:
+        lines.append(f'constexpr uint32_t {identifier}[] = {{')
+        for i in range(0, len(words), WORDS_PER_LINE):
+            chunk = words[i:i + WORDS_PER_LINE]
+            lines.append('    ' + ', '.join(f'0x{word:08x}' for word in chunk)
+                         + ',')
+        lines.append('};')
+        lines.append('')
+    lines.append('} // namespace')
+    lines.append('')
+    lines.append('const EmbeddedShader EMBEDDED_SHADERS[] = {')
+    for name, identifier, words in shaders:
+        lines.append(f'    {{"{name}", {identifier}, {len(words)}}},')
+    lines.append('};')
+    lines.append('const size_t EMBEDDED_SHADER_COUNT = '
+                 f'{len(shaders)};')
+    lines.append('')
+    lines.append('} // namespace vkr')
+
+    with open(output_path, 'w') as file:
+        file.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
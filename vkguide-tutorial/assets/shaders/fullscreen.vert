@@ -0,0 +1,9 @@
+#version 460
+
+layout(location=0)out vec2 outUV;
+
+// one triangle covering the screen, no vertex buffer
+void main(){
+	outUV=vec2((gl_VertexIndex<<1)&2,gl_VertexIndex&2);
+	gl_Position=vec4(outUV*2.-1.,0.,1.);
+}
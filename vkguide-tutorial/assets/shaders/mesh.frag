@@ -0,0 +1,74 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+// every mesh material. features are specialization constants, so the driver
+// drops the code of the ones a pipeline doesn't use. the descriptor interface
+// of set 2 is picked at build time instead, since it decides the pipeline
+// layout:
+//   BINDLESS         material ssbo and the bindless texture array
+//   SINGLE_TEXTURE   one combined image sampler, base color is white
+//   neither          no set 2, untextured and white
+// keep the ids in sync with MaterialFeatureBits
+layout(constant_id = 0) const bool TEXTURED = false;
+layout(constant_id = 1) const bool LIT = false;
+layout(constant_id = 2) const bool FOG = false;
+layout(constant_id = 3) const bool VERTEX_COLOR = false;
+
+layout (location = 0) in vec3 inColor;
+layout (location = 1) in vec2 texCoord;
+layout (location = 2) flat in uint inMaterialIndex;
+layout (location = 3) in vec3 inNormal;
+//output write
+layout (location = 0) out vec4 outFragColor;
+
+#include "scene_data.glsl"
+
+#if defined(BINDLESS)
+struct MaterialData {
+	vec4 baseColor;
+	ivec4 textureIndices; // x diffuse, -1 if none
+};
+layout(std140, set = 2, binding = 0) readonly buffer MaterialBuffer {
+	MaterialData materials[];
+} materialBuffer;
+
+// bindless, sized at descriptor set allocation time
+layout(set = 2, binding = 1) uniform sampler2D textures[];
+#elif defined(SINGLE_TEXTURE)
+layout(set = 2, binding = 0) uniform sampler2D tex1;
+#endif
+
+void main()
+{
+	vec3 color = vec3(1.f);
+#if defined(BINDLESS)
+	MaterialData material = materialBuffer.materials[inMaterialIndex];
+	color = material.baseColor.xyz;
+	if (TEXTURED && material.textureIndices.x >= 0) {
+		// can differ within a draw once draws are instanced across materials
+		color *= texture(textures[nonuniformEXT(material.textureIndices.x)], texCoord).xyz;
+	}
+#elif defined(SINGLE_TEXTURE)
+	if (TEXTURED) {
+		color = texture(tex1, texCoord).xyz;
+	}
+#endif
+	if (VERTEX_COLOR) {
+		color *= inColor;
+	}
+	if (LIT) {
+		// ambient plus one directional sun, w is its power
+		float sun = max(dot(normalize(inNormal), -sceneData.sunlightDirection.xyz), 0.f);
+		color += sceneData.ambientColor.xyz
+			+ color * sceneData.sunlightColor.xyz * sun * sceneData.sunlightDirection.w;
+	}
+	if (FOG && sceneData.fogDistances.y > sceneData.fogDistances.x) {
+		// 1 / w is the view depth under a perspective projection
+		float depth = 1.f / gl_FragCoord.w;
+		float fog = clamp((depth - sceneData.fogDistances.x)
+			/ (sceneData.fogDistances.y - sceneData.fogDistances.x), 0.f, 1.f);
+		color = mix(color, sceneData.fogColor.xyz, pow(fog, max(sceneData.fogColor.w, 1.f)));
+	}
+	outFragColor = vec4(color, 1.0f);
+}
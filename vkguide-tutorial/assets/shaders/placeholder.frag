@@ -0,0 +1,9 @@
+#version 460
+
+// drawn by materials whose pipelines are still compiling
+layout (location = 0) out vec4 outFragColor;
+
+void main()
+{
+	outFragColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+}
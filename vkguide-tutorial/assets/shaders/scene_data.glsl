@@ -1,9 +1,4 @@
-#version 460
-
-layout (location = 0) in vec3 inColor;
-//output write
-layout (location = 0) out vec4 outFragColor;
-
+// set 0 binding 1 of every mesh shader, matches GPUSceneData
 layout(set = 0, binding = 1) uniform SceneData {
 	// stick to vec4 and mat4, avoid mixing dtypes, still need to pad
 	vec4 fogColor;     // w is for exponent
@@ -12,8 +7,3 @@ layout(set = 0, binding = 1) uniform SceneData {
 	vec4 sunlightDirection; // w for sun power
 	vec4 sunlightColor;
 } sceneData;
-
-void main()
-{
-	outFragColor = vec4(inColor + sceneData.ambientColor.xyz, 1.0f);
-}
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+# compares every glslang binary (name.unopt.spv) with its spirv-opt output
+# (name.spv): size, instruction counts and, when AMD's offline compiler rga
+# is on the PATH, the registers the driver compiler allocates. RGA_ASIC
+# picks the target, gfx1030 by default
+# usage: spirv_report.py --output report.csv input.spv...
+#        spirv_report.py --check [--baseline report.csv] input.spv...
+# --check prints the comparison and fails on missing pairs or invalid spir-v.
+# with a baseline, a report written by an earlier --output, it also fails
+# when an optimized shader grew past it by more than --tolerance. unoptimized
+# against optimized is never a failure, -O inlines every function, so more
+# instructions can be the win
+import argparse
+import csv
+import glob
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+SPIRV_MAGIC = 0x07230203
+HEADER_WORDS = 5
+OP_FUNCTION = 54
+OP_FUNCTION_END = 56
+# OpSourceContinued, OpSource, OpSourceExtension, OpName, OpMemberName,
+# OpString, OpLine, OpNoLine, OpModuleProcessed
+DEBUG_OPS = {2, 3, 4, 5, 6, 7, 8, 317, 330}
+UNOPT_SUFFIX = '.unopt.spv'
+RGA_STAGES = {'vert': '--vert', 'frag': '--frag', 'comp': '--comp'}
+
+COLUMNS = [
+    'shader',
+    'bytes', 'bytes_opt',
+    'instructions', 'instructions_opt',
+    'code_instructions', 'code_instructions_opt',
+    'debug_instructions', 'debug_instructions_opt',
+    'vgprs', 'vgprs_opt',
+    'sgprs', 'sgprs_opt',
+]
+
+
+def read_spirv(path):
+    with open(path, 'rb') as file:
+        data = file.read()
+    if len(data) % 4 != 0:
+        sys.exit(f'{path}: size is not a multiple of 4')
+    words = struct.unpack(f'<{len(data) // 4}I', data)
+    if len(words) < HEADER_WORDS or words[0] != SPIRV_MAGIC:
+        sys.exit(f'{path}: not little endian spir-v')
+    return words
+
+
+def count_instructions(path, words):
+    # code is what sits between OpFunction and OpFunctionEnd, the rest is
+    # declarations, decorations and types
+    total = code = debug = 0
+    in_function = False
+    i = HEADER_WORDS
+    while i < len(words):
+        word_count, opcode = words[i] >> 16, words[i] & 0xffff
+        if word_count == 0 or i + word_count > len(words):
+            sys.exit(f'{path}: truncated instruction at word {i}')
+        total += 1
+        if opcode in DEBUG_OPS:
+            debug += 1
+        if opcode == OP_FUNCTION:
+            in_function = True
+        if in_function:
+            code += 1
+        if opcode == OP_FUNCTION_END:
+            in_function = False
+        i += word_count
+    return total, code, debug
+
+
+def rga_registers(rga, name, path):
+    # (vgprs, sgprs) as strings, 'n/a' without rga or when it fails
+    stage = RGA_STAGES.get(name.rsplit('.', 1)[-1])
+    if rga is None or stage is None:
+        return 'n/a', 'n/a'
+    asic = os.environ.get('RGA_ASIC', 'gfx1030')
+    with tempfile.TemporaryDirectory() as directory:
+        analysis = os.path.join(directory, 'analysis.csv')
+        result = subprocess.run(
+            [rga, '-s', 'vk-spv-offline', '-c', asic, stage,
+             os.path.abspath(path), '-a', analysis],
+            cwd=directory, stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL)
+        # rga prefixes the file name with the asic and the stage
+        reports = glob.glob(os.path.join(directory, '*.csv'))
+        if result.returncode != 0 or not reports:
+            return 'n/a', 'n/a'
+        with open(reports[0], newline='') as file:
+            row = next(csv.DictReader(file), {})
+    return row.get('USED_VGPRs', 'n/a'), row.get('USED_SGPRs', 'n/a')
+
+
+def measure(rga, name, path):
+    words = read_spirv(path)
+    total, code, debug = count_instructions(path, words)
+    vgprs, sgprs = rga_registers(rga, name, path)
+    return {
+        'bytes': len(words) * 4,
+        'instructions': total,
+        'code_instructions': code,
+        'debug_instructions': debug,
+        'vgprs': vgprs,
+        'sgprs': sgprs,
+    }
+
+
+def pair_inputs(paths):
+    baselines, optimized = {}, {}
+    for path in paths:
+        name = os.path.basename(path)
+        if name.endswith(UNOPT_SUFFIX):
+            baselines[name[:-len(UNOPT_SUFFIX)]] = path
+        else:
+            optimized[name[:-len('.spv')]] = path
+    unpaired = sorted(set(baselines) ^ set(optimized))
+    if unpaired:
+        sys.exit(f'no unoptimized/optimized pair for {", ".join(unpaired)}')
+    return [(name, baselines[name], optimized[name])
+            for name in sorted(baselines)]
+
+
+def check_growth(rows, baseline_path, tolerance):
+    # optimized size and code against the recorded report, returns the
+    # regressions. shaders the baseline doesn't know are only reported
+    try:
+        with open(baseline_path, newline='') as file:
+            reader = csv.DictReader(file)
+            if reader.fieldnames != COLUMNS:
+                sys.exit(f'{baseline_path}: not a shader report')
+            baseline = {row['shader']: row for row in reader}
+    except OSError as error:
+        sys.exit(f'{baseline_path}: {error.strerror}')
+    regressions = []
+    for row in rows:
+        recorded = baseline.get(row['shader'])
+        if recorded is None:
+            print(f'{row["shader"]}: not in {baseline_path}')
+            continue
+        for key in ('bytes_opt', 'code_instructions_opt'):
+            try:
+                limit = int(recorded[key]) * (1. + tolerance)
+            except (KeyError, TypeError, ValueError):
+                sys.exit(f'{baseline_path}: no {key} for {row["shader"]}')
+            if row[key] > limit:
+                regressions.append(f'{row["shader"]}: {key} grew from '
+                                   f'{recorded[key]} to {row[key]}')
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--output', help='csv to write, stdout by default')
+    parser.add_argument('--check', action='store_true',
+                        help='print the comparison instead of a csv')
+    parser.add_argument('--baseline',
+                        help='report csv --check compares the sizes with')
+    parser.add_argument('--tolerance', type=float, default=0.02,
+                        help='growth over the baseline --check accepts, '
+                             '0.02 by default')
+    parser.add_argument('inputs', nargs='+')
+    args = parser.parse_args()
+
+    # registers only matter for the report, the check sticks to spir-v
+    rga = None if args.check else shutil.which('rga')
+    rows = []
+    for name, baseline_path, optimized_path in pair_inputs(args.inputs):
+        baseline = measure(rga, name, baseline_path)
+        optimized = measure(rga, name, optimized_path)
+        row = {'shader': name}
+        for key in baseline:
+            row[key] = baseline[key]
+            row[key + '_opt'] = optimized[key]
+        rows.append(row)
+
+    if args.check:
+        for row in rows:
+            print(f'{row["shader"]}: {row["bytes"]} -> {row["bytes_opt"]} '
+                  f'bytes, {row["code_instructions"]} -> '
+                  f'{row["code_instructions_opt"]} instructions')
+        if args.baseline:
+            regressions = check_growth(rows, args.baseline, args.tolerance)
+            if regressions:
+                sys.exit('\n'.join(regressions))
+        return
+
+    file = open(args.output, 'w', newline='') if args.output else sys.stdout
+    try:
+        writer = csv.DictWriter(file, fieldnames=COLUMNS)
+        writer.writeheader()
+        writer.writerows(rows)
+    finally:
+        if file is not sys.stdout:
+            file.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,17 @@
+#version 460
+
+layout(location=0)in vec2 inUV;
+
+layout(location=0)out vec4 outFragColor;
+
+layout(set=0,binding=0)uniform sampler2D scene;
+
+layout(push_constant)uniform Constants{
+	vec4 uvScale;// xy rendered fraction of the target, zw max uv
+	vec4 texelSize;// xy 1 / target size
+}constants;
+
+void main(){
+	vec2 uv=min(inUV*constants.uvScale.xy,constants.uvScale.zw);
+	outFragColor=vec4(texture(scene,uv).rgb,1.);
+}
@@ -0,0 +1,50 @@
+#version 460
+
+layout(location=0)in vec2 inUV;
+
+layout(location=0)out vec4 outFragColor;
+
+layout(set=0,binding=0)uniform sampler2D scene;
+
+layout(push_constant)uniform Constants{
+	vec4 uvScale;// xy rendered fraction of the target, zw max uv
+	vec4 texelSize;// xy 1 / target size
+}constants;
+
+vec3 fetch(vec2 uv){
+	return texture(scene,min(uv,constants.uvScale.zw)).rgb;
+}
+
+// 4x4 catmull-rom, the middle two taps per axis merged into one bilinear tap,
+// 9 fetches instead of 16
+void main(){
+	vec2 uv=min(inUV*constants.uvScale.xy,constants.uvScale.zw);
+	vec2 texSize=1./constants.texelSize.xy;
+	vec2 samplePos=uv*texSize;
+	vec2 texPos1=floor(samplePos-.5)+.5;
+	vec2 f=samplePos-texPos1;
+
+	vec2 w0=f*(-.5+f*(1.-.5*f));
+	vec2 w1=1.+f*f*(-2.5+1.5*f);
+	vec2 w2=f*(.5+f*(2.-1.5*f));
+	vec2 w3=f*f*(-.5+.5*f);
+	vec2 w12=w1+w2;
+
+	vec2 uv0=(texPos1-1.)*constants.texelSize.xy;
+	vec2 uv12=(texPos1+w2/w12)*constants.texelSize.xy;
+	vec2 uv3=(texPos1+2.)*constants.texelSize.xy;
+
+	vec3 color=vec3(0.);
+	color+=fetch(vec2(uv0.x,uv0.y))*w0.x*w0.y;
+	color+=fetch(vec2(uv12.x,uv0.y))*w12.x*w0.y;
+	color+=fetch(vec2(uv3.x,uv0.y))*w3.x*w0.y;
+	color+=fetch(vec2(uv0.x,uv12.y))*w0.x*w12.y;
+	color+=fetch(vec2(uv12.x,uv12.y))*w12.x*w12.y;
+	color+=fetch(vec2(uv3.x,uv12.y))*w3.x*w12.y;
+	color+=fetch(vec2(uv0.x,uv3.y))*w0.x*w3.y;
+	color+=fetch(vec2(uv12.x,uv3.y))*w12.x*w3.y;
+	color+=fetch(vec2(uv3.x,uv3.y))*w3.x*w3.y;
+
+	// negative lobes can undershoot next to bright edges
+	outFragColor=vec4(max(color,vec3(0.)),1.);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_json.hpp"
+
+namespace vkr::bench {
+
+// keeps the compiler from dropping a result that is otherwise unused
+template <typename T> inline void keep(T &&value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+// repeats a body until it has run for MIN_TIME in total, setup runs before
+// every iteration and isn't timed
+class Harness {
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr std::chrono::milliseconds MIN_TIME{250};
+
+  template <typename Setup, typename Body>
+  void run(const std::string &name, uint64_t size, Setup &&setup,
+           Body &&body) {
+    // one untimed warm up for caches and allocators
+    setup();
+    body();
+
+    Clock::duration total{};
+    uint64_t iterations = 0;
+    while (total < MIN_TIME) {
+      setup();
+      auto start = Clock::now();
+      body();
+      total += Clock::now() - start;
+      iterations++;
+    }
+
+    BenchResult result;
+    result.name = name + "/" + std::to_string(size);
+    result.size = size;
+    result.iterations = iterations;
+    result.nsPerIteration =
+        std::chrono::duration<double, std::nano>(total).count() / iterations;
+    result.itemsPerSecond = size * 1e9 / result.nsPerIteration;
+    spdlog::info("{}: {:.3f}ms, {:.2f}M items/s ({} iterations)", result.name,
+                 result.nsPerIteration / 1e6, result.itemsPerSecond / 1e6,
+                 iterations);
+    m_results.push_back(std::move(result));
+  }
+
+  template <typename Body>
+  void run(const std::string &name, uint64_t size, Body &&body) {
+    run(name, size, []() {}, std::forward<Body>(body));
+  }
+
+  bool write_json(const std::string &path) const {
+    return vkr::bench::write_json(path, m_results);
+  }
+
+private:
+  std::vector<BenchResult> m_results;
+};
+
+} // namespace vkr::bench
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// tutorial-engine/bench has a copy, both projects' benchmarks write the same
+// json
+namespace vkr::bench {
+
+struct BenchResult {
+  std::string name;
+  uint64_t size = 0;
+  uint64_t iterations = 0;
+  double nsPerIteration = 0.;
+  // size elements per second
+  double itemsPerSecond = 0.;
+};
+
+// same layout as google benchmark's json output, so its compare tooling
+// reads it
+inline bool write_json(const std::string &path,
+                       const std::vector<BenchResult> &results) {
+  std::ofstream file(path);
+  if (!file) {
+    return false;
+  }
+  file << "{\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchResult &result = results[i];
+    file << "    {\"name\": \"" << result.name << "\", \"run_type\": "
+         << "\"iteration\", \"iterations\": " << result.iterations
+         << ", \"real_time\": " << result.nsPerIteration
+         << ", \"cpu_time\": " << result.nsPerIteration
+         << ", \"time_unit\": \"ns\", \"items_per_second\": "
+         << result.itemsPerSecond << "}"
+         << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  file << "  ]\n}\n";
+  return file.good();
+}
+
+} // namespace vkr::bench
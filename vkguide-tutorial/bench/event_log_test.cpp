@@ -0,0 +1,49 @@
+// event_log_test
+// checks the per category rate limit, exits with 1 when a window does not
+// admit, suppress or restart as it should
+#include <cstdint>
+
+#include <spdlog/spdlog.h>
+
+#include "event_log.hpp"
+
+namespace {
+
+constexpr int64_t SECOND = 1000000000;
+
+int g_failures = 0;
+
+void expect(bool admitted, bool expected, const char *what) {
+  if (admitted != expected) {
+    spdlog::error("{}: admitted {}, expected {}", what, admitted, expected);
+    g_failures++;
+  }
+}
+
+vkr::LogCategory g_category("test", 2);
+
+} // namespace
+
+int main() {
+  expect(g_category.admit(0), true, "first event");
+  expect(g_category.admit(10), true, "second event");
+  expect(g_category.admit(SECOND - 1), false, "over the limit");
+
+  expect(g_category.admit(SECOND), true, "window restart");
+  expect(g_category.admit(SECOND + 10), true, "restarted window");
+  expect(g_category.admit(SECOND + 20), false, "restarted window full");
+  // taken before the restart, must not restart the window again
+  expect(g_category.admit(SECOND - 10), false, "late timestamp");
+
+  expect(g_category.admit(5 * SECOND), true, "restart after a gap");
+  if (g_category.take_suppressed() != 3) {
+    spdlog::error("suppressed count is off");
+    g_failures++;
+  }
+
+  if (g_failures > 0) {
+    return 1;
+  }
+  spdlog::info("event log checks passed");
+  return 0;
+}
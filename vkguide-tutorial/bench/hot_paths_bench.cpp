@@ -0,0 +1,203 @@
+// cpu hot paths of the engine on synthetic inputs of 1k to 1M elements, no
+// gpu or window needed. results go to the json path given as the first
+// argument, hot_paths_bench.json by default
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include "bench_harness.hpp"
+#include "deletion_queue.hpp"
+#include "draw_sort.hpp"
+#include "masked_occlusion.hpp"
+#include "mesh.hpp"
+
+namespace {
+
+constexpr uint64_t SIZES[] = {1000, 10000, 100000, 1000000};
+
+// stand ins for Material and RenderObject, sort_draws only needs the shape
+struct BenchMaterial {
+  uint64_t pipeline;
+};
+struct BenchObject {
+  BenchMaterial *material;
+  glm::mat4 transformMatrix;
+};
+
+// square grid of about triangleCount triangles, every inner vertex is shared
+// by six of them
+void write_grid_obj(const std::filesystem::path &path,
+                    uint64_t triangleCount) {
+  uint64_t cells = std::max<uint64_t>(std::sqrt(triangleCount / 2.), 1);
+  std::ofstream file(path);
+  for (uint64_t y = 0; y <= cells; y++) {
+    for (uint64_t x = 0; x <= cells; x++) {
+      file << "v " << x << " " << y << " 0\n";
+      file << "vt " << double(x) / cells << " " << double(y) / cells << "\n";
+    }
+  }
+  file << "vn 0 0 1\n";
+  auto index = [&](uint64_t x, uint64_t y) { return y * (cells + 1) + x + 1; };
+  for (uint64_t y = 0; y < cells; y++) {
+    for (uint64_t x = 0; x < cells; x++) {
+      uint64_t a = index(x, y), b = index(x + 1, y);
+      uint64_t c = index(x + 1, y + 1), d = index(x, y + 1);
+      file << "f " << a << "/" << a << "/1 " << b << "/" << b << "/1 " << c
+           << "/" << c << "/1\n";
+      file << "f " << a << "/" << a << "/1 " << c << "/" << c << "/1 " << d
+           << "/" << d << "/1\n";
+    }
+  }
+}
+
+// unindexed triangles of the same grid, so dedup has work to do
+std::vector<Vertex> grid_vertices(uint64_t vertexCount) {
+  uint64_t cells = std::max<uint64_t>(std::sqrt(vertexCount / 6.), 1);
+  std::vector<Vertex> vertices;
+  vertices.reserve(vertexCount);
+  for (uint64_t i = 0; vertices.size() < vertexCount; i++) {
+    uint64_t x = i % cells, y = (i / cells) % cells;
+    glm::vec3 corners[] = {{x, y, 0}, {x + 1, y, 0}, {x + 1, y + 1, 0},
+                           {x, y, 0}, {x + 1, y + 1, 0}, {x, y + 1, 0}};
+    for (const glm::vec3 &corner : corners) {
+      Vertex vertex;
+      vertex.position = corner;
+      vertex.normal = glm::vec3(0., 0., 1.);
+      vertex.color = glm::vec3(1.);
+      vertex.uv = glm::vec2(corner) / float(cells);
+      vertices.push_back(vertex);
+    }
+  }
+  vertices.resize(vertexCount);
+  return vertices;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string outputPath = argc > 1 ? argv[1] : "hot_paths_bench.json";
+  vkr::bench::Harness harness;
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> position(-50.f, 50.f);
+  std::uniform_real_distribution<float> angle(0.f, 6.28f);
+
+  glm::mat4 projection =
+      glm::perspective(glm::radians(70.f), 1920.f / 1080.f, .1f, 200.f);
+  projection[1][1] *= -1;
+  glm::mat4 view = glm::translate(glm::mat4(1.f), glm::vec3(0., -6., -10.));
+  glm::mat4 viewProj = projection * view;
+
+  for (uint64_t size : SIZES) {
+    // obj parsing, vertex dedup, centering and bounds, size triangles
+    std::filesystem::path objPath =
+        std::filesystem::temp_directory_path() /
+        ("vkr_bench_grid_" + std::to_string(size) + ".obj");
+    write_grid_obj(objPath, size);
+    harness.run("load_from_obj", size, [&]() {
+      auto mesh = Mesh::load_from_obj(objPath.c_str());
+      vkr::bench::keep(mesh);
+    });
+    std::filesystem::remove(objPath);
+
+    std::vector<Vertex> vertices = grid_vertices(size);
+    harness.run("vertex_hash", size, [&]() {
+      size_t hash = 0;
+      for (const Vertex &vertex : vertices) {
+        hash ^= std::hash<Vertex>()(vertex);
+      }
+      vkr::bench::keep(hash);
+    });
+    harness.run("vertex_dedup", size, [&]() {
+      Mesh mesh = Mesh::from_triangles(vertices);
+      vkr::bench::keep(mesh);
+    });
+
+    // the renderable sort from prepare_draws, 16 pipelines of 8 materials
+    std::vector<BenchMaterial> materials(128);
+    for (size_t i = 0; i < materials.size(); i++) {
+      materials[i].pipeline = i / 8 + 1;
+    }
+    std::uniform_int_distribution<size_t> material(0, materials.size() - 1);
+    std::vector<BenchObject> objects(size);
+    for (BenchObject &object : objects) {
+      object.material = &materials[material(rng)];
+      object.transformMatrix = glm::translate(
+          glm::mat4(1.f),
+          glm::vec3(position(rng), position(rng), position(rng)));
+    }
+    std::vector<BenchObject> drawList;
+    harness.run(
+        "sort_draws", size, [&]() { drawList.clear(); },
+        [&]() {
+          vkr::sort_draws(drawList, objects.data(), objects.size(), view,
+                          true);
+          vkr::bench::keep(drawList);
+        });
+
+    // world space bounds, what the hi-z and cpu culling inputs compute per
+    // renderable every frame
+    Mesh boundsMesh;
+    boundsMesh.bounds = glm::vec4(0.f, 0.5f, 0.f, 1.f);
+    std::vector<glm::mat4> models(size);
+    for (glm::mat4 &model : models) {
+      model = glm::translate(
+          glm::mat4(1.f),
+          glm::vec3(position(rng), position(rng), position(rng)));
+      model = glm::rotate(model, angle(rng), glm::vec3(1., 0., 0.));
+      model = glm::rotate(model, angle(rng), glm::vec3(0., 1., 0.));
+      model = glm::scale(model, glm::vec3(1.5f));
+    }
+    std::vector<glm::vec4> spheres(size);
+    harness.run("world_bounds", size, [&]() {
+      for (size_t i = 0; i < size; i++) {
+        spheres[i] = boundsMesh.world_bounds(models[i]);
+      }
+      vkr::bench::keep(spheres);
+    });
+
+    // frustum and occlusion test of every sphere against a floor occluder
+    vkr::MaskedOcclusionBuffer occlusion;
+    glm::vec3 floor[] = {
+        {-50., 0., -50.}, {50., 0., -50.}, {50., 0., 50.}, {-50., 0., 50.}};
+    uint32_t floorIndices[] = {0, 1, 2, 0, 2, 3};
+    occlusion.add_occluder(viewProj, floor, 4, floorIndices, 6);
+    occlusion.rasterize();
+    harness.run("occlusion_cull", size, [&]() {
+      size_t visible = 0;
+      for (const glm::vec4 &sphere : spheres) {
+        visible += occlusion.test_sphere(viewProj, sphere);
+      }
+      vkr::bench::keep(visible);
+    });
+
+    // size deletors, each capturing about as much as a real one
+    vkr::DeletionQueue deletionQueue;
+    uint64_t deleted = 0;
+    harness.run(
+        "deletion_queue_flush", size,
+        [&]() {
+          for (uint64_t i = 0; i < size; i++) {
+            deletionQueue.push_function(
+                [&deleted, i]() { deleted += i; });
+          }
+        },
+        [&]() { deletionQueue.flush(); });
+    vkr::bench::keep(deleted);
+  }
+
+  if (!harness.write_json(outputPath)) {
+    spdlog::error("Could not write {}", outputPath);
+    return 1;
+  }
+  spdlog::info("Wrote {}", outputPath);
+  return 0;
+}
@@ -0,0 +1,95 @@
+// occluder_test
+// rasterizes a finely tessellated ring and its occluder at the same depth and
+// exits with 1 when the occluder hides a pixel the ring itself doesn't
+#include <cmath>
+#include <vector>
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include "masked_occlusion.hpp"
+#include "mesh.hpp"
+
+namespace {
+
+constexpr uint32_t SEGMENTS = 96;
+constexpr uint32_t RINGS = 24;
+constexpr uint32_t MAX_TRIANGLES = 512;
+
+// flat annulus facing the camera with a wavy outline, so both the hole and the
+// concave parts of the rim would be filled by anything that overcovers
+Mesh ring_mesh() {
+  std::vector<Vertex> triangles;
+  auto point = [](uint32_t segment, uint32_t ring) {
+    float angle = 6.2831853f * segment / SEGMENTS;
+    float outer = 1.f + .25f * std::sin(angle * 7.f);
+    float radius = .4f + (outer - .4f) * ring / RINGS;
+    Vertex vertex = {};
+    vertex.position = glm::vec3(radius * std::cos(angle),
+                                radius * std::sin(angle), 0.);
+    return vertex;
+  };
+  for (uint32_t segment = 0; segment < SEGMENTS; segment++) {
+    for (uint32_t ring = 0; ring < RINGS; ring++) {
+      Vertex a = point(segment, ring), b = point(segment + 1, ring);
+      Vertex c = point(segment + 1, ring + 1), d = point(segment, ring + 1);
+      triangles.insert(triangles.end(), {a, b, c, a, c, d});
+    }
+  }
+  return Mesh::from_triangles(triangles);
+}
+
+} // namespace
+
+int main() {
+  Mesh mesh = ring_mesh();
+  mesh.build_occluder(MAX_TRIANGLES);
+  if (mesh.occluderIndices.empty() ||
+      mesh.occluderIndices.size() / 3 > MAX_TRIANGLES) {
+    spdlog::error("occluder has {} triangles, budget {}",
+                  mesh.occluderIndices.size() / 3, MAX_TRIANGLES);
+    return 1;
+  }
+
+  glm::mat4 projection =
+      glm::perspective(glm::radians(40.f), 1.f, .1f, 100.f);
+  glm::mat4 view = glm::translate(glm::mat4(1.f), glm::vec3(0., 0., -4.));
+  glm::mat4 viewProj = projection * view;
+
+  vkr::MaskedOcclusionBuffer source(256, 256), occluder(256, 256);
+  std::vector<glm::vec3> positions;
+  for (const Vertex &vertex : mesh.vertices) {
+    positions.push_back(vertex.position);
+  }
+  source.add_occluder(viewProj, positions.data(), positions.size(),
+                      mesh.indices.data(), mesh.indices.size());
+  source.rasterize();
+  occluder.add_occluder(viewProj, mesh.occluderVertices.data(),
+                        mesh.occluderVertices.size(),
+                        mesh.occluderIndices.data(),
+                        mesh.occluderIndices.size());
+  occluder.rasterize();
+
+  // one pixel rects at the far plane, hidden wherever something was drawn
+  uint32_t covered = 0, overcovered = 0;
+  for (uint32_t y = 0; y < occluder.height(); y++) {
+    for (uint32_t x = 0; x < occluder.width(); x++) {
+      glm::vec2 pixel(2.f / occluder.width(), 2.f / occluder.height());
+      glm::vec2 ndcMin = glm::vec2(x + .25f, y + .25f) * pixel - 1.f;
+      glm::vec2 ndcMax = glm::vec2(x + .75f, y + .75f) * pixel - 1.f;
+      if (occluder.test_rect(ndcMin, ndcMax, 1.f)) {
+        continue;
+      }
+      covered++;
+      if (source.test_rect(ndcMin, ndcMax, 1.f)) {
+        overcovered++;
+      }
+    }
+  }
+
+  spdlog::info("occluder: {} of {} triangles, {} pixels, {} overcovered",
+               mesh.occluderIndices.size() / 3, mesh.indices.size() / 3,
+               covered, overcovered);
+  return covered > 0 && overcovered == 0 ? 0 : 1;
+}
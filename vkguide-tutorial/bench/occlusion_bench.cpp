@@ -0,0 +1,89 @@
+// cpu masked occlusion throughput, rasterization and testing are timed
+// separately, single threaded and on the thread pool
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include "masked_occlusion.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+constexpr uint32_t OCCLUDER_QUADS = 4096;
+constexpr uint32_t TEST_SPHERES = 100000;
+constexpr uint32_t ITERATIONS = 50;
+
+template <typename F> double time_ms(F &&function) {
+  auto start = std::chrono::high_resolution_clock::now();
+  function();
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+} // namespace
+
+int main() {
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> position(-20.f, 20.f);
+  std::uniform_real_distribution<float> depth(2.f, 60.f);
+  std::uniform_real_distribution<float> size(.2f, 3.f);
+
+  // camera facing quads scattered through the frustum
+  std::vector<glm::vec3> vertices;
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 0; i < OCCLUDER_QUADS; i++) {
+    glm::vec3 center(position(rng), position(rng), -depth(rng));
+    float half = size(rng);
+    uint32_t base = vertices.size();
+    vertices.push_back(center + glm::vec3(-half, -half, 0.));
+    vertices.push_back(center + glm::vec3(half, -half, 0.));
+    vertices.push_back(center + glm::vec3(half, half, 0.));
+    vertices.push_back(center + glm::vec3(-half, half, 0.));
+    indices.insert(indices.end(),
+                   {base, base + 1, base + 2, base, base + 2, base + 3});
+  }
+  std::vector<glm::vec4> spheres;
+  for (uint32_t i = 0; i < TEST_SPHERES; i++) {
+    spheres.push_back(
+        glm::vec4(position(rng), position(rng), -depth(rng), size(rng) * .5f));
+  }
+
+  glm::mat4 projection =
+      glm::perspective(glm::radians(70.f), 1920.f / 1080.f, .1f, 200.f);
+  projection[1][1] *= -1;
+  glm::mat4 viewProj = projection * glm::mat4(1.f);
+
+  vkr::ThreadPool pool;
+  vkr::MaskedOcclusionBuffer buffer;
+  uint64_t triangles = indices.size() / 3;
+
+  for (vkr::ThreadPool *rasterPool : {(vkr::ThreadPool *)nullptr, &pool}) {
+    double ms = 0.;
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+      buffer.clear();
+      buffer.add_occluder(viewProj, vertices.data(), vertices.size(),
+                          indices.data(), indices.size());
+      ms += time_ms([&]() { buffer.rasterize(rasterPool); });
+    }
+    spdlog::info("rasterize {}x{}, {} threads: {:.3f}ms/frame, {:.2f} "
+                 "Mtris/s",
+                 buffer.width(), buffer.height(),
+                 rasterPool ? rasterPool->size() : 1, ms / ITERATIONS,
+                 triangles * ITERATIONS / (ms * 1e3));
+  }
+
+  uint64_t visible = 0;
+  double ms = time_ms([&]() {
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+      for (const auto &sphere : spheres) {
+        visible += buffer.test_sphere(viewProj, sphere);
+      }
+    }
+  });
+  spdlog::info("test: {:.3f}ms/frame, {:.2f} Mtests/s, {:.1f}% visible",
+               ms / ITERATIONS, TEST_SPHERES * ITERATIONS / (ms * 1e3),
+               100. * visible / (TEST_SPHERES * ITERATIONS));
+  return 0;
+}
@@ -0,0 +1,52 @@
+// replay_compare baseline.csv current.csv [tolerance]
+// compares the medians of two camera path reports written by the engine's
+// --report, exits with 2 when a metric is worse than the baseline by more
+// than tolerance (0.05 by default)
+#include <exception>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "replay_report.hpp"
+
+namespace {
+constexpr const char *USAGE = "baseline.csv current.csv [tolerance]";
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    spdlog::error("Usage: {} {}", argv[0], USAGE);
+    return 1;
+  }
+  double tolerance = 0.05;
+  if (argc > 3) {
+    try {
+      tolerance = std::stod(argv[3]);
+    } catch (const std::exception &) {
+      spdlog::error("Invalid tolerance {}\nusage: {} {}", argv[3], argv[0],
+                    USAGE);
+      return 1;
+    }
+  }
+
+  std::optional<vkr::ReplayMetrics> baseline =
+      vkr::read_replay_report(argv[1]);
+  std::optional<vkr::ReplayMetrics> current = vkr::read_replay_report(argv[2]);
+  if (!baseline || !current) {
+    spdlog::error("Could not read {}", baseline ? argv[2] : argv[1]);
+    return 1;
+  }
+
+  std::vector<vkr::ReplayRegression> regressions =
+      vkr::compare_replay_metrics(*baseline, *current, tolerance);
+  for (const vkr::ReplayRegression &regression : regressions) {
+    spdlog::error("Regression in {}: {:.3f} -> {:.3f} ({:+.1f}%)",
+                  regression.name, regression.baseline, regression.current,
+                  regression.change * 100.);
+  }
+  if (!regressions.empty()) {
+    return 2;
+  }
+  spdlog::info("No regressions beyond {:.1f}%", tolerance * 100.);
+  return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+namespace vkr {
+
+// the view matrix of every simulation step, stored as the steps where it
+// changed. steps are the fixed timestep, so replaying a path feeds the
+// renderer the same cameras in the same order on every run and machine
+class CameraPath {
+public:
+  struct Keyframe {
+    uint64_t step = 0;
+    glm::mat4 view;
+  };
+
+  // adds a keyframe only when the view differs from the previous one
+  void record(uint64_t step, const glm::mat4 &view);
+  // the view at a step, held from the last keyframe at or before it
+  glm::mat4 view_at(uint64_t step) const;
+
+  // steps in the path, keyframes only mark where the view changes
+  uint64_t length() const { return m_length; }
+  void set_length(uint64_t length) { m_length = length; }
+  bool empty() const { return m_keyframes.empty(); }
+
+  // text, one keyframe per line after a header with the length
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
+
+private:
+  std::vector<Keyframe> m_keyframes;
+  uint64_t m_length = 0;
+};
+
+} // namespace vkr
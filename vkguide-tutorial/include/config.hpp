@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+namespace vkr {
+
+// resampling from the scaled scene to the swapchain
+enum class UpscaleFilter : uint32_t {
+  Bilinear,
+  // 9 bilinear taps, sharper but can ring on hard edges
+  CatmullRom,
+  Count,
+};
+
+// runtime toggles for the renderer, read every frame so they can be flipped
+// from input
+struct EngineConfig {
+  // one bindless texture array + material ssbo instead of a set per material
+  bool bindless = true;
+  // depth only pass first, main pass then shades with an eEqual depth test
+  bool depthPrepass = false;
+  // sort opaque draws front to back inside each material bucket
+  bool frontToBack = true;
+  // count fragment shader invocations with pipeline statistics queries
+  bool pipelineStatistics = true;
+  // two phase hi-z occlusion culling through indirect draws
+  bool occlusionCulling = false;
+  // cpu masked occlusion culling before any draw is recorded
+  bool softwareOcclusion = false;
+  // replay the scene from cached secondaries, only the camera and scene ubo
+  // are written per frame. per frame culling paths take precedence
+  bool staticCommandCache = false;
+  // fifo and fifo relaxed are vsynced, mailbox and immediate are not. falls
+  // back to fifo when the surface doesn't support it
+  vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
+  // cpu frame limiter, 0 disables it
+  double targetFps = 0.;
+  // frames the cpu may run ahead of the gpu when sampling input, 1 to
+  // FRAME_OVERLAP. lower trades throughput for input latency
+  uint32_t maxFrameLatency = 3;
+  // scale the scene resolution to keep gpu frame time under gpuBudgetMs
+  bool dynamicResolution = false;
+  double gpuBudgetMs = 1000. / 60.;
+  UpscaleFilter upscaleFilter = UpscaleFilter::Bilinear;
+  // performance overlay, costs nothing while off
+  bool hud = false;
+  // named gpu and cpu scopes, written as a chrome trace on exit. needs host
+  // query reset, only read at init
+  bool profiling = true;
+  // simulate the next frame on its own thread while this one is recorded.
+  // only read at init
+  bool pipelinedSimulation = true;
+};
+
+// offscreen benchmark runs, no window, surface or swapchain. only read at init
+struct HeadlessConfig {
+  bool enabled = false;
+  uint32_t frames = 1000;
+  // one row per frame, json if the path ends in .json and csv otherwise
+  std::string timingsPath = "headless_timings.csv";
+  // the last frame as a png, skipped when empty
+  std::string screenshotPath;
+};
+
+// deterministic camera paths, recorded from input and replayed with fixed
+// timesteps in headless or windowed mode. only read at init
+struct ReplayConfig {
+  // the path driven from input is written here on exit, skipped when empty
+  std::string recordPath;
+  // replaces input with this path, skipped when empty
+  std::string playPath;
+  // times the path is played, the report holds each run and their medians
+  uint32_t runs = 3;
+  std::string reportPath = "replay_report.csv";
+  // a previous report to compare against, skipped when empty
+  std::string baselinePath;
+  // relative slowdown of a metric over the baseline that counts as a
+  // regression
+  double tolerance = 0.05;
+};
+
+} // namespace vkr
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+namespace vkr {
+
+struct DeletionQueue {
+  std::deque<std::function<void()>> deletors;
+
+  void push_function(std::function<void()> &&function) {
+    deletors.push_back(std::move(function));
+  }
+
+  void flush() {
+    // reverse iterate the deletion queue to execute all the functions
+    for (auto it = deletors.rbegin(); it != deletors.rend(); it++) {
+      (*it)(); // call the function
+    }
+
+    deletors.clear();
+  }
+};
+
+// deletions that wait for the gpu to reach a timeline value, values are pushed
+// in increasing order
+struct TimelineDeletionQueue {
+  std::deque<std::pair<uint64_t, std::function<void()>>> deletors;
+
+  void push_function(uint64_t timelineValue,
+                     std::function<void()> &&function) {
+    deletors.emplace_back(timelineValue, std::move(function));
+  }
+
+  // runs every deletor whose value the gpu has reached
+  void collect(uint64_t completedValue) {
+    while (!deletors.empty() && deletors.front().first <= completedValue) {
+      deletors.front().second();
+      deletors.pop_front();
+    }
+  }
+
+  void flush() { collect(UINT64_MAX); }
+};
+
+} // namespace vkr
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+namespace vkr {
+
+// what the renderer can do on a device, every fast path above the baseline
+// has a fallback
+enum class CapabilityTier : uint32_t {
+  // timeline semaphores and dynamic rendering, per material descriptor sets
+  // and cpu culling only
+  Baseline,
+  // bindless textures and gpu driven hi-z occlusion culling
+  GpuDriven,
+  // mesh shaders and ray tracing on top, nothing uses them yet
+  Advanced,
+};
+
+const char *capability_tier_name(CapabilityTier tier);
+
+// optional features of one physical device, queried before the device is
+// created
+struct DeviceCapabilities {
+  std::string name;
+  vk::PhysicalDeviceType type = vk::PhysicalDeviceType::eOther;
+
+  // required, devices without them are never selected
+  bool timelineSemaphore = false;
+  bool dynamicRendering = false;
+  bool shaderDrawParameters = false;
+
+  // bindless texture array
+  bool descriptorIndexing = false;
+  // hi-z culled draws use firstInstance as the object index
+  bool drawIndirectFirstInstance = false;
+  bool drawIndirectCount = false;
+  // fragment invocation counts
+  bool pipelineStatistics = false;
+  // statistics queries spanning cached secondaries
+  bool inheritedQueries = false;
+  // gpu profiler slots are reset from the host
+  bool hostQueryReset = false;
+  bool meshShader = false;
+  bool rayTracing = false;
+
+  bool meets_baseline() const;
+  CapabilityTier tier() const;
+  // higher is better, device type first, then capabilities
+  uint32_t score() const;
+  // one line per capability
+  std::string report() const;
+};
+
+DeviceCapabilities query_device_capabilities(vk::PhysicalDevice device);
+
+} // namespace vkr
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace vkr {
+
+// appends [first, first + count) to drawList sorted by pipeline, then
+// material, then front to back inside each material so early depth rejects
+// as much of the overdraw as possible. Object is anything shaped like a
+// RenderObject: a transformMatrix and a material pointer with a pipeline
+template <typename Object>
+void sort_draws(std::vector<Object> &drawList, const Object *first,
+                size_t count, const glm::mat4 &view, bool frontToBack) {
+  struct SortedObject {
+    const Object *object;
+    float viewDistance;
+  };
+  std::vector<SortedObject> sortedObjects;
+  sortedObjects.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    glm::vec3 viewPosition = view * first[i].transformMatrix[3];
+    sortedObjects.push_back(
+        {&first[i], glm::dot(viewPosition, viewPosition)});
+  }
+  // sort by pipeline first so materials that only differ in their textures
+  // share a bind
+  std::sort(sortedObjects.begin(), sortedObjects.end(),
+            [=](const SortedObject &a, const SortedObject &b) {
+              const auto *ma = a.object->material;
+              const auto *mb = b.object->material;
+              if (ma->pipeline != mb->pipeline) {
+                return (uint64_t)ma->pipeline < (uint64_t)mb->pipeline;
+              }
+              if (ma != mb || !frontToBack) {
+                return (uint64_t)ma < (uint64_t)mb;
+              }
+              return a.viewDistance < b.viewDistance;
+            });
+
+  drawList.reserve(drawList.size() + count);
+  for (const auto &sorted : sortedObjects) {
+    drawList.push_back(*sorted.object);
+  }
+}
+
+} // namespace vkr
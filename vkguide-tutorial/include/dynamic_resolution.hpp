@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vkr {
+
+// picks a render scale that keeps the gpu frame time under a budget
+// gpu time is taken to scale with the pixel count, so the scale steers the
+// smoothed frame time towards the budget minus some headroom. the scale only
+// moves in whole steps and waits for a change to show up in the timings
+// before the next one, so it changes rarely and never oscillates per frame
+class DynamicResolution {
+public:
+  explicit DynamicResolution(double budgetMs = 1000. / 60.,
+                             float minScale = 0.5f, float maxScale = 1.f,
+                             float step = 0.05f);
+
+  // feeds one gpu frame time, true when the scale changed
+  bool update(double gpuFrameMs);
+  float scale() const { return m_scale; }
+  double smoothed_ms() const { return m_smoothedMs; }
+  double budget_ms() const { return m_budgetMs; }
+  void set_budget_ms(double budgetMs) { m_budgetMs = budgetMs; }
+  void reset(float scale = 1.f);
+
+private:
+  // gpu timings lag a few frames behind, wait this long after a change
+  static constexpr uint32_t SETTLE_FRAMES = 8;
+  // fraction of the budget aimed for, so noise doesn't push frames over it
+  static constexpr double HEADROOM = 0.9;
+  // weight of a new sample in the moving average
+  static constexpr double SMOOTHING = 0.1;
+
+  double m_budgetMs;
+  float m_minScale;
+  float m_maxScale;
+  float m_step;
+  float m_scale;
+  double m_smoothedMs = 0.;
+  uint32_t m_framesSinceChange = 0;
+};
+
+} // namespace vkr
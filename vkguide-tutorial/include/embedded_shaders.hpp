@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vkr {
+
+// one spir-v binary linked into the engine, uint32_t arrays already have the
+// alignment vk::ShaderModuleCreateInfo needs
+struct EmbeddedShader {
+  // source file name, e.g. mesh_single.frag
+  const char *name;
+  const uint32_t *code;
+  size_t wordCount;
+};
+
+// generated at build time by assets/shaders/embed_spirv.py from every shader
+// in assets/shaders/meson.build
+extern const EmbeddedShader EMBEDDED_SHADERS[];
+extern const size_t EMBEDDED_SHADER_COUNT;
+
+} // namespace vkr
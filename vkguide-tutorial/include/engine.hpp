@@ -1,8 +1,17 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <deque>
 #include <functional>
+#include <future>
+#include <memory>
 #include <optional>
 #include <set>
+#include <thread>
+#include <utility>
 
 #include "SDL_events.h"
 #include "SDL_scancode.h"
@@ -16,9 +25,26 @@
 #include <vk_mem_alloc.hpp>
 #include <vulkan/vulkan.hpp>
 
+#include "camera_path.hpp"
+#include "config.hpp"
+#include "deletion_queue.hpp"
+#include "device_capabilities.hpp"
+#include "dynamic_resolution.hpp"
+#include "event_log.hpp"
+#include "frame_pacer.hpp"
+#include "gpu_profiler.hpp"
+#include "masked_occlusion.hpp"
 #include "mesh.hpp"
+#include "pipeline.hpp"
+#include "pipeline_cache.hpp"
+#include "replay_report.hpp"
+#include "shader_permutation.hpp"
+#include "shader_reflection.hpp"
 #include "textures.hpp"
+#include "thread_pool.hpp"
+#include "triple_buffer.hpp"
 #include "types.hpp"
+#include "zone_profiler.hpp"
 
 namespace vkr {
 
@@ -45,15 +71,56 @@ struct GPUCameraSceneData {
 
 struct GPUObjectData {
   glm::mat4 modelMatrix;
+  glm::uvec4 materialIndex; // x is index into material ssbo, yzw unused
 };
 
 struct GPUObjectLightingData {
   glm::vec4 objectAmbientLighting;
 };
 
+// hi-z culling, one per draw
+struct GPUCullData {
+  glm::vec4 sphere; // world space center, w radius
+};
+
+struct GPUCullStats {
+  uint32_t culledFirstPhase;
+  uint32_t recoveredSecondPhase;
+  uint32_t culledTotal;
+  uint32_t drawCount;
+};
+
+struct GPUHizCullConstants {
+  glm::mat4 viewproj;
+  glm::vec4 pyramidSize; // xy size of mip 0, z mip count
+  glm::uvec4 params;     // x draw count, y phase, z second phase offset
+};
+
+struct GPUHizReduceConstants {
+  glm::ivec2 srcSize;
+  glm::ivec2 dstSize;
+};
+
+struct GPUUpscaleConstants {
+  glm::vec4 uvScale;   // xy rendered fraction of the target, zw max uv
+  glm::vec4 texelSize; // xy 1 / target size, zw unused
+};
+
+struct GPUMaterialData {
+  // same padding rules as GPUSceneData
+  glm::vec4 baseColor;
+  glm::ivec4 textureIndices; // x diffuse index into bindless array, -1 if none
+};
+
 struct FrameData {
   vk::Semaphore m_presentSemaphore, m_renderSemaphore;
-  vk::Fence m_renderFence;
+  // frame last submitted from this slot and the timeline value it signals,
+  // 0 until the slot is first used
+  uint64_t frameNumber = 0;
+  uint64_t timelineValue = 0;
+  // whether this frame's queries have results to read
+  bool statsQueryWritten = false;
+  bool cullStatsWritten = false;
 
   vk::CommandPool m_commandPool;
   vk::CommandBuffer m_mainCommandBuffer;
@@ -62,61 +129,177 @@ struct FrameData {
   AllocatedBuffer objectBuffer;
   AllocatedBuffer objectLightingBuffer;
   vk::DescriptorSet objectDescriptorSet;
+
+  // hi-z culling: cull input, indirect commands for both phases, which draws
+  // the first phase kept and host visible counters
+  AllocatedBuffer cullDataBuffer;
+  AllocatedBuffer indirectBuffer;
+  AllocatedBuffer visibilityBuffer;
+  AllocatedBuffer cullStatsBuffer;
+  vk::DescriptorSet cullDescriptorSet;
+
+  // static scene commands, replayed every frame of the static command cache
+  vk::CommandBuffer staticCommandBuffer;
+  // m_staticGeneration staticCommandBuffer was recorded at
+  uint64_t staticGeneration = 0;
+
+  // when the input this frame was built from was sampled, pending until its
+  // timeline value is seen reached
+  FramePacer::Clock::time_point inputTime;
+  bool latencyPending = false;
 };
 
 struct Material {
-  std::optional<vk::DescriptorSet> textureSet; // default to no texture
+  // only used by the non-bindless path, default to no texture
+  std::optional<vk::DescriptorSet> textureSet;
   VkPipeline pipeline;
+  // same as pipeline, but eEqual depth test without writes for use after the
+  // depth prepass
+  VkPipeline depthEqualPipeline;
   VkPipelineLayout pipelineLayout;
+  // index into the material ssbo
+  uint32_t materialIndex;
+  // the mesh.frag permutation it draws with, see request_material
+  MaterialFeatures features = 0;
 };
 
 struct RenderObject {
   Mesh *mesh;
   Material *material;
   glm::mat4 transformMatrix;
+
+  // world space bounding sphere, radius scaled by the largest axis scale
+  glm::vec4 world_bounds() const {
+    return mesh->world_bounds(transformMatrix);
+  }
 };
 
-struct DeletionQueue {
-  std::deque<std::function<void()>> deletors;
+struct Inputs {
+  std::set<SDL_Scancode> keyPressed;
+};
 
-  void push_function(std::function<void()> &&function) {
-    deletors.push_back(function);
-  }
+// what the render thread hands the simulation every frame
+struct SimulationInput {
+  std::set<SDL_Scancode> keyPressed;
+  // a copy, keyup handling on the render thread never races the simulation
+  EngineConfig config;
+  FramePacer::Clock::time_point inputTime;
+};
+
+// everything the render thread needs from one simulation step, immutable
+// once published
+struct FramePacket {
+  // counts simulation steps, independent of m_frameNumber
+  uint64_t step = 0;
+  FramePacer::Clock::time_point inputTime;
+  glm::mat4 viewMatrix;
+  GPUSceneData sceneParameters;
+  // every renderable with this step's transform
+  std::vector<RenderObject> renderables;
+  // what survived cpu occlusion culling, all renderables without it
+  std::vector<RenderObject> visible;
+  bool softwareOcclusion = false;
+  uint64_t softwareCulled = 0;
+  double softwareRasterMs = 0.;
+  double softwareTestMs = 0.;
+  double simulationMs = 0.;
+  // run of the camera path and step within it, both 0 without a replay
+  uint32_t replayRun = 0;
+  uint64_t replayStep = 0;
+};
+
+// one row of a headless run's timings
+struct FrameTiming {
+  uint64_t frame = 0;
+  // render thread wall time of the whole frame, waits included
+  double frameMs = 0.;
+  double recordMs = 0.;
+  // negative until the frame's timestamps are read back
+  double gpuMs = -1.;
+};
+
+// what record_draws recorded, indirect draws count before culling
+struct DrawStats {
+  uint32_t drawCalls = 0;
+  uint64_t triangles = 0;
+  uint32_t pipelineBinds = 0;
+  uint32_t descriptorBinds = 0;
+  // vertex and index buffers
+  uint32_t bufferBinds = 0;
+};
 
-  void flush() {
-    // reverse iterate the deletion queue to execute all the functions
-    for (auto it = deletors.rbegin(); it != deletors.rend(); it++) {
-      (*it)(); // call the function
-    }
+// rolling history for a hud graph
+struct HudGraph {
+  static constexpr size_t SIZE = 240;
+  std::array<float, SIZE> values = {};
+  // oldest value, where the next one goes
+  size_t next = 0;
 
-    deletors.clear();
+  void push(float value) {
+    values[next] = value;
+    next = (next + 1) % SIZE;
   }
+  float max() const { return *std::max_element(values.begin(), values.end()); }
 };
 
-struct Inputs {
-  std::set<SDL_Scancode> keyPressed;
+// one pipeline compiled off the render thread
+struct PipelineJob {
+  std::future<void> done;
+  vk::Pipeline pipeline;
+  // on the render thread, points a material or the engine at the pipeline
+  std::function<void(vk::Pipeline)> install;
+};
+
+// the pipelines of one mesh.frag permutation, shared by every material
+// requesting its features. null until their jobs finished
+struct MeshPermutation {
+  vk::Pipeline pipeline;
+  vk::Pipeline depthEqualPipeline;
 };
 
 struct UploadContext {
-  vk::Fence uploadFence;
+  // timeline value of the upload last submitted from this context, the pool
+  // is reset once it's reached
+  uint64_t timelineValue = 0;
   vk::CommandPool commandPool;
   vk::CommandBuffer commandBuffer;
 };
 
 constexpr unsigned int FRAME_OVERLAP = 3;
+// uploads in flight before submit_upload waits for the oldest one
+constexpr unsigned int UPLOAD_CONTEXT_COUNT = 4;
+// profiler slots 0 to FRAME_OVERLAP - 1 belong to the frames, the next
+// UPLOAD_CONTEXT_COUNT to the upload contexts
+constexpr unsigned int UPLOAD_PROFILER_SLOT = FRAME_OVERLAP;
+constexpr unsigned int MAX_OBJECTS = 10000;
+constexpr unsigned int MAX_MATERIALS = 256;
+constexpr unsigned int MAX_BINDLESS_TEXTURES = 1024;
+constexpr unsigned int MAX_OCCLUDER_TRIANGLES = 2048;
+// world space bounding radius for a renderable to be a cpu occluder
+constexpr float MIN_OCCLUDER_RADIUS = 1.f;
+
+// event log categories for per frame paths, limits are events per second.
+// held keys are applied every simulation step
+inline LogCategory LOG_INPUT{"input", 10};
 
 class VulkanEngine {
 public:
-  VulkanEngine();
+  explicit VulkanEngine(HeadlessConfig headless = {},
+                        ReplayConfig replay = {});
   void init();
   void run();
   void cleanup();
   void draw();
+  // whether a replay was slower than its --baseline by more than the
+  // tolerance, valid after run()
+  bool replay_regressed() const { return m_replayRegressed; }
 
 private:
   std::string m_appName = "Vulkan Engine";
-  SDL_Window *m_window;
+  // null when headless
+  SDL_Window *m_window = nullptr;
   bool m_isInitialized = false;
+  EngineConfig m_config;
   vk::Extent2D m_windowExtent = vk::Extent2D(1920, 1080);
   uint64_t m_frameNumber = 0;
 
@@ -127,13 +310,24 @@ private:
   vk::Device m_device;
   vk::SurfaceKHR m_surface;
   vk::PhysicalDeviceProperties m_gpuProperties;
+  // of the selected device, fast paths it lacks are turned off in m_config
+  DeviceCapabilities m_capabilities;
   void init_vulkan();
+  void apply_capabilities();
 
   vk::SwapchainKHR m_swapchain;
   vk::Format m_swapchainImageFormat;
   std::vector<VkImage> m_swapchainImages;
   std::vector<VkImageView> m_swapchainImageViews;
+  // present mode actually in use, m_config.presentMode is the request
+  vk::PresentModeKHR m_presentMode;
+  // swapchain, its views and the framebuffers, flushed on recreation
+  DeletionQueue m_swapchainDeletionQueue;
   void init_swapchain();
+  void create_swapchain();
+  // same extent, picks up m_config.presentMode
+  void recreate_swapchain();
+  vk::PresentModeKHR select_present_mode(vk::PresentModeKHR desired);
 
   vk::Queue m_graphicsQueue;
   uint32_t m_graphicsQueueFamily;
@@ -146,6 +340,38 @@ private:
   void init_commands();
   void init_sync_structures();
 
+  // one timeline semaphore for the whole device, every submit signals the
+  // next value so frames, uploads, deferred deletions and readbacks all wait
+  // on the same counter instead of per frame fences
+  vk::Semaphore m_timeline;
+  // last value handed to a submit
+  uint64_t m_timelineValue = 0;
+  // highest value seen reached, avoids querying the semaphore for old values
+  uint64_t m_timelineCompleted = 0;
+  TimelineDeletionQueue m_deferredDeletionQueue;
+  uint64_t next_timeline_value();
+  uint64_t completed_timeline_value();
+  bool timeline_reached(uint64_t value);
+  void wait_timeline(uint64_t value);
+  // frames are numbered by m_frameNumber, waiting for a frame that was never
+  // submitted logs an error and returns
+  void wait_for_frame(uint64_t frameNumber);
+  // runs once everything submitted so far has finished
+  void defer_deletion(std::function<void()> &&function);
+
+  // one fragment invocation query per frame in flight, frame timestamps are
+  // m_profiler's
+  vk::QueryPool m_statsQueryPool;
+  uint64_t m_fragmentInvocations = 0;
+  uint64_t m_statsFrames = 0;
+  // gpu frame time, indexed by whether occlusion culling was on
+  double m_gpuFrameTimeMs[2] = {0., 0.};
+  uint64_t m_gpuFrameTimeFrames[2] = {0, 0};
+  void init_queries();
+  void read_frame_queries(FrameData &frame);
+  // scopes in frame command buffers use the frame index as their slot
+  GpuProfiler m_profiler;
+
   // descriptors
   // #utility
   AllocatedBuffer create_buffer(size_t allocSize, vk::BufferUsageFlags usage,
@@ -155,21 +381,68 @@ private:
   // #utility
   size_t pad_uniform_buffer_size(size_t originalSize);
   vk::DescriptorPool m_descriptorPool;
+  // every descriptor set and pipeline layout, reflected from the shaders
+  LayoutCache m_layoutCache;
   vk::DescriptorSetLayout m_globalSetLayout;
   vk::DescriptorSetLayout m_objectSetLayout;
   AllocatedBuffer m_cameraSceneBuffer;
   vk::DescriptorSet m_globalDescriptorSet;
   void init_descriptors();
 
+  // bindless textures + material ssbo, bound once at set 2
+  // falls back to one texture set per material when disabled
+  vk::DescriptorPool m_bindlessDescriptorPool;
+  vk::DescriptorSetLayout m_bindlessSetLayout;
+  vk::DescriptorSet m_bindlessDescriptorSet;
+  AllocatedBuffer m_materialBuffer;
+  std::vector<GPUMaterialData> m_materialData;
+  uint32_t m_bindlessTextureCount = 0;
+  void init_bindless_descriptors();
+  uint32_t register_bindless_texture(vk::ImageView imageView,
+                                     vk::Sampler sampler);
+  void update_material_data(const Material &material,
+                            const GPUMaterialData &data);
+
+  // scene pass into the render target, upscale pass into the swapchain
   vk::RenderPass m_renderPass;
+  vk::RenderPass m_upscaleRenderPass;
+  // one per swapchain image, upscale pass only
   std::vector<vk::Framebuffer> m_framebuffers;
   void init_default_renderpass();
   void init_framebuffers();
 
+  // dynamic resolution
+  // the scene renders into m_renderTarget and m_depthImage, both window sized,
+  // but only the top left m_renderExtent is drawn. pipelines take viewport and
+  // scissor as dynamic state, so a scale change never rebuilds them
+  AllocatedImage m_renderTarget;
+  vk::ImageView m_renderTargetView;
+  vk::Format m_renderTargetFormat = vk::Format::eR8G8B8A8Srgb;
+  vk::Framebuffer m_sceneFramebuffer;
+  vk::Extent2D m_renderExtent;
+  DynamicResolution m_dynamicResolution;
+  vk::Sampler m_upscaleSampler;
+  vk::DescriptorPool m_upscaleDescriptorPool;
+  vk::DescriptorSetLayout m_upscaleSetLayout;
+  vk::DescriptorSet m_upscaleSet;
+  vk::PipelineLayout m_upscaleLayout;
+  // indexed by UpscaleFilter
+  std::array<vk::Pipeline, size_t(UpscaleFilter::Count)> m_upscalePipelines;
+  void init_render_target();
+  void init_upscale();
+  // feeds the controller a gpu frame time, resizes m_renderExtent on a change
+  void update_render_scale(double gpuFrameMs);
+  void set_render_scale(float scale);
+  void set_render_viewport(vk::CommandBuffer cmd);
+  void record_upscale(vk::CommandBuffer cmd, uint32_t swapchainImageIndex);
+
   // shader modules
-  std::optional<vk::ShaderModule> load_shader_module(const char *filePath);
-  std::unordered_map<std::string, std::string> m_shaderFiles;
+  // by source file name, e.g. mesh_single.frag
   std::unordered_map<std::string, vk::ShaderModule> m_shaderModules;
+  // same keys, what each module binds
+  std::unordered_map<std::string, ShaderReflection> m_shaderReflections;
+  vk::ShaderModule create_shader_module(const uint32_t *code,
+                                        size_t wordCount);
   void init_shader_modules();
 
   // memory related
@@ -177,29 +450,164 @@ private:
   DeletionQueue m_mainDeletionQueue;
 
   // pipelines
+  // of untextured materials, compatible with every mesh layout for sets 0
+  // and 1, so they are bound with it once per pass
   vk::PipelineLayout m_meshPipelineLayout;
-  vk::Pipeline m_meshPipeline;
+  // the shared sets 0 and 1 plus what the mesh.frag variant fragment adds
+  vk::PipelineLayout mesh_pipeline_layout(const std::string &fragment);
+  // solid color, what materials draw with until their pipelines compiled
+  vk::Pipeline m_placeholderPipeline;
+  // position only, no fragment shader. null until compiled, the prepass is
+  // skipped until then
+  vk::Pipeline m_depthPrepassPipeline;
+  bool depth_prepass_active() const {
+    return m_config.depthPrepass && m_depthPrepassPipeline;
+  }
+  VertexInputDescription m_vertexDescription;
+  VertexInputDescription m_positionVertexDescription;
+  // mesh pipeline state shared by every permutation, request_material only
+  // swaps in the layout, fragment shader and specialization
+  PipelineBuilder m_meshPipelineBuilder;
+  // by features, an entry exists as soon as its jobs are submitted
+  std::unordered_map<MaterialFeatures, MeshPermutation> m_meshPermutations;
+  // persisted to pipeline_cache.bin, every pipeline is created through it
+  PipelineCache m_pipelineCache;
+  // every PipelineBuilder pipeline is built through it and owned by it, so
+  // materials sharing state share pipelines
+  PipelineStateCache m_pipelineStates;
+  void init_pipeline_cache();
   void init_pipelines();
 
+  // pipeline jobs
+  // mesh pipelines are independent jobs on m_compilePool sharing
+  // m_pipelineCache, which the driver synchronizes internally. the render
+  // thread installs finished ones at the start of every frame
+  std::vector<std::unique_ptr<PipelineJob>> m_pipelineJobs;
+  // separate from m_threadPool so simulation steps never queue behind
+  // compiles, half the cores leave the rest to rendering and simulation
+  ThreadPool m_compilePool{std::max(std::thread::hardware_concurrency() / 2,
+                                    1u)};
+  std::chrono::high_resolution_clock::time_point m_pipelinesStart;
+  void submit_pipeline_job(const PipelineBuilder &builder, vk::RenderPass pass,
+                           std::function<void(vk::Pipeline)> &&install);
+  // installs the finished jobs, or all of them after waiting with wait
+  void poll_pipeline_jobs(bool wait);
+
   // depth image
   vk::ImageView m_depthImageView;
   AllocatedImage m_depthImage;
   vk::Format m_depthFormat;
 
+  // hi-z occlusion culling
+  // max depth pyramid built from m_depthImage, first phase tests against the
+  // previous frame's pyramid, second phase retests what the first phase culled
+  // against a pyramid of the first phase's depth
+  // both renderpasses are compatible with m_renderPass
+  vk::RenderPass m_hizFirstRenderPass;
+  vk::RenderPass m_hizSecondRenderPass;
+  AllocatedImage m_hizImage;
+  vk::ImageView m_hizImageView;
+  std::vector<vk::ImageView> m_hizMipViews;
+  vk::Extent2D m_hizExtent;
+  uint32_t m_hizMipCount;
+  vk::Sampler m_hizSampler;
+  vk::DescriptorPool m_hizDescriptorPool;
+  vk::DescriptorSetLayout m_hizReduceSetLayout;
+  vk::DescriptorSetLayout m_hizCullSetLayout;
+  std::vector<vk::DescriptorSet> m_hizReduceSets;
+  vk::PipelineLayout m_hizReduceLayout;
+  vk::PipelineLayout m_hizCullLayout;
+  vk::Pipeline m_hizReducePipeline;
+  vk::Pipeline m_hizCullPipeline;
+  GPUCullStats m_cullStats = {};
+  uint64_t m_cullStatsFrames = 0;
+  void init_hiz();
+  vk::RenderPass create_hiz_renderpass(bool secondPhase);
+  void record_hiz_build(vk::CommandBuffer cmd);
+  void record_hiz_cull(vk::CommandBuffer cmd, uint32_t phase);
+  void draw_hiz_culled(vk::CommandBuffer cmd, vk::Framebuffer framebuffer);
+  void read_cull_stats(FrameData &frame);
+
+  // cpu masked occlusion culling, large renderables are rasterized into a low
+  // resolution buffer on the thread pool and everything is tested against it.
+  // runs as part of the simulation step, the counters below are accumulated
+  // from the packets on the render thread
+  ThreadPool m_threadPool;
+  MaskedOcclusionBuffer m_maskedOcclusion;
+  uint64_t m_softwareCulled = 0;
+  uint64_t m_softwareFrames = 0;
+  double m_softwareRasterMs = 0.;
+  double m_softwareTestMs = 0.;
+  // fills packet.visible from packet.renderables
+  void cull_software_occlusion(FramePacket &packet);
+
   // objects and meshes
   std::vector<RenderObject> m_renderables;
   std::unordered_map<std::string, Material> m_materials;
   std::unordered_map<std::string, Mesh> m_meshes;
   Material *create_material(VkPipeline pipeline, VkPipelineLayout layout,
                             const std::string &name);
+  // a material drawing with the mesh.frag permutation of features, compiles
+  // that permutation on the pool unless another material already did. draws
+  // with the placeholder until it is installed
+  Material *request_material(const std::string &name,
+                             MaterialFeatures features);
   Material *get_material(const std::string &name);
   Mesh *get_mesh(const std::string &name);
-  void draw_objects(vk::CommandBuffer cmd, RenderObject *first, int count);
+  // preparing and recording are split so culling can record the same draws
+  // twice
+  // sorted draws of the current frame, index is the instance/ssbo index
+  std::vector<RenderObject> m_drawList;
+  void prepare_draws(RenderObject *first, int count);
+  void update_camera_scene();
+  void append_sorted_draws(RenderObject *first, int count, bool frontToBack);
+  // object ssbo slot i of a frame from draws[i]
+  void write_object_data(uint32_t frameIndex,
+                         const std::vector<RenderObject> &draws);
+  // indirectBase < 0 records direct draws, otherwise reads instance counts
+  // from the frame's indirect buffer starting at that command. adds what it
+  // recorded to stats
+  void record_draws(vk::CommandBuffer cmd, uint32_t frameIndex,
+                    const std::vector<RenderObject> &draws, int indirectBase,
+                    DrawStats &stats);
+  // of the frame being recorded
+  DrawStats m_drawStats;
+
+  // static renderables recorded once into a secondary per frame slot, they
+  // own object slots [0, m_staticDrawList.size()) of every frame. invalidated
+  // by renderable, material, framebuffer, render scale and config changes
+  std::vector<RenderObject> m_staticDrawList;
+  // what the materials of m_staticDrawList held when it was sorted
+  std::vector<Material> m_staticMaterials;
+  // whether the rebuild saw the depth prepass active, it's recorded with it
+  bool m_staticDepthPrepass = false;
+  DrawStats m_staticDrawStats;
+  bool m_staticCacheDirty = true;
+  // bumped by every rebuild, each slot re-records its secondary when it next
+  // draws, by then the frame that last executed it has finished
+  uint64_t m_staticGeneration = 0;
+  void invalidate_static_commands();
+  // whether a static draw's material or the depth prepass changed pipelines
+  // since the rebuild, e.g. a compile job replaced the placeholder
+  bool static_commands_outdated() const;
+  void rebuild_static_commands();
+  void record_static_commands(uint32_t frameIndex);
+  void draw_static_cached(vk::CommandBuffer cmd);
   Mesh m_triangleMesh;
-  UploadContext m_uploadContext;
+  // used round robin, each has its own pool so an upload never waits on the
+  // one before it unless every context is still in flight
+  std::array<UploadContext, UPLOAD_CONTEXT_COUNT> m_uploadContexts;
+  uint32_t m_uploadContextIndex = 0;
+  // timeline value of the last upload, frames wait on it before rendering
+  uint64_t m_uploadTimelineValue = 0;
   // #utility
   // instantly submit commands to cmd
   void immediate_submit(std::function<void(vk::CommandBuffer cmd)> &&function);
+  // records and submits, only waits when every upload context is in flight.
+  // returns the upload's timeline value
+  uint64_t submit_upload(std::function<void(vk::CommandBuffer cmd)> &&function);
+  // timeline values of uploads the gpu may not have finished yet
+  std::deque<uint64_t> m_pendingUploads;
   void load_meshes();
   void load_obj_mesh(const std::string &path, const std::string &name);
   void upload_mesh(Mesh &mesh);
@@ -214,10 +622,102 @@ private:
   // scene
   void init_scene();
   glm::mat4 m_viewMatrix;
-  GPUSceneData m_sceneParameters;
+  glm::mat4 get_projection_matrix();
+  GPUSceneData m_sceneParameters{};
+
+  // simulation
+  // with m_config.pipelinedSimulation a second thread builds the packet for
+  // frame N + 1 while this one records and submits frame N. the simulation
+  // owns m_viewMatrix, m_sceneParameters, m_renderables and the cpu occlusion
+  // buffer, the render thread only reads m_framePacket
+  TripleBuffer<SimulationInput> m_simulationInputs;
+  TripleBuffer<FramePacket> m_framePackets;
+  // the packet of the frame being recorded, valid for the whole draw()
+  const FramePacket *m_framePacket = nullptr;
+  std::thread m_simulationThread;
+  // the simulation never gets more than one packet ahead, so it steps exactly
+  // once per rendered frame
+  std::atomic<uint64_t> m_packetsPublished = 0;
+  std::atomic<uint64_t> m_packetsConsumed = 0;
+  std::atomic<bool> m_simulationStopping = false;
+  uint64_t m_simulationStep = 0;
+  double m_simulationMs = 0.;
+  double m_recordMs = 0.;
+  uint64_t m_cpuTimingFrames = 0;
+  void start_simulation();
+  void stop_simulation();
+  void simulation_loop();
+  void publish_simulation_input();
+  // one simulation step on the calling thread
+  void produce_frame_packet();
+  void simulate(const SimulationInput &input, FramePacket &packet);
+  // blocks until the simulation has published the next packet
+  const FramePacket &acquire_frame_packet();
+
+  // headless
+  // one offscreen image per frame in flight replaces the swapchain, frames
+  // are never presented and run() renders m_headless.frames frames
+  HeadlessConfig m_headless;
+  std::vector<AllocatedImage> m_offscreenImages;
+  std::vector<FrameTiming> m_frameTimings;
+  void create_offscreen_images();
+  void run_headless();
+  bool write_frame_timings(const std::string &path);
+  bool save_screenshot(uint32_t imageIndex, const std::string &path);
+
+  // camera path replay
+  // recording samples the view of every simulation step, playback sets it
+  // from the path instead of input and restarts the scene animation with
+  // every run. the render thread closes a run when the first packet of the
+  // next one arrives and stops once all runs are done
+  ReplayConfig m_replay;
+  CameraPath m_cameraPath;
+  uint32_t m_replayRun = 0;
+  uint64_t m_replayFrames = 0;
+  uint64_t m_replayDrawCalls = 0;
+  uint64_t m_replayTriangles = 0;
+  std::vector<ReplayMetrics> m_replayRuns;
+  bool m_replayDone = false;
+  bool m_replayRegressed = false;
+  bool replaying() const { return !m_replay.playPath.empty(); }
+  void init_replay();
+  // per frame, before and after recording it
+  void begin_replay_frame(const FramePacket &packet);
+  void end_replay_frame();
+  void finish_replay_run();
+  // writes the report and compares it against the baseline
+  void finish_replay();
+
+  // frame pacing
+  // the limiter runs before the latency wait, which runs before input is
+  // sampled, so the frame is built from input as fresh as the gpu allows
+  FramePacer m_framePacer;
+  FramePacer::Clock::time_point m_inputSampleTime;
+  void wait_for_frame_latency();
+  // records input to completion latency of every finished frame, measured
+  // when its timeline value is first seen reached, so it's an upper bound
+  // that excludes the compositor and scanout
+  void collect_frame_latencies();
+  void set_present_mode(vk::PresentModeKHR presentMode);
+  void log_frame_pacing();
+
+  // hud
+  // dear imgui overlay in its own pass after the upscale, windowed only.
+  // while m_config.hud is off nothing is built, recorded or fed events
+  vk::DescriptorPool m_hudDescriptorPool;
+  vk::RenderPass m_hudRenderPass;
+  HudGraph m_hudFrameGraph;
+  HudGraph m_hudGpuGraph;
+  FramePacer::Clock::time_point m_hudLastFrame;
+  // last frame's hi-z counters, the totals above are per log interval
+  GPUCullStats m_lastCullStats = {};
+  void init_hud();
+  void build_hud();
+  void record_hud(vk::CommandBuffer cmd, uint32_t swapchainImageIndex);
 
   // input
   Inputs m_inputs;
+  // held keys move the camera as part of the simulation step
   void input_handle_keydown(SDL_Scancode &key);
   void input_handle_keyup(SDL_Scancode &key);
 };
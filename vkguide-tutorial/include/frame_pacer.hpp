@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace vkr {
+
+struct FramePercentiles {
+  double p50 = 0.;
+  double p95 = 0.;
+  double p99 = 0.;
+  double max = 0.;
+  size_t samples = 0;
+};
+
+// cpu side frame limiter plus rolling frame time and latency statistics
+// the limiter sleeps until shortly before the deadline and spins the rest,
+// since os sleeps routinely overshoot by a millisecond or more
+class FramePacer {
+public:
+  using Clock = std::chrono::steady_clock;
+  // samples kept for the percentiles
+  static constexpr size_t HISTORY_SIZE = 4096;
+
+  // 0 disables the limiter
+  void set_target_fps(double fps);
+  double target_fps() const { return m_targetFps; }
+  // blocks until the next frame slot. deadlines advance by whole periods, so
+  // a slightly late frame doesn't shift the cadence and a very late one
+  // restarts it instead of letting the next frames run fast to catch up
+  void wait_for_next_frame();
+
+  // once per presented frame, the time between calls is the frame time
+  void record_frame(Clock::time_point now = Clock::now());
+  void record_latency(double ms);
+
+  FramePercentiles frame_time_percentiles() const;
+  FramePercentiles latency_percentiles() const;
+  void reset_stats();
+  // one row of percentiles per metric, in ms
+  bool write_csv(const std::string &path) const;
+
+private:
+  static void push_sample(std::vector<double> &history, size_t &next,
+                          double sample);
+  static FramePercentiles percentiles(std::vector<double> samples);
+
+  double m_targetFps = 0.;
+  Clock::duration m_period{};
+  Clock::time_point m_deadline{};
+  // remaining time below which the limiter stops sleeping and spins
+  Clock::duration m_spinThreshold = std::chrono::microseconds(1500);
+
+  Clock::time_point m_lastFrame{};
+  // ring buffers of the last HISTORY_SIZE samples
+  std::vector<double> m_frameTimesMs;
+  std::vector<double> m_latenciesMs;
+  size_t m_frameTimeNext = 0;
+  size_t m_latencyNext = 0;
+};
+
+} // namespace vkr
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace vkr {
+
+// the gpu time of every frame, plus with tracing named gpu timestamp scopes
+// and cpu scopes on one timeline, exported as a chrome trace (chrome://tracing
+// or ui.perfetto.dev)
+// gpu work is recorded into slots, one per frame in flight plus any other
+// queue of work like uploads. a slot is collected right before it's reused,
+// when the caller already waited for its previous work, so reading results
+// never stalls. scope queries are reset from the host, which needs
+// hostQueryReset, frame queries from the command buffer
+class GpuProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr uint32_t MAX_SCOPES = 64;
+  // ~32MB, recording stops once full
+  static constexpr size_t MAX_EVENTS = 1 << 20;
+
+  // timestampValidBits of the queue the slots are submitted to, 0 disables
+  // frame timing
+  void init(vk::Device device, float timestampPeriod,
+            uint32_t timestampValidBits, uint32_t slotCount, bool tracing);
+  void destroy();
+  // whether scopes are traced, frame timing is always on
+  bool enabled() const { return m_tracing; }
+
+  // reads back the slot's previous frame and scopes and resets its scope
+  // queries, the work they were recorded in has to be complete. returns the
+  // gpu time of the frame in ms, negative if the slot has none
+  double collect(uint32_t slot);
+  // around all of a frame's commands, outside of any renderpass. traced as
+  // the frame scope
+  void begin_frame(vk::CommandBuffer cmd, uint32_t slot);
+  void end_frame(vk::CommandBuffer cmd, uint32_t slot);
+  // right before the slot's work is submitted. gpu work never starts before
+  // its submit, which is what anchors gpu timestamps on the cpu timeline
+  void mark_submit(uint32_t slot, Clock::time_point submitTime = Clock::now());
+
+  // scopes nest by time, an end must follow its begin in the same slot
+  uint32_t begin_gpu_scope(vk::CommandBuffer cmd, uint32_t slot,
+                           const char *name);
+  void end_gpu_scope(vk::CommandBuffer cmd, uint32_t slot, uint32_t scope);
+  // thread safe
+  void record_cpu_scope(const char *name, Clock::time_point begin,
+                        Clock::time_point end);
+  void set_thread_name(const std::string &name);
+
+  bool write_chrome_trace(const std::string &path);
+
+  // gpu time of every scope collected since the last reset, the same name
+  // used from different files may show up more than once
+  struct ScopeTime {
+    const char *name;
+    double totalMs = 0.;
+    uint64_t count = 0;
+  };
+  std::vector<ScopeTime> gpu_scope_times();
+  void reset_gpu_scope_times();
+
+private:
+  struct PendingScope {
+    const char *name;
+    // begin query, the end query follows it
+    uint32_t query;
+  };
+  struct Slot {
+    std::vector<PendingScope> scopes;
+    bool frameWritten = false;
+    Clock::time_point submitTime;
+    bool submitted = false;
+  };
+  struct TraceEvent {
+    const char *name;
+    // 0 is the gpu, everything else a cpu thread
+    uint32_t track;
+    // gpu events are in gpu nanoseconds until export
+    int64_t beginNs;
+    int64_t endNs;
+  };
+
+  // both with m_mutex held
+  uint32_t thread_track();
+  void push_event(const TraceEvent &event);
+  // only the low timestampValidBits of a timestamp are defined, the
+  // difference of masked ticks wraps correctly
+  int64_t ticks_to_ns(uint64_t ticks) const;
+  uint64_t elapsed_ticks(uint64_t begin, uint64_t end) const;
+  // the begin query, the end query follows it
+  uint32_t frame_query(uint32_t slot) const;
+
+  vk::Device m_device;
+  vk::QueryPool m_queryPool;
+  float m_timestampPeriod = 1.f;
+  uint64_t m_timestampMask = 0;
+  bool m_tracing = false;
+  std::vector<Slot> m_slots;
+  std::vector<uint64_t> m_ticks;
+  Clock::time_point m_epoch = Clock::now();
+  // largest submit to first timestamp difference seen, the frame that
+  // started executing soonest after its submit pins the gpu clock best
+  int64_t m_gpuToCpuNs = 0;
+  bool m_haveGpuOffset = false;
+
+  std::mutex m_mutex;
+  std::vector<TraceEvent> m_events;
+  std::unordered_map<std::thread::id, uint32_t> m_threadTracks;
+  std::vector<std::string> m_trackNames = {"gpu"};
+  std::unordered_map<const char *, ScopeTime> m_scopeTimes;
+};
+
+// raii wrappers, both do nothing while the profiler is disabled
+class GpuScope {
+public:
+  GpuScope(GpuProfiler &profiler, vk::CommandBuffer cmd, uint32_t slot,
+           const char *name)
+      : m_profiler(profiler), m_cmd(cmd), m_slot(slot),
+        m_scope(profiler.begin_gpu_scope(cmd, slot, name)) {}
+  ~GpuScope() { m_profiler.end_gpu_scope(m_cmd, m_slot, m_scope); }
+  GpuScope(const GpuScope &) = delete;
+  GpuScope &operator=(const GpuScope &) = delete;
+
+private:
+  GpuProfiler &m_profiler;
+  vk::CommandBuffer m_cmd;
+  uint32_t m_slot;
+  uint32_t m_scope;
+};
+
+class CpuScope {
+public:
+  CpuScope(GpuProfiler &profiler, const char *name)
+      : m_profiler(profiler), m_name(name),
+        m_begin(GpuProfiler::Clock::now()) {}
+  ~CpuScope() {
+    m_profiler.record_cpu_scope(m_name, m_begin, GpuProfiler::Clock::now());
+  }
+  CpuScope(const CpuScope &) = delete;
+  CpuScope &operator=(const CpuScope &) = delete;
+
+private:
+  GpuProfiler &m_profiler;
+  const char *m_name;
+  GpuProfiler::Clock::time_point m_begin;
+};
+
+} // namespace vkr
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "thread_pool.hpp"
+
+namespace vkr {
+
+// low resolution cpu depth buffer for occlusion culling
+// every 32x8 tile keeps one coverage bit per pixel and two conservative max
+// depths: zMax0 bounds every pixel of the tile, zMax1 bounds the pixels in the
+// coverage mask. once the mask is full zMax1 becomes the new zMax0 (masked
+// occlusion culling, Andersson et al. 2015)
+// depth is clip z / w, smaller is nearer
+class MaskedOcclusionBuffer {
+public:
+  static constexpr uint32_t TILE_WIDTH = 32;
+  static constexpr uint32_t TILE_HEIGHT = 8;
+
+  MaskedOcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+
+  // rounded up to whole tiles
+  void resize(uint32_t width, uint32_t height);
+  void clear();
+
+  // projects and sets up the triangles, nothing is rasterized until
+  // rasterize(). triangles crossing the camera plane are dropped, which is
+  // conservative for an occluder
+  void add_occluder(const glm::mat4 &modelViewProj, const glm::vec3 *vertices,
+                    size_t vertexCount, const uint32_t *indices,
+                    size_t indexCount);
+  // rasterizes every queued triangle, one band of tile rows per worker
+  void rasterize(ThreadPool *pool = nullptr);
+
+  // ndc rect at its nearest depth, false if fully hidden or off screen
+  bool test_rect(glm::vec2 ndcMin, glm::vec2 ndcMax, float nearestDepth) const;
+  // world space sphere, false if outside the frustum or fully hidden
+  bool test_sphere(const glm::mat4 &viewProj, const glm::vec4 &sphere) const;
+
+  uint32_t width() const { return m_width; }
+  uint32_t height() const { return m_height; }
+  size_t triangle_count() const { return m_triangles.size(); }
+
+private:
+  struct Tile {
+    uint32_t mask[TILE_HEIGHT];
+    float zMax0;
+    float zMax1;
+  };
+
+  // screen space, counter clockwise
+  struct Triangle {
+    glm::vec2 v[3];
+    float zMax;
+    uint32_t tileMinX, tileMaxX, tileMinY, tileMaxY;
+  };
+
+  void rasterize_rows(uint32_t tileRowBegin, uint32_t tileRowEnd);
+  void rasterize_tile(const Triangle &triangle, const float edges[3][3],
+                      uint32_t tileX, uint32_t tileY);
+
+  uint32_t m_width = 0, m_height = 0;
+  uint32_t m_tilesX = 0, m_tilesY = 0;
+  std::vector<Tile> m_tiles;
+  std::vector<Triangle> m_triangles;
+  std::vector<glm::vec4> m_clipScratch;
+};
+
+} // namespace vkr
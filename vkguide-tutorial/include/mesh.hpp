@@ -23,6 +23,8 @@ struct Vertex {
   glm::vec2 uv;
 
   static VertexInputDescription get_vertex_description();
+  // same binding, only the position attribute (depth only passes)
+  static VertexInputDescription get_position_vertex_description();
   bool operator==(const Vertex &rhs) const = default;
 };
 
@@ -45,7 +47,22 @@ struct Mesh {
   // [vertices | indices]
   AllocatedBuffer combinedVertexBuffer;
 
+  // object space bounding sphere, xyz center w radius
+  glm::vec4 bounds = glm::vec4(0.);
+  void compute_bounds();
+  // bounds under transform, radius scaled by its largest axis scale
+  glm::vec4 world_bounds(const glm::mat4 &transform) const;
+
+  // positions only copy for the cpu occlusion buffer, at most maxTriangles of
+  // the mesh's own triangles with the largest kept, so it never covers more
+  // than the mesh
+  std::vector<glm::vec3> occluderVertices;
+  std::vector<uint32_t> occluderIndices;
+  void build_occluder(uint32_t maxTriangles);
+
   static std::optional<Mesh> load_from_obj(const char *fileName);
+  // indexes an unindexed triangle list, identical vertices are stored once
+  static Mesh from_triangles(const std::vector<Vertex> &triangleVertices);
 };
 
 struct MeshPushConstants {
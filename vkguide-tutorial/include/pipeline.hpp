@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
@@ -8,6 +13,8 @@
 #include <vulkan/vulkan_structs.hpp>
 
 namespace vkr {
+class PipelineStateCache;
+
 class PipelineBuilder {
 public:
   std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
@@ -15,13 +22,24 @@ public:
   vk::PipelineInputAssemblyStateCreateInfo inputAssembly;
   vk::Viewport viewport;
   vk::Rect2D scissor;
+  // viewport and scissor are ignored when listed here
+  std::vector<vk::DynamicState> dynamicStates;
   vk::PipelineRasterizationStateCreateInfo rasterizer;
   vk::PipelineColorBlendAttachmentState colorBlendAttachment;
   vk::PipelineMultisampleStateCreateInfo multisampling;
   vk::PipelineDepthStencilStateCreateInfo depthStencil;
   vk::PipelineLayout pipelineLayout;
 
-  vk::Pipeline build(vk::Device device, vk::RenderPass pass);
+  // always creates a new pipeline, owned by the caller
+  vk::Pipeline build(vk::Device device, vk::RenderPass pass,
+                     vk::PipelineCache cache = {}) const;
+  // the pipeline states already built, see PipelineStateCache
+  vk::Pipeline build(PipelineStateCache &states, vk::RenderPass pass) const;
+
+  // every piece of state that ends up in the pipeline as bytes, equal keys
+  // build interchangeable pipelines. handles are compared by value, so
+  // modules, layouts and render passes have to be the same objects
+  std::string state_key(vk::RenderPass pass) const;
 
   static vk::PipelineShaderStageCreateInfo
   default_pipeline_shader_stage_create_info(vk::ShaderStageFlagBits stage,
@@ -49,4 +67,33 @@ public:
 
 private:
 };
+
+// builds each distinct pipeline state once and hands out the same pipeline
+// for every later builder with an equal state_key. owns what it built until
+// destroy(). safe to call from pipeline jobs, a build racing another of the
+// same state waits for it instead of compiling twice
+class PipelineStateCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // distinct pipelines, including ones still compiling
+    size_t live = 0;
+  };
+
+  void init(vk::Device device, vk::PipelineCache cache);
+  // no build may be in flight
+  void destroy();
+
+  vk::Pipeline get(const PipelineBuilder &builder, vk::RenderPass pass);
+  Stats stats() const;
+
+private:
+  vk::Device m_device;
+  vk::PipelineCache m_cache;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, std::shared_future<vk::Pipeline>>
+      m_pipelines;
+  Stats m_stats;
+};
 }; // namespace vkr
\ No newline at end of file
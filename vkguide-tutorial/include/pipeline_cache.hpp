@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+namespace vkr {
+
+// vk::PipelineCache persisted between runs, so pipelines compiled once are
+// loaded from the driver's cache instead of from spir-v on the next launch
+// the file starts with our own header, since a driver handed data from
+// another device or driver version may crash instead of rejecting it. stale
+// or corrupt files are ignored and overwritten on the next save
+class PipelineCache {
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr std::chrono::seconds SAVE_INTERVAL{60};
+
+  void init(vk::Device device, const vk::PhysicalDeviceProperties &properties,
+            std::string path);
+  void destroy();
+
+  vk::PipelineCache handle() const { return m_cache; }
+  // whether init loaded data from disk
+  bool warm() const { return m_warm; }
+
+  // writes a temporary file and renames it over the old one, so a crash
+  // mid save never leaves a truncated cache. skipped when the cache didn't
+  // grow since the last save
+  bool save();
+  // save() at most every SAVE_INTERVAL, cheap enough to call every frame
+  void save_periodically(Clock::time_point now = Clock::now());
+
+private:
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t dataHash;
+  };
+
+  FileHeader expected_header() const;
+  bool matches_device(const std::vector<uint8_t> &data) const;
+
+  vk::Device m_device;
+  vk::PhysicalDeviceProperties m_properties;
+  std::string m_path;
+  vk::PipelineCache m_cache;
+  bool m_warm = false;
+  size_t m_savedSize = 0;
+  Clock::time_point m_lastSave;
+};
+
+} // namespace vkr
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace vkr {
+
+// one named measurement of a camera path run, lower is always better
+struct ReplayMetric {
+  std::string name;
+  double value = 0.;
+};
+using ReplayMetrics = std::vector<ReplayMetric>;
+
+struct ReplayRegression {
+  std::string name;
+  double baseline = 0.;
+  double current = 0.;
+  // relative to the baseline, 0.1 is 10% worse
+  double change = 0.;
+};
+
+// per metric median of several runs of the same path, so one run hitching on
+// a shader compile or a background process doesn't move the result. metrics
+// are taken in the order of the first run
+ReplayMetrics median_metrics(const std::vector<ReplayMetrics> &runs);
+
+// csv, one row per metric with the median, min, max and every run
+bool write_replay_report(const std::string &path,
+                         const std::vector<ReplayMetrics> &runs);
+// the medians of a report written by write_replay_report
+std::optional<ReplayMetrics> read_replay_report(const std::string &path);
+
+// metrics that got worse than the baseline by more than tolerance, 0.05
+// allows 5%. metrics missing from either side or zero in the baseline can't
+// regress
+std::vector<ReplayRegression> compare_replay_metrics(
+    const ReplayMetrics &baseline, const ReplayMetrics &current,
+    double tolerance);
+
+} // namespace vkr
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+namespace vkr {
+
+// optional parts of mesh.frag, bit i is its specialization constant i
+enum MaterialFeatureBits : uint32_t {
+  MATERIAL_TEXTURED = 1 << 0,
+  MATERIAL_LIT = 1 << 1,
+  MATERIAL_FOG = 1 << 2,
+  MATERIAL_VERTEX_COLOR = 1 << 3,
+};
+using MaterialFeatures = uint32_t;
+constexpr uint32_t MATERIAL_FEATURE_COUNT = 4;
+constexpr MaterialFeatures MATERIAL_FEATURE_MASK =
+    (1u << MATERIAL_FEATURE_COUNT) - 1;
+
+// the constants selecting one permutation of mesh.frag. points into static
+// storage, so pipeline jobs can keep it past the call
+const vk::SpecializationInfo *mesh_specialization(MaterialFeatures features);
+
+// e.g. "textured|lit", for logs
+std::string material_features_name(MaterialFeatures features);
+
+} // namespace vkr
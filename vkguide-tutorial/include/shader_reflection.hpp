@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace vkr {
+
+struct ReflectedBinding {
+  uint32_t binding;
+  vk::DescriptorType type;
+  // 0 for a runtime sized array, e.g. the bindless textures
+  uint32_t count;
+  vk::ShaderStageFlags stages;
+};
+
+// the descriptor and push constant interface of one or more shader modules
+struct ShaderReflection {
+  vk::ShaderStageFlags stages;
+  // by set index, each sorted by binding
+  std::map<uint32_t, std::vector<ReflectedBinding>> sets;
+  // one range from offset 0, what every shader here declares
+  uint32_t pushConstantSize = 0;
+  vk::ShaderStageFlags pushConstantStages;
+
+  // adds the bindings of other, the stages of a binding both declare are
+  // combined. throws when they disagree on its type or count
+  void merge(const ShaderReflection &other);
+  // spir-v can't tell a dynamic uniform buffer from a plain one. throws when
+  // the binding doesn't exist
+  void override_type(uint32_t set, uint32_t binding, vk::DescriptorType type);
+  std::vector<vk::PushConstantRange> push_constant_ranges() const;
+};
+
+// reads the resource variables of a module, throws std::runtime_error on
+// malformed spir-v
+ShaderReflection reflect_spirv(const uint32_t *code, size_t wordCount);
+
+// hands out one descriptor set layout per distinct set of bindings and one
+// pipeline layout per distinct list of set layouts and push constants, so
+// pipelines from different shaders end up with compatible layouts and bound
+// sets survive pipeline switches. owns every layout until destroy(), render
+// thread only
+class LayoutCache {
+public:
+  // runtime sized arrays get runtimeArraySize descriptors, partially bound
+  // and update after bind, and must be the last binding of their set
+  void init(vk::Device device, uint32_t runtimeArraySize);
+  void destroy();
+
+  vk::DescriptorSetLayout
+  set_layout(const std::vector<ReflectedBinding> &bindings);
+  vk::PipelineLayout
+  pipeline_layout(const std::vector<vk::DescriptorSetLayout> &setLayouts,
+                  const std::vector<vk::PushConstantRange> &pushConstants);
+  // sets the shaders skip get an empty layout
+  vk::PipelineLayout pipeline_layout(const ShaderReflection &reflection);
+
+  size_t set_layout_count() const { return m_setLayouts.size(); }
+  size_t pipeline_layout_count() const { return m_pipelineLayouts.size(); }
+
+private:
+  vk::Device m_device;
+  uint32_t m_runtimeArraySize = 0;
+  std::unordered_map<std::string, vk::DescriptorSetLayout> m_setLayouts;
+  std::unordered_map<std::string, vk::PipelineLayout> m_pipelineLayouts;
+};
+
+} // namespace vkr
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vkr {
+
+// fixed set of workers pulling from one fifo queue
+class ThreadPool {
+public:
+  explicit ThreadPool(
+      uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u));
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  std::future<void> submit(std::function<void()> &&task);
+  // splits [0, count) into one range per worker, runs one range on the calling
+  // thread and returns once all of them are done
+  void parallel_for(uint32_t count,
+                    const std::function<void(uint32_t, uint32_t)> &function);
+  uint32_t size() const { return m_workers.size(); }
+
+private:
+  std::vector<std::thread> m_workers;
+  std::deque<std::packaged_task<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stopping = false;
+};
+
+} // namespace vkr
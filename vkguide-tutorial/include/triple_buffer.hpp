@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace vkr {
+
+// lock-free single producer single consumer handoff. the producer always has
+// a slot of its own to write and the consumer always reads the most recently
+// published one, neither ever waits on the other. slots are reused, so
+// containers inside T keep their capacity across frames
+template <typename T> class TripleBuffer {
+public:
+  // producer side, the slot stays private until publish()
+  T &write_buffer() { return m_slots[m_back]; }
+  void publish() {
+    // hand the written slot over and take back whatever was in the middle
+    uint8_t previous =
+        m_middle.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel);
+    m_back = previous & INDEX_MASK;
+  }
+
+  // consumer side, the newest published slot, or the previous one again if
+  // nothing was published since. valid until the next read()
+  const T &read() {
+    if (m_middle.load(std::memory_order_relaxed) & FRESH_BIT) {
+      uint8_t previous =
+          m_middle.exchange(m_front, std::memory_order_acq_rel);
+      m_front = previous & INDEX_MASK;
+    }
+    return m_slots[m_front];
+  }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 3;
+  static constexpr uint8_t FRESH_BIT = 4;
+
+  std::array<T, 3> m_slots;
+  // only touched by the consumer
+  uint8_t m_front = 0;
+  // only touched by the producer
+  uint8_t m_back = 1;
+  // slot index plus whether it was published since the consumer last read
+  std::atomic<uint8_t> m_middle = 2;
+};
+
+} // namespace vkr
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vkr {
+
+struct ZoneSummary {
+  std::string name;
+  // per call, in ms
+  double mean = 0.;
+  double p50 = 0.;
+  double p99 = 0.;
+  double callsPerFrame = 0.;
+};
+
+// cpu zones that cost a couple of clock reads and one ring buffer write
+// each thread records into its own single producer ring, registered on its
+// first zone, so recording never locks. a collector thread drains the rings
+// and summarizes the zones that ended within each window of frames
+class ZoneProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+  // per thread, zones are dropped while the collector is behind
+  static constexpr size_t RING_SIZE = 1 << 14;
+  static constexpr uint64_t FRAMES_PER_SUMMARY = 500;
+
+  static ZoneProfiler &instance();
+
+  void start();
+  void stop();
+
+  // lock free, safe from any thread
+  void record(const char *name, Clock::time_point begin,
+              Clock::time_point end);
+  // once per frame from the render thread, closes a window every
+  // FRAMES_PER_SUMMARY frames
+  void frame_mark(Clock::time_point now = Clock::now());
+
+  // the last closed window, sorted by total time
+  std::vector<ZoneSummary> last_summary();
+
+private:
+  struct ZoneRecord {
+    const char *name;
+    int64_t beginNs;
+    int64_t endNs;
+  };
+  struct ZoneRing {
+    std::array<ZoneRecord, RING_SIZE> records;
+    // written by the owning thread only
+    std::atomic<uint64_t> head = 0;
+    // written by the collector only
+    std::atomic<uint64_t> tail = 0;
+    std::atomic<uint64_t> dropped = 0;
+  };
+
+  ZoneRing &thread_ring();
+  void collect_loop();
+  void drain_rings();
+  void summarize(int64_t windowEndNs, uint64_t frames);
+
+  Clock::time_point m_epoch = Clock::now();
+
+  // registration is the only locked part of recording, once per thread
+  std::mutex m_ringsMutex;
+  std::vector<std::unique_ptr<ZoneRing>> m_rings;
+
+  uint64_t m_frames = 0;
+  std::atomic<int64_t> m_windowEndNs = 0;
+  std::atomic<uint64_t> m_windowsClosed = 0;
+
+  // collector side
+  std::thread m_collector;
+  std::mutex m_stopMutex;
+  std::condition_variable m_stopCondition;
+  bool m_stopping = false;
+  uint64_t m_windowsSummarized = 0;
+  std::vector<ZoneRecord> m_pending;
+
+  std::mutex m_summaryMutex;
+  std::vector<ZoneSummary> m_summary;
+};
+
+class ZoneTimer {
+public:
+  explicit ZoneTimer(const char *name)
+      : m_name(name), m_begin(ZoneProfiler::Clock::now()) {}
+  ~ZoneTimer() {
+    ZoneProfiler::instance().record(m_name, m_begin,
+                                    ZoneProfiler::Clock::now());
+  }
+  ZoneTimer(const ZoneTimer &) = delete;
+  ZoneTimer &operator=(const ZoneTimer &) = delete;
+
+private:
+  const char *m_name;
+  ZoneProfiler::Clock::time_point m_begin;
+};
+
+} // namespace vkr
+
+// VKR_PROFILING is set by the build unless zone_profiling is disabled, or
+// left on auto in a release build. without it zones compile to nothing
+#ifdef VKR_PROFILING
+#define VKR_ZONE_CONCAT_INNER(a, b) a##b
+#define VKR_ZONE_CONCAT(a, b) VKR_ZONE_CONCAT_INNER(a, b)
+// times the rest of the enclosing scope, name has to be a string literal
+#define VKR_ZONE(name)                                                         \
+  ::vkr::ZoneTimer VKR_ZONE_CONCAT(vkrZone, __LINE__)(name)
+#define VKR_FRAME_MARK() ::vkr::ZoneProfiler::instance().frame_mark()
+#else
+#define VKR_ZONE(name) ((void)0)
+#define VKR_FRAME_MARK() ((void)0)
+#endif
@@ -0,0 +1,89 @@
+#include "camera_path.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace vkr {
+
+namespace {
+
+constexpr const char *MAGIC = "vkr_camera_path";
+constexpr uint32_t VERSION = 1;
+
+} // namespace
+
+void CameraPath::record(uint64_t step, const glm::mat4 &view) {
+  if (m_keyframes.empty() || m_keyframes.back().view != view) {
+    m_keyframes.push_back({step, view});
+  }
+  m_length = std::max(m_length, step + 1);
+}
+
+glm::mat4 CameraPath::view_at(uint64_t step) const {
+  if (m_keyframes.empty()) {
+    return glm::mat4(1.f);
+  }
+  auto it = std::upper_bound(
+      m_keyframes.begin(), m_keyframes.end(), step,
+      [](uint64_t step, const Keyframe &key) { return step < key.step; });
+  // steps before the first keyframe use it too
+  return it == m_keyframes.begin() ? it->view : std::prev(it)->view;
+}
+
+bool CameraPath::save(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file) {
+    return false;
+  }
+  // enough digits that a loaded float is the one that was saved
+  file << std::setprecision(std::numeric_limits<float>::max_digits10);
+  file << MAGIC << " " << VERSION << " " << m_length << "\n";
+  for (const Keyframe &key : m_keyframes) {
+    file << key.step;
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        file << " " << key.view[column][row];
+      }
+    }
+    file << "\n";
+  }
+  return file.good();
+}
+
+bool CameraPath::load(const std::string &path) {
+  std::ifstream file(path);
+  std::string magic;
+  uint32_t version = 0;
+  uint64_t length = 0;
+  if (!(file >> magic >> version >> length) || magic != MAGIC ||
+      version != VERSION) {
+    return false;
+  }
+
+  std::vector<Keyframe> keyframes;
+  Keyframe key;
+  while (file >> key.step) {
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        file >> key.view[column][row];
+      }
+    }
+    // keyframes have to be in step order for view_at
+    if (!file ||
+        (!keyframes.empty() && key.step <= keyframes.back().step)) {
+      return false;
+    }
+    keyframes.push_back(key);
+  }
+  if (!file.eof() || keyframes.empty()) {
+    return false;
+  }
+
+  m_keyframes = std::move(keyframes);
+  m_length = std::max(length, m_keyframes.back().step + 1);
+  return true;
+}
+
+} // namespace vkr
@@ -0,0 +1,134 @@
+#include "device_capabilities.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace vkr {
+
+const char *capability_tier_name(CapabilityTier tier) {
+  switch (tier) {
+  case CapabilityTier::Baseline:
+    return "baseline";
+  case CapabilityTier::GpuDriven:
+    return "gpu driven";
+  case CapabilityTier::Advanced:
+    return "advanced";
+  }
+  return "unknown";
+}
+
+bool DeviceCapabilities::meets_baseline() const {
+  return timelineSemaphore && dynamicRendering && shaderDrawParameters;
+}
+
+CapabilityTier DeviceCapabilities::tier() const {
+  if (!descriptorIndexing || !drawIndirectFirstInstance) {
+    return CapabilityTier::Baseline;
+  }
+  if (!meshShader || !rayTracing) {
+    return CapabilityTier::GpuDriven;
+  }
+  return CapabilityTier::Advanced;
+}
+
+uint32_t DeviceCapabilities::score() const {
+  uint32_t score = 0;
+  switch (type) {
+  case vk::PhysicalDeviceType::eDiscreteGpu:
+    score += 4000;
+    break;
+  case vk::PhysicalDeviceType::eIntegratedGpu:
+    score += 3000;
+    break;
+  case vk::PhysicalDeviceType::eVirtualGpu:
+    score += 2000;
+    break;
+  case vk::PhysicalDeviceType::eCpu:
+    score += 1000;
+    break;
+  default:
+    break;
+  }
+  // capabilities with a path in the renderer outweigh the unused ones
+  score += 100 * (descriptorIndexing + drawIndirectFirstInstance +
+                  pipelineStatistics + inheritedQueries + hostQueryReset);
+  score += 10 * (drawIndirectCount + meshShader + rayTracing);
+  return score;
+}
+
+std::string DeviceCapabilities::report() const {
+  auto line = [](std::ostringstream &out, const char *name, bool supported,
+                 const char *use) {
+    out << "\n  " << name << ": " << (supported ? "yes" : "no") << " (" << use
+        << ")";
+  };
+  std::ostringstream out;
+  out << name << ", " << vk::to_string(type) << ", tier "
+      << capability_tier_name(tier()) << ", score " << score();
+  line(out, "timeline semaphores", timelineSemaphore, "required");
+  line(out, "dynamic rendering", dynamicRendering, "required");
+  line(out, "shader draw parameters", shaderDrawParameters, "required");
+  line(out, "descriptor indexing", descriptorIndexing,
+       "bindless textures, else a descriptor set per material");
+  line(out, "draw indirect first instance", drawIndirectFirstInstance,
+       "hi-z occlusion culling, else cpu culling only");
+  line(out, "draw indirect count", drawIndirectCount, "unused");
+  line(out, "pipeline statistics", pipelineStatistics,
+       "fragment invocation counts");
+  line(out, "inherited queries", inheritedQueries,
+       "statistics across cached secondaries");
+  line(out, "host query reset", hostQueryReset, "gpu profiler");
+  line(out, "mesh shaders", meshShader, "unused");
+  line(out, "ray tracing", rayTracing, "unused");
+  return out.str();
+}
+
+DeviceCapabilities query_device_capabilities(vk::PhysicalDevice device) {
+  DeviceCapabilities caps;
+  vk::PhysicalDeviceProperties properties = device.getProperties();
+  caps.name = properties.deviceName.data();
+  caps.type = properties.deviceType;
+
+  auto extensions = device.enumerateDeviceExtensionProperties();
+  auto hasExtension = [&](const char *name) {
+    return std::any_of(extensions.begin(), extensions.end(),
+                       [&](const vk::ExtensionProperties &extension) {
+                         return std::string(extension.extensionName.data()) ==
+                                name;
+                       });
+  };
+
+  // only core structures, extension structures may only be chained when the
+  // extension is supported
+  auto chain = device.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                   vk::PhysicalDeviceVulkan11Features,
+                                   vk::PhysicalDeviceVulkan12Features,
+                                   vk::PhysicalDeviceVulkan13Features>();
+  const auto &features = chain.get<vk::PhysicalDeviceFeatures2>().features;
+  const auto &features11 = chain.get<vk::PhysicalDeviceVulkan11Features>();
+  const auto &features12 = chain.get<vk::PhysicalDeviceVulkan12Features>();
+  const auto &features13 = chain.get<vk::PhysicalDeviceVulkan13Features>();
+
+  caps.timelineSemaphore = features12.timelineSemaphore;
+  caps.dynamicRendering = features13.dynamicRendering;
+  caps.shaderDrawParameters = features11.shaderDrawParameters;
+  caps.descriptorIndexing =
+      features12.descriptorIndexing && features12.runtimeDescriptorArray &&
+      features12.shaderSampledImageArrayNonUniformIndexing &&
+      features12.descriptorBindingPartiallyBound &&
+      features12.descriptorBindingVariableDescriptorCount &&
+      features12.descriptorBindingSampledImageUpdateAfterBind;
+  caps.drawIndirectFirstInstance = features.drawIndirectFirstInstance;
+  caps.drawIndirectCount = features12.drawIndirectCount;
+  caps.pipelineStatistics = features.pipelineStatisticsQuery;
+  caps.inheritedQueries = features.inheritedQueries;
+  caps.hostQueryReset = features12.hostQueryReset;
+  caps.meshShader = hasExtension(VK_EXT_MESH_SHADER_EXTENSION_NAME) ||
+                    hasExtension(VK_NV_MESH_SHADER_EXTENSION_NAME);
+  caps.rayTracing =
+      hasExtension(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME) &&
+      hasExtension(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME);
+  return caps;
+}
+
+} // namespace vkr
@@ -0,0 +1,48 @@
+#include "dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vkr {
+
+DynamicResolution::DynamicResolution(double budgetMs, float minScale,
+                                     float maxScale, float step)
+    : m_budgetMs(budgetMs), m_minScale(minScale), m_maxScale(maxScale),
+      m_step(step), m_scale(maxScale) {}
+
+bool DynamicResolution::update(double gpuFrameMs) {
+  if (gpuFrameMs <= 0.) {
+    return false;
+  }
+  m_smoothedMs = m_smoothedMs > 0.
+                     ? m_smoothedMs + (gpuFrameMs - m_smoothedMs) * SMOOTHING
+                     : gpuFrameMs;
+  if (++m_framesSinceChange < SETTLE_FRAMES) {
+    return false;
+  }
+
+  // pixel count is scale squared
+  double ideal = m_scale * std::sqrt(m_budgetMs * HEADROOM / m_smoothedMs);
+  float next = std::round(ideal / m_step) * m_step;
+  // drop as far as needed at once, but only climb one step at a time since an
+  // overshoot up costs frames
+  next = std::min(next, m_scale + m_step);
+  next = std::clamp(next, m_minScale, m_maxScale);
+  if (std::abs(next - m_scale) < m_step * 0.5f) {
+    return false;
+  }
+
+  // the average describes the old scale, restart it
+  m_scale = next;
+  m_smoothedMs = 0.;
+  m_framesSinceChange = 0;
+  return true;
+}
+
+void DynamicResolution::reset(float scale) {
+  m_scale = std::clamp(scale, m_minScale, m_maxScale);
+  m_smoothedMs = 0.;
+  m_framesSinceChange = 0;
+}
+
+} // namespace vkr
@@ -7,6 +7,7 @@
 #include <SDL_vulkan.h>
 
 #include <glm/common.hpp>
+#include <imgui_impl_sdl.h>
 
 #include "constants.h"
 #include "engine.hpp"
@@ -15,14 +16,27 @@
 namespace vkr {
 
 void VulkanEngine::run() {
+  if (m_headless.enabled) {
+    run_headless();
+    finish_replay();
+    return;
+  }
+
   SDL_Event e;
   bool quit = false;
 
   // main loop
-  while (!quit) {
+  while (!quit && !m_replayDone) {
+    m_framePacer.wait_for_next_frame();
+    wait_for_frame_latency();
+    m_inputSampleTime = FramePacer::Clock::now();
+
     // Handle events on queue
     SDL_PumpEvents();
     while (SDL_PollEvent(&e) != 0) {
+      if (m_config.hud) {
+        ImGui_ImplSDL2_ProcessEvent(&e);
+      }
       // close the window when user clicks the X button or alt-f4s
       switch (e.type) {
       case SDL_QUIT:
@@ -42,12 +56,14 @@ void VulkanEngine::run() {
       }
     }
 
-    for (auto sc : m_inputs.keyPressed) {
-      input_handle_keydown(sc);
+    // held keys are applied by the simulation step
+    publish_simulation_input();
+    if (!m_simulationThread.joinable()) {
+      produce_frame_packet();
     }
-
     draw();
   }
+  finish_replay();
 }
 
 void VulkanEngine::cleanup() {
@@ -55,19 +71,56 @@ void VulkanEngine::cleanup() {
     return;
   }
 
+  stop_simulation();
+  ZoneProfiler::instance().stop();
+
+  // the simulation is stopped, so the path is complete
+  if (!m_replay.recordPath.empty() && !replaying()) {
+    m_cameraPath.set_length(m_simulationStep);
+    if (m_cameraPath.save(m_replay.recordPath)) {
+      spdlog::info("Wrote {} camera path steps to {}", m_simulationStep,
+                   m_replay.recordPath);
+    } else {
+      spdlog::warn("Could not write {}", m_replay.recordPath);
+    }
+  }
+
   // wait for gpu idle
-  for (FrameData &frame : m_frames) {
-    (void)m_device.waitForFences(frame.m_renderFence, true, S_TO_NS);
+  wait_timeline(m_timelineValue);
+
+  collect_frame_latencies();
+  log_frame_pacing();
+  if (!m_framePacer.write_csv("frame_pacing.csv")) {
+    spdlog::warn("Could not write frame_pacing.csv");
+  }
+  if (m_profiler.enabled()) {
+    // the gpu is idle, so the frames still in flight can be read back too
+    for (uint32_t slot = 0; slot < UPLOAD_PROFILER_SLOT + UPLOAD_CONTEXT_COUNT;
+         slot++) {
+      m_profiler.collect(slot);
+    }
+    if (!m_profiler.write_chrome_trace("profile_trace.json")) {
+      spdlog::warn("Could not write profile_trace.json");
+    }
   }
 
+  // jobs still compiling hold pipelines the deletion queue destroys
+  poll_pipeline_jobs(true);
+  m_deferredDeletionQueue.flush();
+  m_swapchainDeletionQueue.flush();
   m_mainDeletionQueue.flush();
 
   m_device.destroy();
-  m_instance.destroySurfaceKHR(m_surface);
+  if (m_surface) {
+    m_instance.destroySurfaceKHR(m_surface);
+  }
   m_instance.destroy();
-  SDL_DestroyWindow(m_window);
+  if (m_window) {
+    SDL_DestroyWindow(m_window);
+  }
 
   spdlog::info("Engine cleaned up");
+  EventLog::instance().stop();
 }
 
 } // namespace vkr
\ No newline at end of file
@@ -6,10 +6,12 @@
 #include <glm/ext/matrix_transform.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <vector>
 #include <vulkan/vulkan_enums.hpp>
 
 #include "constants.h"
+#include "draw_sort.hpp"
 #include "engine.hpp"
 
 namespace vkr {
@@ -19,142 +21,442 @@ const FrameData &VulkanEngine::get_current_frame() {
 }
 
 void VulkanEngine::draw() {
-  // timeout in ns
-  (void)m_device.waitForFences(get_current_frame().m_renderFence, true,
-                               S_TO_NS);
-  m_device.resetFences(get_current_frame().m_renderFence);
-
-  // request swapchain image
-  uint32_t swapchainImageIndex =
-      m_device
-          .acquireNextImageKHR(m_swapchain, S_TO_NS,
-                               get_current_frame().m_presentSemaphore, nullptr)
-          .value;
-
-  get_current_frame().m_mainCommandBuffer.reset();
+  VKR_ZONE("draw");
+  CpuScope drawScope(m_profiler, "draw");
+  const FramePacket &packet = acquire_frame_packet();
+  m_framePacket = &packet;
+  begin_replay_frame(packet);
+  poll_pipeline_jobs(false);
+
+  // the frame that last used this slot
+  if (m_frameNumber >= FRAME_OVERLAP) {
+    CpuScope waitScope(m_profiler, "wait for frame");
+    wait_for_frame(m_frameNumber - FRAME_OVERLAP);
+  }
+  collect_frame_latencies();
+  m_deferredDeletionQueue.collect(completed_timeline_value());
+
+  // the wait covers the last use of this frame's queries, so this never blocks
+  uint32_t frameIndex = m_frameNumber % FRAME_OVERLAP;
+  read_frame_queries(m_frames[frameIndex]);
+  read_cull_stats(m_frames[frameIndex]);
+
+  // request swapchain image, headless frames own the offscreen image of their
+  // slot
+  uint32_t swapchainImageIndex = frameIndex;
+  if (!m_headless.enabled) {
+    swapchainImageIndex =
+        m_device
+            .acquireNextImageKHR(m_swapchain, S_TO_NS,
+                                 get_current_frame().m_presentSemaphore,
+                                 nullptr)
+            .value;
+  }
+
+  auto recordStart = std::chrono::high_resolution_clock::now();
+  m_drawStats = {};
+  vk::CommandBuffer cmd = get_current_frame().m_mainCommandBuffer;
+  cmd.reset();
   vk::CommandBufferBeginInfo cmdBeginInfo;
   cmdBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-  get_current_frame().m_mainCommandBuffer.begin(cmdBeginInfo);
-
+  cmd.begin(cmdBeginInfo);
   // populate the buffer
+  // resets have to happen outside of the renderpass
+  m_profiler.begin_frame(cmd, frameIndex);
+  bool cached = m_config.staticCommandCache && !m_config.occlusionCulling &&
+                !m_config.softwareOcclusion;
+  // secondaries may only run inside a query with inherited queries
+  bool statsQuery = m_config.pipelineStatistics &&
+                    (!cached || m_capabilities.inheritedQueries);
+  if (statsQuery) {
+    cmd.resetQueryPool(m_statsQueryPool, frameIndex, 1);
+    // spans both renderpasses of the culled path, so it lives outside of them
+    cmd.beginQuery(m_statsQueryPool, frameIndex, {});
+  }
+  if (cached) {
+    draw_static_cached(cmd);
+  } else {
+    // overwrites the object slots the cached commands rely on
+    invalidate_static_commands();
 
-  vk::ClearValue clearValue;
-  // float flash = abs(sin(m_frameNumber / 120.f));
-  // clearValue.color.setFloat32({1 - flash, 0.0f, flash, 1.0f});
-  clearValue.color.setFloat32({0., 0., 0., 1.});
+    // culled by the simulation if its step had cpu occlusion culling on
+    prepare_draws(packet.visible.data(), packet.visible.size());
 
-  vk::ClearValue depthClear;
-  depthClear.depthStencil.setDepth(1.f);
+    if (m_config.occlusionCulling) {
+      draw_hiz_culled(cmd, m_sceneFramebuffer);
+    } else {
+      vk::ClearValue clearValue;
+      // float flash = abs(sin(m_frameNumber / 120.f));
+      // clearValue.color.setFloat32({1 - flash, 0.0f, flash, 1.0f});
+      clearValue.color.setFloat32({0., 0., 0., 1.});
 
-  // begin main renderpass
-  vk::RenderPassBeginInfo rpInfo;
-  rpInfo.renderPass = m_renderPass;
-  rpInfo.renderArea.setOffset({0, 0});
-  rpInfo.renderArea.extent = m_windowExtent;
-  rpInfo.framebuffer = m_framebuffers[swapchainImageIndex];
+      vk::ClearValue depthClear;
+      depthClear.depthStencil.setDepth(1.f);
 
-  auto clearValues = {clearValue, depthClear};
-  rpInfo.setClearValues(clearValues);
-  get_current_frame().m_mainCommandBuffer.beginRenderPass(
-      rpInfo, vk::SubpassContents::eInline);
+      // begin main renderpass
+      vk::RenderPassBeginInfo rpInfo;
+      rpInfo.renderPass = m_renderPass;
+      rpInfo.renderArea.setOffset({0, 0});
+      rpInfo.renderArea.extent = m_renderExtent;
+      rpInfo.framebuffer = m_sceneFramebuffer;
+
+      auto clearValues = {clearValue, depthClear};
+      rpInfo.setClearValues(clearValues);
+      GpuScope sceneScope(m_profiler, cmd, frameIndex, "scene");
+      cmd.beginRenderPass(rpInfo, vk::SubpassContents::eInline);
+      record_draws(cmd, frameIndex, m_drawList, -1, m_drawStats);
+      cmd.endRenderPass();
+    }
+  }
 
-  draw_objects(get_current_frame().m_mainCommandBuffer, m_renderables.data(),
-               m_renderables.size());
+  if (statsQuery) {
+    cmd.endQuery(m_statsQueryPool, frameIndex);
+    m_frames[frameIndex].statsQueryWritten = true;
+  }
+  // outside of the statistics query, it only counts scene fragments
+  record_upscale(cmd, swapchainImageIndex);
+  record_hud(cmd, swapchainImageIndex);
+  m_profiler.end_frame(cmd, frameIndex);
 
   // finish populating the buffer
-  get_current_frame().m_mainCommandBuffer.endRenderPass();
-  get_current_frame().m_mainCommandBuffer.end();
+  cmd.end();
 
-  vk::SubmitInfo submitInfo;
-  submitInfo.setWaitSemaphores(get_current_frame().m_presentSemaphore);
-  submitInfo.setSignalSemaphores(get_current_frame().m_renderSemaphore);
-  submitInfo.setCommandBuffers(get_current_frame().m_mainCommandBuffer);
+  FrameData &frame = m_frames[frameIndex];
+  frame.frameNumber = m_frameNumber;
+  frame.timelineValue = next_timeline_value();
+
+  // binary semaphores for the swapchain, the timeline wait orders the frame
+  // after any upload that hasn't finished yet. values of binary semaphores are
+  // ignored. headless frames only use the timeline
+  uint32_t semaphoreCount = m_headless.enabled ? 1 : 2;
+  vk::Semaphore waitSemaphores[] = {m_timeline, frame.m_presentSemaphore};
+  uint64_t waitValues[] = {m_uploadTimelineValue, 0};
   // TODO: wtf?
-  vk::PipelineStageFlags waitStage =
-      vk::PipelineStageFlagBits::eColorAttachmentOutput;
-  submitInfo.setWaitDstStageMask(waitStage);
-  m_graphicsQueue.submit(submitInfo, get_current_frame().m_renderFence);
-
-  // now present to surface
-  vk::PresentInfoKHR presentInfo;
-  presentInfo.setSwapchains(m_swapchain);
-  presentInfo.setWaitSemaphores(get_current_frame().m_renderSemaphore);
-  presentInfo.setImageIndices(swapchainImageIndex);
-  (void)m_graphicsQueue.presentKHR(presentInfo);
+  vk::PipelineStageFlags waitStages[] = {
+      vk::PipelineStageFlagBits::eAllCommands,
+      vk::PipelineStageFlagBits::eColorAttachmentOutput};
+  vk::Semaphore signalSemaphores[] = {m_timeline, frame.m_renderSemaphore};
+  uint64_t signalValues[] = {frame.timelineValue, 0};
+  vk::TimelineSemaphoreSubmitInfo timelineInfo;
+  timelineInfo.setWaitSemaphoreValueCount(semaphoreCount)
+      .setPWaitSemaphoreValues(waitValues)
+      .setSignalSemaphoreValueCount(semaphoreCount)
+      .setPSignalSemaphoreValues(signalValues);
+
+  vk::SubmitInfo submitInfo;
+  submitInfo.setWaitSemaphoreCount(semaphoreCount)
+      .setPWaitSemaphores(waitSemaphores)
+      .setPWaitDstStageMask(waitStages)
+      .setSignalSemaphoreCount(semaphoreCount)
+      .setPSignalSemaphores(signalSemaphores);
+  submitInfo.setCommandBuffers(cmd);
+  submitInfo.setPNext(&timelineInfo);
+  m_profiler.mark_submit(frameIndex);
+  m_graphicsQueue.submit(submitInfo);
+  frame.inputTime = packet.inputTime;
+  frame.latencyPending = true;
+  double recordMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::high_resolution_clock::now() - recordStart)
+                        .count();
+  m_recordMs += recordMs;
+  m_cpuTimingFrames++;
+
+  if (m_headless.enabled) {
+    FrameTiming timing;
+    timing.frame = m_frameNumber;
+    timing.recordMs = recordMs;
+    m_frameTimings.push_back(timing);
+  } else {
+    // now present to surface
+    CpuScope presentScope(m_profiler, "present");
+    vk::PresentInfoKHR presentInfo;
+    presentInfo.setSwapchains(m_swapchain);
+    presentInfo.setWaitSemaphores(get_current_frame().m_renderSemaphore);
+    presentInfo.setImageIndices(swapchainImageIndex);
+    (void)m_graphicsQueue.presentKHR(presentInfo);
+  }
+  m_framePacer.record_frame();
+  end_replay_frame();
+  // only writes once pipelines were added since the last save
+  m_pipelineCache.save_periodically();
 
   if (m_frameNumber % 500 == 0) {
     spdlog::info("Frame {}", m_frameNumber);
+    if (m_statsFrames > 0) {
+      spdlog::info("Avg fragment invocations over {} frames: {} (depth "
+                   "prepass {}, front to back {})",
+                   m_statsFrames, m_fragmentInvocations / m_statsFrames,
+                   m_config.depthPrepass ? "on" : "off",
+                   m_config.frontToBack ? "on" : "off");
+      m_fragmentInvocations = 0;
+      m_statsFrames = 0;
+    }
+    if (m_cullStatsFrames > 0) {
+      spdlog::info("Avg over {} frames: {} draws, {} culled by the first "
+                   "phase, {} recovered by the second, {} culled",
+                   m_cullStatsFrames, m_cullStats.drawCount / m_cullStatsFrames,
+                   m_cullStats.culledFirstPhase / m_cullStatsFrames,
+                   m_cullStats.recoveredSecondPhase / m_cullStatsFrames,
+                   m_cullStats.culledTotal / m_cullStatsFrames);
+      m_cullStats = {};
+      m_cullStatsFrames = 0;
+    }
+    if (m_softwareFrames > 0) {
+      spdlog::info("Avg over {} frames: {} culled on the cpu, {:.3f}ms "
+                   "rasterizing occluders, {:.3f}ms testing",
+                   m_softwareFrames, m_softwareCulled / m_softwareFrames,
+                   m_softwareRasterMs / m_softwareFrames,
+                   m_softwareTestMs / m_softwareFrames);
+      m_softwareCulled = 0;
+      m_softwareFrames = 0;
+      m_softwareRasterMs = 0.;
+      m_softwareTestMs = 0.;
+    }
+    // both averages persist, so toggling culling shows the time it saves
+    for (int culled = 0; culled < 2; culled++) {
+      if (m_gpuFrameTimeFrames[culled] > 0) {
+        spdlog::info("Avg gpu frame time with occlusion culling {}: {:.3f}ms",
+                     culled ? "on" : "off",
+                     m_gpuFrameTimeMs[culled] / m_gpuFrameTimeFrames[culled]);
+      }
+    }
+    if (m_cpuTimingFrames > 0) {
+      // pipelined, the cpu frame time approaches the larger of the two
+      // instead of their sum
+      spdlog::info("Avg cpu over {} frames: {:.3f}ms simulating, {:.3f}ms "
+                   "recording and submitting ({})",
+                   m_cpuTimingFrames, m_simulationMs / m_cpuTimingFrames,
+                   m_recordMs / m_cpuTimingFrames,
+                   m_simulationThread.joinable() ? "pipelined" : "serial");
+      m_simulationMs = 0.;
+      m_recordMs = 0.;
+      m_cpuTimingFrames = 0;
+    }
+    log_frame_pacing();
   }
+  VKR_FRAME_MARK();
   m_frameNumber++;
 }
 
-void VulkanEngine::draw_objects(vk::CommandBuffer cmd, RenderObject *first,
-                                int count) {
+void VulkanEngine::read_frame_queries(FrameData &frame) {
+  uint32_t frameIndex = frame.frameNumber % FRAME_OVERLAP;
+  if (frame.statsQueryWritten) {
+    frame.statsQueryWritten = false;
+
+    uint64_t fragmentInvocations = 0;
+    vk::Result result = m_device.getQueryPoolResults(
+        m_statsQueryPool, frameIndex, 1, sizeof(uint64_t),
+        &fragmentInvocations, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result == vk::Result::eSuccess) {
+      m_fragmentInvocations += fragmentInvocations;
+      m_statsFrames++;
+    }
+  }
+
+  // also collects the frame's profiler scopes
+  double gpuFrameMs = m_profiler.collect(frameIndex);
+  if (gpuFrameMs >= 0.) {
+    // cull stats are only written by culled frames and are read after this
+    int culled = frame.cullStatsWritten ? 1 : 0;
+    m_gpuFrameTimeMs[culled] += gpuFrameMs;
+    m_gpuFrameTimeFrames[culled]++;
+    update_render_scale(gpuFrameMs);
+    if (m_config.hud) {
+      m_hudGpuGraph.push(gpuFrameMs);
+    }
+    if (frame.frameNumber < m_frameTimings.size()) {
+      m_frameTimings[frame.frameNumber].gpuMs = gpuFrameMs;
+    }
+  }
+}
+
+glm::mat4 VulkanEngine::get_projection_matrix() {
   glm::mat4 projection =
       glm::perspective(glm::radians(70.), 1920. / 1080., 0.1, 200.);
   // TODO: why?
   projection[1][1] *= -1;
+  return projection;
+}
+
+void VulkanEngine::update_camera_scene() {
+  glm::mat4 projection = get_projection_matrix();
 
   // fill GPU camera data struct
   GPUCameraData camData;
   camData.proj = projection;
-  camData.view = m_viewMatrix;
-  camData.viewproj = projection * m_viewMatrix;
+  camData.view = m_framePacket->viewMatrix;
+  camData.viewproj = projection * m_framePacket->viewMatrix;
 
-  // setup sceneData
   int frameIndex = m_frameNumber % FRAME_OVERLAP;
-  float framed = m_frameNumber / 288.;
-  m_sceneParameters.ambientColor = {sin(framed), 0, cos(framed), 1};
 
   char *data = (char *)m_allocator.mapMemory(m_cameraSceneBuffer.allocation);
   data += pad_uniform_buffer_size(sizeof(GPUCameraSceneData)) * frameIndex;
   memcpy(data + offsetof(GPUCameraSceneData, cameraData), &camData,
          sizeof(GPUCameraData));
-  memcpy(data + offsetof(GPUCameraSceneData, sceneData), &m_sceneParameters,
-         sizeof(GPUSceneData));
+  memcpy(data + offsetof(GPUCameraSceneData, sceneData),
+         &m_framePacket->sceneParameters, sizeof(GPUSceneData));
   m_allocator.unmapMemory(m_cameraSceneBuffer.allocation);
+}
+
+void VulkanEngine::append_sorted_draws(RenderObject *first, int count,
+                                       bool frontToBack) {
+  sort_draws(m_drawList, first, count, m_framePacket->viewMatrix, frontToBack);
+}
 
-  void *objectData =
-      m_allocator.mapMemory((get_current_frame().objectBuffer.allocation));
+void VulkanEngine::write_object_data(uint32_t frameIndex,
+                                     const std::vector<RenderObject> &draws) {
+  FrameData &frame = m_frames[frameIndex];
+  void *objectData = m_allocator.mapMemory((frame.objectBuffer.allocation));
   GPUObjectData *objectSSBO = (GPUObjectData *)objectData;
-  void *objectLightingData = m_allocator.mapMemory(
-      (get_current_frame().objectLightingBuffer.allocation));
+  void *objectLightingData =
+      m_allocator.mapMemory((frame.objectLightingBuffer.allocation));
   GPUObjectLightingData *objectLightingSSBO =
       (GPUObjectLightingData *)objectLightingData;
 
-  // sort renderobjects by material
-  std::vector<RenderObject> sortedRenderObjects;
+  for (uint32_t i = 0; i < draws.size(); i++) {
+    const RenderObject &object = draws[i];
+    objectSSBO[i].modelMatrix = object.transformMatrix;
+    objectSSBO[i].materialIndex =
+        glm::uvec4(object.material->materialIndex, 0, 0, 0);
+    objectLightingSSBO[i].objectAmbientLighting =
+        glm::vec4(i % 3 == 0, i % 3 == 1, i % 3 == 2, 1);
+  }
+
+  m_allocator.unmapMemory(frame.objectBuffer.allocation);
+  m_allocator.unmapMemory(frame.objectLightingBuffer.allocation);
+}
+
+void VulkanEngine::prepare_draws(RenderObject *first, int count) {
+  VKR_ZONE("prepare_draws");
+  update_camera_scene();
+  m_drawList.clear();
+  append_sorted_draws(first, count, m_config.frontToBack);
+  write_object_data(m_frameNumber % FRAME_OVERLAP, m_drawList);
+
+  if (!m_config.occlusionCulling) {
+    return;
+  }
+
+  GPUCullData *cullSSBO = (GPUCullData *)m_allocator.mapMemory(
+      get_current_frame().cullDataBuffer.allocation);
   for (int i = 0; i < count; i++) {
-    sortedRenderObjects.push_back(*(first + i));
+    cullSSBO[i].sphere = m_drawList[i].world_bounds();
   }
-  std::sort(sortedRenderObjects.begin(), sortedRenderObjects.end(),
-            [](RenderObject &a, RenderObject &b) {
-              return (uint64_t)a.material < (uint64_t)b.material;
-            });
+  m_allocator.unmapMemory(get_current_frame().cullDataBuffer.allocation);
+
+  // one command per draw for each phase, the cull shader only ever writes
+  // instanceCount
+  vk::DrawIndexedIndirectCommand *commands =
+      (vk::DrawIndexedIndirectCommand *)m_allocator.mapMemory(
+          get_current_frame().indirectBuffer.allocation);
+  for (int i = 0; i < count; i++) {
+    vk::DrawIndexedIndirectCommand command;
+    command.indexCount = m_drawList[i].mesh->indices.size();
+    command.instanceCount = 1;
+    command.firstIndex = 0;
+    command.vertexOffset = 0;
+    command.firstInstance = i;
+    commands[i] = command;
+    commands[MAX_OBJECTS + i] = command;
+  }
+  m_allocator.unmapMemory(get_current_frame().indirectBuffer.allocation);
+}
+
+void VulkanEngine::record_draws(vk::CommandBuffer cmd, uint32_t frameIndex,
+                                const std::vector<RenderObject> &draws,
+                                int indirectBase, DrawStats &stats) {
+  VKR_ZONE("record_draws");
+  const FrameData &frame = m_frames[frameIndex];
+  uint32_t uniformOffset =
+      pad_uniform_buffer_size(sizeof(GPUCameraSceneData)) * frameIndex;
+  uint32_t dOffset[] = {uniformOffset, uniformOffset};
+  // dynamic state isn't inherited by secondaries, so every recording sets it
+  set_render_viewport(cmd);
+  // skipped until its pipeline has compiled
+  bool depthPrepass = depth_prepass_active();
 
-  // render each renderObject
   Mesh *lastMesh = nullptr;
+  auto bindMesh = [&](Mesh *mesh) {
+    if (mesh != lastMesh) {
+      vk::DeviceSize offset = 0;
+      cmd.bindVertexBuffers(0, mesh->combinedVertexBuffer.buffer, offset);
+      cmd.bindIndexBuffer(mesh->combinedVertexBuffer.buffer,
+                          mesh->vertices.size() * sizeof(Vertex),
+                          vk::IndexType::eUint32);
+      lastMesh = mesh;
+      stats.bufferBinds += 2;
+    }
+  };
+  // culled draws keep their command, the cull shader zeroes instanceCount
+  auto drawObject = [&](uint32_t i) {
+    stats.drawCalls++;
+    stats.triangles += draws[i].mesh->indices.size() / 3;
+    if (indirectBase < 0) {
+      cmd.drawIndexed(draws[i].mesh->indices.size(), 1, 0, 0, i);
+    } else {
+      cmd.drawIndexedIndirect(frame.indirectBuffer.buffer,
+                              (indirectBase + i) *
+                                  sizeof(vk::DrawIndexedIndirectCommand),
+                              1, sizeof(vk::DrawIndexedIndirectCommand));
+    }
+  };
+
+  // depth only, same order and instance indices as the main pass
+  if (depthPrepass) {
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_depthPrepassPipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                           m_meshPipelineLayout, 0, 1, &m_globalDescriptorSet,
+                           2, dOffset);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                           m_meshPipelineLayout, 1, 1,
+                           &frame.objectDescriptorSet, 0,
+                           nullptr);
+    stats.pipelineBinds++;
+    stats.descriptorBinds += 2;
+    for (uint32_t i = 0; i < draws.size(); i++) {
+      bindMesh(draws[i].mesh);
+      drawObject(i);
+    }
+  }
+
+  // render each renderObject
   Material *lastMaterial = nullptr;
-  for (int i = 0; i < count; i++) {
-    RenderObject &object = sortedRenderObjects[i];
-    if (object.material != lastMaterial) {
-      cmd.bindPipeline(vk::PipelineBindPoint::eGraphics,
-                       object.material->pipeline);
-      lastMaterial = object.material;
-      // bind descriptor set when changing pipeline
-      uint32_t uniformOffset =
-          pad_uniform_buffer_size(sizeof(GPUCameraSceneData)) * frameIndex;
-      uint32_t dOffset[] = {uniformOffset, uniformOffset};
+  VkPipeline lastPipeline = VK_NULL_HANDLE;
+  VkPipelineLayout lastLayout = VK_NULL_HANDLE;
+  for (uint32_t i = 0; i < draws.size(); i++) {
+    const RenderObject &object = draws[i];
+    VkPipeline pipeline = depthPrepass ? object.material->depthEqualPipeline
+                                       : object.material->pipeline;
+    if (pipeline != lastPipeline) {
+      cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+      lastPipeline = pipeline;
+      stats.pipelineBinds++;
+    }
+    // descriptor sets only need rebinding on an incompatible layout, with
+    // bindless every mesh pipeline shares one layout
+    if (object.material->pipelineLayout != lastLayout) {
+      lastLayout = object.material->pipelineLayout;
       cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
                              object.material->pipelineLayout, 0, 1,
                              &m_globalDescriptorSet, 2, dOffset);
       cmd.bindDescriptorSets(
           vk::PipelineBindPoint::eGraphics, object.material->pipelineLayout, 1,
-          1, &get_current_frame().objectDescriptorSet, 0, nullptr);
-      if (object.material->textureSet.has_value()) {
+          1, &frame.objectDescriptorSet, 0, nullptr);
+      stats.descriptorBinds += 2;
+      if (m_config.bindless) {
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                               object.material->pipelineLayout, 2, 1,
+                               &m_bindlessDescriptorSet, 0, nullptr);
+        stats.descriptorBinds++;
+      }
+    }
+    if (object.material != lastMaterial) {
+      lastMaterial = object.material;
+      if (!m_config.bindless && object.material->textureSet.has_value()) {
         cmd.bindDescriptorSets(
             vk::PipelineBindPoint::eGraphics, object.material->pipelineLayout,
             2, 1, &object.material->textureSet.value(), 0, nullptr);
+        stats.descriptorBinds++;
       }
     }
 
@@ -165,24 +467,8 @@ void VulkanEngine::draw_objects(vk::CommandBuffer cmd, RenderObject *first,
                       vk::ShaderStageFlagBits::eVertex, 0,
                       sizeof(MeshPushConstants), &constants);
 
-    objectSSBO[i].modelMatrix = object.transformMatrix;
-    objectLightingSSBO[i].objectAmbientLighting =
-        glm::vec4(i % 3 == 0, i % 3 == 1, i % 3 == 2, 1);
-
-    if (object.mesh != lastMesh) {
-      vk::DeviceSize offset = 0;
-      cmd.bindVertexBuffers(0, object.mesh->combinedVertexBuffer.buffer,
-                            offset);
-      cmd.bindIndexBuffer(object.mesh->combinedVertexBuffer.buffer,
-                          object.mesh->vertices.size() * sizeof(Vertex),
-                          vk::IndexType::eUint32);
-      lastMesh = object.mesh;
-    }
-
-    cmd.drawIndexed(object.mesh->indices.size(), 1, 0, 0, i);
+    bindMesh(object.mesh);
+    drawObject(i);
   }
-
-  m_allocator.unmapMemory(get_current_frame().objectBuffer.allocation);
-  m_allocator.unmapMemory(get_current_frame().objectLightingBuffer.allocation);
 }
 } // namespace vkr
\ No newline at end of file
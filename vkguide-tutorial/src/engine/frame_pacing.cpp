@@ -0,0 +1,62 @@
+#include "common_includes.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "engine.hpp"
+
+namespace vkr {
+
+void VulkanEngine::wait_for_frame_latency() {
+  uint32_t latency =
+      std::clamp(m_config.maxFrameLatency, 1u, (uint32_t)FRAME_OVERLAP);
+  // draw() waits for the frame FRAME_OVERLAP old anyway
+  if (latency >= FRAME_OVERLAP || m_frameNumber < latency) {
+    return;
+  }
+
+  wait_for_frame(m_frameNumber - latency);
+  collect_frame_latencies();
+}
+
+void VulkanEngine::collect_frame_latencies() {
+  for (FrameData &frame : m_frames) {
+    if (!frame.latencyPending || !timeline_reached(frame.timelineValue)) {
+      continue;
+    }
+    frame.latencyPending = false;
+    m_framePacer.record_latency(
+        std::chrono::duration<double, std::milli>(FramePacer::Clock::now() -
+                                                  frame.inputTime)
+            .count());
+  }
+}
+
+void VulkanEngine::set_present_mode(vk::PresentModeKHR presentMode) {
+  if (m_headless.enabled) {
+    return;
+  }
+  m_config.presentMode = presentMode;
+  recreate_swapchain();
+  // percentiles across present modes mean nothing
+  m_framePacer.reset_stats();
+}
+
+void VulkanEngine::log_frame_pacing() {
+  FramePercentiles frameTimes = m_framePacer.frame_time_percentiles();
+  FramePercentiles latencies = m_framePacer.latency_percentiles();
+  if (frameTimes.samples == 0) {
+    return;
+  }
+
+  spdlog::info("Frame time over {} frames: p50 {:.2f}ms, p95 {:.2f}ms, p99 "
+               "{:.2f}ms, max {:.2f}ms",
+               frameTimes.samples, frameTimes.p50, frameTimes.p95,
+               frameTimes.p99, frameTimes.max);
+  spdlog::info("Input to gpu completion latency: p50 {:.2f}ms, p99 {:.2f}ms "
+               "(present mode {}, limit {} fps, max frame latency {})",
+               latencies.p50, latencies.p99, vk::to_string(m_presentMode),
+               m_framePacer.target_fps(), m_config.maxFrameLatency);
+}
+
+} // namespace vkr
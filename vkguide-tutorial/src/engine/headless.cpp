@@ -0,0 +1,181 @@
+#include "common_includes.h"
+
+#include <chrono>
+#include <fstream>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "engine.hpp"
+
+namespace vkr {
+
+void VulkanEngine::create_offscreen_images() {
+  // stands in for the swapchain, one image per frame in flight so a frame
+  // never renders into an image an older frame is still writing
+  m_swapchainImageFormat = vk::Format::eR8G8B8A8Srgb;
+  // nothing waits on a display
+  m_presentMode = vk::PresentModeKHR::eImmediate;
+
+  vk::ImageCreateInfo imageInfo;
+  imageInfo.setFormat(m_swapchainImageFormat)
+      .setImageType(vk::ImageType::e2D)
+      .setExtent(vk::Extent3D(m_windowExtent.width, m_windowExtent.height, 1))
+      .setUsage(vk::ImageUsageFlagBits::eColorAttachment |
+                vk::ImageUsageFlagBits::eTransferSrc)
+      .setMipLevels(1)
+      .setArrayLayers(1)
+      .setSamples(vk::SampleCountFlagBits::e1)
+      .setTiling(vk::ImageTiling::eOptimal);
+  vma::AllocationCreateInfo imageAllocInfo;
+  imageAllocInfo.setUsage(vma::MemoryUsage::eGpuOnly)
+      .setRequiredFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  vk::ImageViewCreateInfo viewInfo;
+  viewInfo.setFormat(m_swapchainImageFormat)
+      .setViewType(vk::ImageViewType::e2D)
+      .setSubresourceRange(vk::ImageSubresourceRange(
+          vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+
+  m_offscreenImages.resize(FRAME_OVERLAP);
+  m_swapchainImages.clear();
+  m_swapchainImageViews.clear();
+  for (AllocatedImage &offscreen : m_offscreenImages) {
+    auto allocatedImage = m_allocator.createImage(imageInfo, imageAllocInfo);
+    offscreen.image = allocatedImage.first;
+    offscreen.allocation = allocatedImage.second;
+    viewInfo.setImage(offscreen.image);
+    m_swapchainImages.push_back(offscreen.image);
+    m_swapchainImageViews.push_back(m_device.createImageView(viewInfo));
+
+    // the views go with the framebuffers
+    m_swapchainDeletionQueue.push_function([=]() {
+      m_allocator.destroyImage(offscreen.image, offscreen.allocation);
+    });
+  }
+  spdlog::info("Created {} {}x{} offscreen images instead of a swapchain",
+               m_offscreenImages.size(), m_windowExtent.width,
+               m_windowExtent.height);
+}
+
+void VulkanEngine::run_headless() {
+  m_frameTimings.reserve(m_headless.frames);
+  spdlog::info("Rendering {} headless frames", m_headless.frames);
+
+  for (uint32_t i = 0; i < m_headless.frames && !m_replayDone; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    m_framePacer.wait_for_next_frame();
+    wait_for_frame_latency();
+    m_inputSampleTime = FramePacer::Clock::now();
+
+    // no keys are ever held, the camera stays put or follows a replayed path
+    // so runs are comparable
+    publish_simulation_input();
+    if (!m_simulationThread.joinable()) {
+      produce_frame_packet();
+    }
+    draw();
+
+    m_frameTimings.back().frameMs =
+        std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count();
+  }
+
+  // the timestamps of the last frames in flight haven't been read yet
+  wait_timeline(m_timelineValue);
+  for (FrameData &frame : m_frames) {
+    read_frame_queries(frame);
+  }
+
+  if (!write_frame_timings(m_headless.timingsPath)) {
+    spdlog::warn("Could not write {}", m_headless.timingsPath);
+  }
+  if (!m_headless.screenshotPath.empty() && m_frameNumber > 0) {
+    uint32_t lastImage = (m_frameNumber - 1) % FRAME_OVERLAP;
+    if (!save_screenshot(lastImage, m_headless.screenshotPath)) {
+      spdlog::warn("Could not write {}", m_headless.screenshotPath);
+    }
+  }
+}
+
+bool VulkanEngine::write_frame_timings(const std::string &path) {
+  std::ofstream file(path);
+  if (!file) {
+    return false;
+  }
+
+  // a frame whose timestamps were never read gets a negative gpu time
+  bool json = path.size() >= 5 && path.substr(path.size() - 5) == ".json";
+  if (json) {
+    file << "[\n";
+    for (size_t i = 0; i < m_frameTimings.size(); i++) {
+      const FrameTiming &timing = m_frameTimings[i];
+      file << "  {\"frame\": " << timing.frame
+           << ", \"frame_ms\": " << timing.frameMs
+           << ", \"record_ms\": " << timing.recordMs
+           << ", \"gpu_ms\": " << timing.gpuMs << "}"
+           << (i + 1 < m_frameTimings.size() ? ",\n" : "\n");
+    }
+    file << "]\n";
+  } else {
+    file << "frame,frame_ms,record_ms,gpu_ms\n";
+    for (const FrameTiming &timing : m_frameTimings) {
+      file << timing.frame << "," << timing.frameMs << "," << timing.recordMs
+           << "," << timing.gpuMs << "\n";
+    }
+  }
+
+  spdlog::info("Wrote {} frame timings to {}", m_frameTimings.size(), path);
+  return file.good();
+}
+
+bool VulkanEngine::save_screenshot(uint32_t imageIndex,
+                                   const std::string &path) {
+  uint32_t width = m_windowExtent.width;
+  uint32_t height = m_windowExtent.height;
+  vk::DeviceSize size = vk::DeviceSize(width) * height * 4;
+  AllocatedBuffer readback =
+      create_buffer(size, vk::BufferUsageFlagBits::eTransferDst,
+                    vma::MemoryUsage::eAuto,
+                    vma::AllocationCreateFlagBits::eHostAccessRandom);
+
+  immediate_submit([&](vk::CommandBuffer cmd) {
+    // the upscale pass left the image in eTransferSrcOptimal
+    vk::ImageMemoryBarrier barrier;
+    barrier.setImage(m_offscreenImages[imageIndex].image)
+        .setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+        .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+        .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+        .setSubresourceRange(vk::ImageSubresourceRange(
+            vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                        vk::PipelineStageFlagBits::eTransfer, {}, nullptr,
+                        nullptr, barrier);
+
+    vk::BufferImageCopy copy;
+    copy.setImageSubresource(
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0,
+                                       1))
+        .setImageExtent(vk::Extent3D(width, height, 1));
+    cmd.copyImageToBuffer(m_offscreenImages[imageIndex].image,
+                          vk::ImageLayout::eTransferSrcOptimal,
+                          readback.buffer, copy);
+  });
+
+  // rgba8 srgb maps straight onto png bytes
+  void *pixels = m_allocator.mapMemory(readback.allocation);
+  m_allocator.invalidateAllocation(readback.allocation, 0, VK_WHOLE_SIZE);
+  int written =
+      stbi_write_png(path.c_str(), width, height, 4, pixels, width * 4);
+  m_allocator.unmapMemory(readback.allocation);
+  m_allocator.destroyBuffer(readback.buffer, readback.allocation);
+
+  if (written) {
+    spdlog::info("Saved the last frame to {}", path);
+  }
+  return written != 0;
+}
+
+} // namespace vkr
@@ -0,0 +1,249 @@
+#include "common_includes.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+
+#include <imgui.h>
+#include <imgui_impl_sdl.h>
+#include <imgui_impl_vulkan.h>
+
+#include "engine.hpp"
+
+namespace vkr {
+
+namespace {
+
+constexpr double MB = 1024. * 1024.;
+
+void plot_graph(const char *label, const HudGraph &graph, double budgetMs) {
+  size_t latestIndex = (graph.next + HudGraph::SIZE - 1) % HudGraph::SIZE;
+  float latest = graph.values[latestIndex];
+  char overlay[32];
+  snprintf(overlay, sizeof(overlay), "%.2f ms", latest);
+  // the budget stays in view, so spikes over it read as spikes
+  float scaleMax = std::max(graph.max(), float(budgetMs) * 1.5f);
+  ImGui::PlotLines(label, graph.values.data(), HudGraph::SIZE, graph.next,
+                   overlay, 0.f, scaleMax, ImVec2(240.f, 50.f));
+}
+
+} // namespace
+
+void VulkanEngine::init_hud() {
+  // drawn over the upscaled image, so it loads what the upscale stored
+  vk::AttachmentDescription swapchainAttachment;
+  swapchainAttachment.format = m_swapchainImageFormat;
+  swapchainAttachment.samples = vk::SampleCountFlagBits::e1;
+  swapchainAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
+  swapchainAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+  swapchainAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+  swapchainAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+  swapchainAttachment.initialLayout = vk::ImageLayout::ePresentSrcKHR;
+  swapchainAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+  vk::AttachmentReference colorAttachmentRef(
+      0, vk::ImageLayout::eColorAttachmentOptimal);
+
+  vk::SubpassDescription subpass;
+  subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+      .setColorAttachments(colorAttachmentRef);
+
+  // blends over the upscale pass's writes
+  vk::SubpassDependency upscaleDep;
+  upscaleDep.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+      .setDstSubpass(0)
+      .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+      .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentRead |
+                        vk::AccessFlagBits::eColorAttachmentWrite);
+
+  // compatible with m_upscaleRenderPass, so it shares m_framebuffers
+  vk::RenderPassCreateInfo renderPassInfo;
+  renderPassInfo.setAttachments(swapchainAttachment)
+      .setSubpasses(subpass)
+      .setDependencies(upscaleDep);
+  m_hudRenderPass = m_device.createRenderPass(renderPassInfo);
+
+  // the font atlas is the only texture
+  vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler,
+                                  1);
+  vk::DescriptorPoolCreateInfo poolInfo;
+  poolInfo.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet);
+  poolInfo.setMaxSets(1);
+  poolInfo.setPoolSizes(poolSize);
+  m_hudDescriptorPool = m_device.createDescriptorPool(poolInfo);
+
+  ImGui::CreateContext();
+  ImGui::GetIO().IniFilename = nullptr;
+  ImGui_ImplSDL2_InitForVulkan(m_window);
+
+  ImGui_ImplVulkan_InitInfo initInfo = {};
+  initInfo.Instance = static_cast<VkInstance>(m_instance);
+  initInfo.PhysicalDevice = static_cast<VkPhysicalDevice>(m_physicalDevice);
+  initInfo.Device = static_cast<VkDevice>(m_device);
+  initInfo.QueueFamily = m_graphicsQueueFamily;
+  initInfo.Queue = static_cast<VkQueue>(m_graphicsQueue);
+  initInfo.DescriptorPool = static_cast<VkDescriptorPool>(m_hudDescriptorPool);
+  initInfo.PipelineCache =
+      static_cast<VkPipelineCache>(m_pipelineCache.handle());
+  initInfo.MinImageCount = 2;
+  // the backend cycles its vertex buffers by this count, every frame in
+  // flight needs its own
+  initInfo.ImageCount = std::max<uint32_t>(m_swapchainImages.size(),
+                                           FRAME_OVERLAP);
+  initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+  ImGui_ImplVulkan_Init(&initInfo, static_cast<VkRenderPass>(m_hudRenderPass));
+
+  immediate_submit([](vk::CommandBuffer cmd) {
+    ImGui_ImplVulkan_CreateFontsTexture(static_cast<VkCommandBuffer>(cmd));
+  });
+  ImGui_ImplVulkan_DestroyFontUploadObjects();
+
+  m_mainDeletionQueue.push_function([=]() {
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplSDL2_Shutdown();
+    ImGui::DestroyContext();
+    m_device.destroyDescriptorPool(m_hudDescriptorPool);
+    m_device.destroyRenderPass(m_hudRenderPass);
+  });
+  spdlog::info("Initialized hud, toggled with H");
+}
+
+void VulkanEngine::build_hud() {
+  ImGui_ImplVulkan_NewFrame();
+  ImGui_ImplSDL2_NewFrame();
+  ImGui::NewFrame();
+
+  ImGui::SetNextWindowPos(ImVec2(10.f, 10.f));
+  ImGui::SetNextWindowBgAlpha(0.6f);
+  ImGui::Begin("Performance", nullptr,
+               ImGuiWindowFlags_NoDecoration |
+                   ImGuiWindowFlags_AlwaysAutoResize |
+                   ImGuiWindowFlags_NoFocusOnAppearing |
+                   ImGuiWindowFlags_NoNav);
+
+  // frame and gpu time against the dynamic resolution budget
+  ImGui::Text("Budget %.2f ms, render scale %.2f", m_config.gpuBudgetMs,
+              double(m_renderExtent.width) / m_windowExtent.width);
+  plot_graph("frame", m_hudFrameGraph, m_config.gpuBudgetMs);
+  plot_graph("gpu", m_hudGpuGraph, m_config.gpuBudgetMs);
+
+  ImGui::Separator();
+  ImGui::Text("Draw calls %u, triangles %llu", m_drawStats.drawCalls,
+              (unsigned long long)m_drawStats.triangles);
+  ImGui::Text("Binds: %u pipeline, %u descriptor set, %u buffer",
+              m_drawStats.pipelineBinds, m_drawStats.descriptorBinds,
+              m_drawStats.bufferBinds);
+  PipelineStateCache::Stats pipelineStats = m_pipelineStates.stats();
+  uint64_t pipelineBuilds = pipelineStats.hits + pipelineStats.misses;
+  ImGui::Text("Pipelines %zu live, %.0f%% of %llu builds deduplicated",
+              pipelineStats.live,
+              pipelineBuilds ? 100. * pipelineStats.hits / pipelineBuilds : 0.,
+              (unsigned long long)pipelineBuilds);
+
+  ImGui::Separator();
+  const FramePacket &packet = *m_framePacket;
+  ImGui::Text("Renderables %zu", packet.renderables.size());
+  if (packet.softwareOcclusion) {
+    ImGui::Text("Cpu occlusion: %llu culled, %.2f ms raster, %.2f ms test",
+                (unsigned long long)packet.softwareCulled,
+                packet.softwareRasterMs, packet.softwareTestMs);
+  }
+  if (m_config.occlusionCulling) {
+    ImGui::Text("Hi-z: %u draws, %u culled (%u first phase, %u recovered)",
+                m_lastCullStats.drawCount, m_lastCullStats.culledTotal,
+                m_lastCullStats.culledFirstPhase,
+                m_lastCullStats.recoveredSecondPhase);
+  }
+
+  // what the engine allocated by use, then what the driver reports per heap
+  ImGui::Separator();
+  auto allocationSize = [&](vma::Allocation allocation) -> vk::DeviceSize {
+    return allocation ? m_allocator.getAllocationInfo(allocation).size : 0;
+  };
+  vk::DeviceSize meshBytes = 0;
+  for (const auto &[name, mesh] : m_meshes) {
+    meshBytes += allocationSize(mesh.combinedVertexBuffer.allocation);
+  }
+  vk::DeviceSize textureBytes = 0;
+  for (const auto &[name, texture] : m_loadedTextures) {
+    textureBytes += allocationSize(texture.image.allocation);
+  }
+  vk::DeviceSize targetBytes = allocationSize(m_renderTarget.allocation) +
+                               allocationSize(m_depthImage.allocation) +
+                               allocationSize(m_hizImage.allocation);
+  vk::DeviceSize bufferBytes = allocationSize(m_cameraSceneBuffer.allocation) +
+                               allocationSize(m_materialBuffer.allocation);
+  for (const FrameData &frame : m_frames) {
+    for (const AllocatedBuffer *buffer :
+         {&frame.objectBuffer, &frame.objectLightingBuffer,
+          &frame.cullDataBuffer, &frame.indirectBuffer,
+          &frame.visibilityBuffer, &frame.cullStatsBuffer}) {
+      bufferBytes += allocationSize(buffer->allocation);
+    }
+  }
+  ImGui::Text("Meshes %.1f MB, textures %.1f MB", meshBytes / MB,
+              textureBytes / MB);
+  ImGui::Text("Render targets %.1f MB, frame buffers %.1f MB",
+              targetBytes / MB, bufferBytes / MB);
+
+  vk::PhysicalDeviceMemoryProperties memoryProperties =
+      m_physicalDevice.getMemoryProperties();
+  std::array<vma::Budget, VK_MAX_MEMORY_HEAPS> budgets;
+  m_allocator.getHeapBudgets(budgets.data());
+  for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+    bool deviceLocal = bool(memoryProperties.memoryHeaps[heap].flags &
+                            vk::MemoryHeapFlagBits::eDeviceLocal);
+    double usage = budgets[heap].usage / MB;
+    double budget = budgets[heap].budget / MB;
+    ImVec4 color = usage > budget * 0.9 ? ImVec4(1.f, 0.3f, 0.3f, 1.f)
+                                        : ImVec4(1.f, 1.f, 1.f, 1.f);
+    ImGui::TextColored(color, "Heap %u (%s): %.0f / %.0f MB", heap,
+                       deviceLocal ? "device" : "host", usage, budget);
+  }
+
+  // uploads the gpu hasn't finished and staging memory waiting on the gpu
+  ImGui::Separator();
+  uint64_t completed = completed_timeline_value();
+  while (!m_pendingUploads.empty() && m_pendingUploads.front() <= completed) {
+    m_pendingUploads.pop_front();
+  }
+  // submit_upload only blocks once every upload context is in flight
+  ImGui::Text("Uploads in flight %zu / %u, deferred deletions %zu",
+              m_pendingUploads.size(), UPLOAD_CONTEXT_COUNT,
+              m_deferredDeletionQueue.deletors.size());
+
+  ImGui::End();
+  ImGui::Render();
+}
+
+void VulkanEngine::record_hud(vk::CommandBuffer cmd,
+                              uint32_t swapchainImageIndex) {
+  if (!m_config.hud || !m_hudRenderPass) {
+    return;
+  }
+  auto now = FramePacer::Clock::now();
+  if (m_hudLastFrame != FramePacer::Clock::time_point{}) {
+    m_hudFrameGraph.push(
+        std::chrono::duration<float, std::milli>(now - m_hudLastFrame)
+            .count());
+  }
+  m_hudLastFrame = now;
+
+  // after the scene is recorded, so the counts are this frame's
+  build_hud();
+
+  GpuScope scope(m_profiler, cmd, m_frameNumber % FRAME_OVERLAP, "hud");
+  vk::RenderPassBeginInfo rpInfo;
+  rpInfo.renderPass = m_hudRenderPass;
+  rpInfo.renderArea.setOffset({0, 0});
+  rpInfo.renderArea.extent = m_windowExtent;
+  rpInfo.framebuffer = m_framebuffers[swapchainImageIndex];
+  cmd.beginRenderPass(rpInfo, vk::SubpassContents::eInline);
+  ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(),
+                                  static_cast<VkCommandBuffer>(cmd));
+  cmd.endRenderPass();
+}
+
+} // namespace vkr
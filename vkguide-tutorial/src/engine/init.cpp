@@ -10,41 +10,76 @@
 
 #include "common_includes.h"
 
+#include <chrono>
+
 // in package
 #include "engine.hpp"
 #include "pipeline.hpp"
 
 namespace vkr {
 
-VulkanEngine::VulkanEngine() {}
+VulkanEngine::VulkanEngine(HeadlessConfig headless, ReplayConfig replay)
+    : m_headless(std::move(headless)), m_replay(std::move(replay)) {}
 
 void VulkanEngine::init() {
-  // We initialize SDL and create a window with it.
-  SDL_Init(SDL_INIT_VIDEO);
-
-  SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN);
-
-  // create blank SDL window for our application
-  m_window = SDL_CreateWindow(
-      m_appName.c_str(),       // window title
-      SDL_WINDOWPOS_UNDEFINED, // window position x (don't care)
-      SDL_WINDOWPOS_UNDEFINED, // window position y (don't care)
-      m_windowExtent.width,    // window width in pixels
-      m_windowExtent.height,   // window height in pixels
-      window_flags);
+  EventLog::instance().start();
+  if (!m_headless.enabled) {
+    // We initialize SDL and create a window with it.
+    SDL_Init(SDL_INIT_VIDEO);
+
+    SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN);
+
+    // create blank SDL window for our application
+    m_window = SDL_CreateWindow(
+        m_appName.c_str(),       // window title
+        SDL_WINDOWPOS_UNDEFINED, // window position x (don't care)
+        SDL_WINDOWPOS_UNDEFINED, // window position y (don't care)
+        m_windowExtent.width,    // window width in pixels
+        m_windowExtent.height,   // window height in pixels
+        window_flags);
+  }
 
   init_vulkan();
   init_swapchain();
   init_commands();
   init_default_renderpass();
+  init_render_target();
   init_framebuffers();
   init_sync_structures();
+  init_queries();
   init_shader_modules();
   init_descriptors();
+  init_pipeline_cache();
+  // cold is the first launch on a device and driver, warm every later one.
+  // mesh pipelines compile on the pool while the rest of init runs
+  m_pipelinesStart = std::chrono::high_resolution_clock::now();
   init_pipelines();
+  init_upscale();
+  init_hiz();
+  spdlog::info("Created blocking pipelines in {:.1f}ms",
+               std::chrono::duration<double, std::milli>(
+                   std::chrono::high_resolution_clock::now() -
+                   m_pipelinesStart)
+                   .count());
+  spdlog::info("Reflected {} descriptor set layouts and {} pipeline layouts",
+               m_layoutCache.set_layout_count(),
+               m_layoutCache.pipeline_layout_count());
+  if (!m_headless.enabled) {
+    init_hud();
+  }
   load_meshes();
   load_images();
   init_scene();
+  m_framePacer.set_target_fps(m_config.targetFps);
+  init_replay();
+  // benchmarks and replays never measure placeholder frames
+  if (m_headless.enabled || replaying()) {
+    poll_pipeline_jobs(true);
+  }
+#ifdef VKR_PROFILING
+  ZoneProfiler::instance().start();
+#endif
+  start_simulation();
 
   // everything went fine
   m_isInitialized = true;
@@ -52,10 +87,12 @@ void VulkanEngine::init() {
 
 void VulkanEngine::init_vulkan() {
   vkb::InstanceBuilder instanceBuilder;
+  // headless skips the surface extensions, so no display or wsi is needed
   auto vkb_inst = instanceBuilder.set_app_name(m_appName.c_str())
                       .request_validation_layers(true)
                       .require_api_version(1, 3, 0)
                       .use_default_debug_messenger()
+                      .set_headless(m_headless.enabled)
                       .build()
                       .value();
 
@@ -68,34 +105,79 @@ void VulkanEngine::init_vulkan() {
 
   spdlog::info("Initialized vulkan instance via vkb");
 
-  SDL_Vulkan_CreateSurface(m_window, m_instance, (VkSurfaceKHR *)&m_surface);
-  spdlog::info("Initialized vulkan surface via sdl");
+  if (!m_headless.enabled) {
+    SDL_Vulkan_CreateSurface(m_window, m_instance,
+                             (VkSurfaceKHR *)&m_surface);
+    spdlog::info("Initialized vulkan surface via sdl");
+  }
 
+  // no required features, vkb would chain its own feature structures and
+  // refuse ours. devices are filtered and scored on their capabilities instead
   vkb::PhysicalDeviceSelector selector{vkb_inst};
-  vk::PhysicalDeviceVulkan13Features features_13;
-  features_13.dynamicRendering = true;
-  selector = selector.set_minimum_version(1, 3)
-                 .set_surface(m_surface)
-                 .set_required_features_13(
-                     static_cast<VkPhysicalDeviceVulkan13Features>(features_13))
-      /*
-      .add_required_extension("VK_KHR_acceleration_structure")
-      .add_required_extension("VK_KHR_ray_tracing_pipeline")
-      .add_required_extension("VK_NV_mesh_shader")
-      */
-      ;
-  auto availableDevices = selector.select_device_names();
-  uint32_t idx = 0;
-  for (std::string name : availableDevices.value()) {
-    spdlog::info("Available physical device {}: {}", idx++, name);
+  // a headless instance doesn't require presentation support or a surface
+  if (!m_headless.enabled) {
+    selector.set_surface(m_surface);
+  }
+  selector.set_minimum_version(1, 3);
+
+  std::vector<vkb::PhysicalDevice> candidates =
+      selector.select_devices().value();
+  std::optional<size_t> chosen;
+  uint32_t bestScore = 0;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    DeviceCapabilities caps =
+        query_device_capabilities(candidates[i].physical_device);
+    spdlog::info("Available physical device {}: {}, tier {}, score {}{}", i,
+                 caps.name, capability_tier_name(caps.tier()), caps.score(),
+                 caps.meets_baseline() ? "" : ", missing baseline features");
+    if (caps.meets_baseline() && (!chosen || caps.score() > bestScore)) {
+      chosen = i;
+      bestScore = caps.score();
+      m_capabilities = caps;
+    }
+  }
+  if (!chosen) {
+    throw std::runtime_error("No physical device supports timeline "
+                             "semaphores, dynamic rendering and shader draw "
+                             "parameters");
   }
+  spdlog::info("Selected {}", m_capabilities.report());
+  apply_capabilities();
+
+  // enable exactly the fast paths the device has
+  vk::StructureChain<vk::PhysicalDeviceFeatures2,
+                     vk::PhysicalDeviceVulkan11Features,
+                     vk::PhysicalDeviceVulkan12Features,
+                     vk::PhysicalDeviceVulkan13Features>
+      featureChain;
+  vk::PhysicalDeviceFeatures &features =
+      featureChain.get<vk::PhysicalDeviceFeatures2>().features;
+  features.pipelineStatisticsQuery = m_capabilities.pipelineStatistics;
+  features.drawIndirectFirstInstance = m_capabilities.drawIndirectFirstInstance;
+  features.inheritedQueries = m_capabilities.inheritedQueries;
+  featureChain.get<vk::PhysicalDeviceVulkan11Features>().shaderDrawParameters =
+      true;
+  vk::PhysicalDeviceVulkan12Features &features_12 =
+      featureChain.get<vk::PhysicalDeviceVulkan12Features>();
+  if (m_capabilities.descriptorIndexing) {
+    features_12.descriptorIndexing = true;
+    features_12.runtimeDescriptorArray = true;
+    features_12.shaderSampledImageArrayNonUniformIndexing = true;
+    features_12.descriptorBindingPartiallyBound = true;
+    features_12.descriptorBindingVariableDescriptorCount = true;
+    features_12.descriptorBindingSampledImageUpdateAfterBind = true;
+  }
+  // frame and upload progress
+  features_12.timelineSemaphore = true;
+  features_12.hostQueryReset = m_capabilities.hostQueryReset;
+  featureChain.get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering =
+      true;
 
-  vkb::PhysicalDevice physicalDevice = selector.select().value();
-  vkb::DeviceBuilder deviceBuilder(physicalDevice);
-  vk::PhysicalDeviceShaderDrawParametersFeatures
-      shader_draw_parameters_features(true);
+  vkb::DeviceBuilder deviceBuilder(candidates[*chosen]);
   vkb::Device vkbDevice =
-      deviceBuilder.add_pNext(&shader_draw_parameters_features).build().value();
+      deviceBuilder.add_pNext(&featureChain.get<vk::PhysicalDeviceFeatures2>())
+          .build()
+          .value();
 
   m_device = vkbDevice.device;
   m_physicalDevice = vkbDevice.physical_device;
@@ -121,24 +203,31 @@ void VulkanEngine::init_vulkan() {
   spdlog::info("Created vma allocator");
 }
 
-void VulkanEngine::init_swapchain() {
-  vkb::SwapchainBuilder swapchainBuilder(m_physicalDevice, m_device, m_surface);
-  vkb::Swapchain vkbSwapchain =
-      swapchainBuilder.use_default_format_selection()
-          .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
-          .set_desired_extent(m_windowExtent.width, m_windowExtent.height)
-          .build()
-          .value();
-  m_swapchain = vkbSwapchain.swapchain;
-  m_swapchainImageFormat = vk::Format(vkbSwapchain.image_format);
-
-  m_swapchainImages = vkbSwapchain.get_images().value();
-  m_swapchainImageViews = vkbSwapchain.get_image_views().value();
+void VulkanEngine::apply_capabilities() {
+  if (m_config.bindless && !m_capabilities.descriptorIndexing) {
+    spdlog::warn("No descriptor indexing, using a descriptor set per material");
+    m_config.bindless = false;
+  }
+  if (m_config.occlusionCulling && !m_capabilities.drawIndirectFirstInstance) {
+    spdlog::warn("No draw indirect first instance, hi-z culling disabled");
+    m_config.occlusionCulling = false;
+  }
+  if (m_config.pipelineStatistics && !m_capabilities.pipelineStatistics) {
+    spdlog::warn("No pipeline statistics queries, fragment counts disabled");
+    m_config.pipelineStatistics = false;
+  }
+  if (m_config.profiling && !m_capabilities.hostQueryReset) {
+    spdlog::warn("No host query reset, profiler disabled");
+    m_config.profiling = false;
+  }
+}
 
-  m_mainDeletionQueue.push_function(
-      [=]() { m_device.destroySwapchainKHR(m_swapchain); });
-  spdlog::info("Successfully initialized swapchain with {} images",
-               vkbSwapchain.image_count);
+void VulkanEngine::init_swapchain() {
+  if (m_headless.enabled) {
+    create_offscreen_images();
+  } else {
+    create_swapchain();
+  }
 
   // allocate depth image
   vk::Extent3D depthImageExtent(m_windowExtent.width, m_windowExtent.height, 1);
@@ -147,7 +236,9 @@ void VulkanEngine::init_swapchain() {
   dimgInfo.setFormat(m_depthFormat)
       .setImageType(vk::ImageType::e2D)
       .setExtent(depthImageExtent)
-      .setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment)
+      // sampled as the base of the hi-z pyramid
+      .setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                vk::ImageUsageFlagBits::eSampled)
       .setMipLevels(1)
       .setArrayLayers(1)
       .setSamples(vk::SampleCountFlagBits::e1)
@@ -181,19 +272,20 @@ void VulkanEngine::init_swapchain() {
 }
 
 void VulkanEngine::init_commands() {
-  // create upload command pool
+  // create upload command pools
   vk::CommandPoolCreateFlags uploadCommandPoolCreateFlags;
   vk::CommandPoolCreateInfo uploadCommandPoolInfo(uploadCommandPoolCreateFlags,
                                                   m_graphicsQueueFamily);
-  m_uploadContext.commandPool =
-      m_device.createCommandPool(uploadCommandPoolInfo);
-  m_mainDeletionQueue.push_function(
-      [&] { m_device.destroyCommandPool(m_uploadContext.commandPool); });
+  for (UploadContext &context : m_uploadContexts) {
+    context.commandPool = m_device.createCommandPool(uploadCommandPoolInfo);
+    m_mainDeletionQueue.push_function(
+        [&] { m_device.destroyCommandPool(context.commandPool); });
 
-  vk::CommandBufferAllocateInfo instantCommandBufferAllocateInfo(
-      m_uploadContext.commandPool, vk::CommandBufferLevel::ePrimary, 1);
-  m_uploadContext.commandBuffer =
-      m_device.allocateCommandBuffers(instantCommandBufferAllocateInfo)[0];
+    vk::CommandBufferAllocateInfo instantCommandBufferAllocateInfo(
+        context.commandPool, vk::CommandBufferLevel::ePrimary, 1);
+    context.commandBuffer =
+        m_device.allocateCommandBuffers(instantCommandBufferAllocateInfo)[0];
+  }
 
   vk::CommandPoolCreateFlags commandPoolCreateFlags;
   // allow resetting individual command buffers
@@ -219,14 +311,15 @@ void VulkanEngine::init_commands() {
 
 void VulkanEngine::init_default_renderpass() {
   vk::AttachmentDescription colorAttachment;
-  colorAttachment.format = m_swapchainImageFormat;
+  colorAttachment.format = m_renderTargetFormat;
   colorAttachment.samples = vk::SampleCountFlagBits::e1;
   colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
   colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
   colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
   colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
   colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-  colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+  // read by the upscale pass
+  colorAttachment.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
   vk::AttachmentReference colorAttachmentRef(
       {}, vk::ImageLayout::eColorAttachmentOptimal);
 
@@ -249,10 +342,13 @@ void VulkanEngine::init_default_renderpass() {
       .setColorAttachments(colorAttachmentRef)
       .setPDepthStencilAttachment(&depthAttachmentRef);
 
+  // the render target is shared by every frame in flight, the previous
+  // frame's upscale pass may still be reading it
   vk::SubpassDependency colorDep;
   colorDep.setSrcSubpass(VK_SUBPASS_EXTERNAL)
       .setDstSubpass(0)
-      .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                       vk::PipelineStageFlagBits::eFragmentShader)
       .setSrcAccessMask({})
       .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
       .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
@@ -276,14 +372,105 @@ void VulkanEngine::init_default_renderpass() {
       .setDependencies(dependencies);
   m_renderPass = m_device.createRenderPass(renderPassInfo);
 
-  m_mainDeletionQueue.push_function(
-      [=]() { m_device.destroyRenderPass(m_renderPass); });
-  spdlog::info("Initialized renderpass");
+  // upscale, overwrites every swapchain pixel so nothing is loaded
+  vk::AttachmentDescription swapchainAttachment;
+  swapchainAttachment.format = m_swapchainImageFormat;
+  swapchainAttachment.samples = vk::SampleCountFlagBits::e1;
+  swapchainAttachment.loadOp = vk::AttachmentLoadOp::eDontCare;
+  swapchainAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+  swapchainAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+  swapchainAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+  swapchainAttachment.initialLayout = vk::ImageLayout::eUndefined;
+  // headless frames are copied out instead of presented
+  swapchainAttachment.finalLayout = m_headless.enabled
+                                        ? vk::ImageLayout::eTransferSrcOptimal
+                                        : vk::ImageLayout::ePresentSrcKHR;
+
+  vk::SubpassDescription upscaleSubpass;
+  upscaleSubpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+      .setColorAttachments(colorAttachmentRef);
+
+  vk::SubpassDependency swapchainDep;
+  swapchainDep.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+      .setDstSubpass(0)
+      .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setSrcAccessMask({})
+      .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
+
+  // scene color writes visible to the upscale reads
+  vk::SubpassDependency sceneDep;
+  sceneDep.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+      .setDstSubpass(0)
+      .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+      .setDstStageMask(vk::PipelineStageFlagBits::eFragmentShader)
+      .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+  auto upscaleDependencies = {swapchainDep, sceneDep};
+
+  vk::RenderPassCreateInfo upscalePassInfo;
+  upscalePassInfo.setAttachments(swapchainAttachment)
+      .setSubpasses(upscaleSubpass)
+      .setDependencies(upscaleDependencies);
+  m_upscaleRenderPass = m_device.createRenderPass(upscalePassInfo);
+
+  m_mainDeletionQueue.push_function([=]() {
+    m_device.destroyRenderPass(m_upscaleRenderPass);
+    m_device.destroyRenderPass(m_renderPass);
+  });
+  spdlog::info("Initialized renderpasses");
+}
+
+void VulkanEngine::create_swapchain() {
+  m_presentMode = select_present_mode(m_config.presentMode);
+
+  vkb::SwapchainBuilder swapchainBuilder(m_physicalDevice, m_device, m_surface);
+  vkb::Swapchain vkbSwapchain =
+      swapchainBuilder.use_default_format_selection()
+          .set_desired_present_mode(VkPresentModeKHR(m_presentMode))
+          .set_desired_extent(m_windowExtent.width, m_windowExtent.height)
+          .build()
+          .value();
+  m_swapchain = vkbSwapchain.swapchain;
+  m_swapchainImageFormat = vk::Format(vkbSwapchain.image_format);
+
+  m_swapchainImages = vkbSwapchain.get_images().value();
+  m_swapchainImageViews = vkbSwapchain.get_image_views().value();
+
+  // the handle is captured, m_swapchain is already the new one on recreation
+  m_swapchainDeletionQueue.push_function([=, swapchain = m_swapchain]() {
+    m_device.destroySwapchainKHR(swapchain);
+  });
+  spdlog::info("Successfully initialized swapchain with {} images, present "
+               "mode {}",
+               vkbSwapchain.image_count, vk::to_string(m_presentMode));
+}
+
+vk::PresentModeKHR
+VulkanEngine::select_present_mode(vk::PresentModeKHR desired) {
+  auto presentModes = m_physicalDevice.getSurfacePresentModesKHR(m_surface);
+  if (std::find(presentModes.begin(), presentModes.end(), desired) !=
+      presentModes.end()) {
+    return desired;
+  }
+  // the only mode the spec guarantees
+  spdlog::warn("Present mode {} not supported, falling back to fifo",
+               vk::to_string(desired));
+  return vk::PresentModeKHR::eFifo;
+}
+
+void VulkanEngine::recreate_swapchain() {
+  // frames in flight still reference the old framebuffers
+  m_device.waitIdle();
+  m_swapchainDeletionQueue.flush();
+  create_swapchain();
+  init_framebuffers();
 }
 
 void VulkanEngine::init_framebuffers() {
   vk::FramebufferCreateInfo fbInfo;
-  fbInfo.renderPass = m_renderPass;
+  fbInfo.renderPass = m_upscaleRenderPass;
   fbInfo.width = m_windowExtent.width;
   fbInfo.height = m_windowExtent.height;
   fbInfo.layers = 1;
@@ -291,11 +478,10 @@ void VulkanEngine::init_framebuffers() {
   m_framebuffers = std::vector<vk::Framebuffer>(m_swapchainImages.size());
   for (uint32_t i = 0; i < m_swapchainImages.size(); i++) {
     auto iv = vk::ImageView(m_swapchainImageViews[i]);
-    auto attachments = {iv, m_depthImageView};
-    fbInfo.setAttachments(attachments);
+    fbInfo.setAttachments(iv);
     m_framebuffers[i] = m_device.createFramebuffer(fbInfo);
 
-    m_mainDeletionQueue.push_function([=]() {
+    m_swapchainDeletionQueue.push_function([=]() {
       m_device.destroyFramebuffer(m_framebuffers[i]);
       m_device.destroyImageView(m_swapchainImageViews[i]);
     });
@@ -305,22 +491,19 @@ void VulkanEngine::init_framebuffers() {
 }
 
 void VulkanEngine::init_sync_structures() {
-  // create so that the fence is default signaled
-  vk::FenceCreateInfo fenceCreateInfo;
-  fenceCreateInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
-
-  vk::FenceCreateInfo uploadFenceCreateInfo;
-  m_uploadContext.uploadFence = m_device.createFence(uploadFenceCreateInfo);
+  // starts at 0, which every unused frame slot and the upload context treat
+  // as already reached
+  vk::SemaphoreTypeCreateInfo timelineTypeInfo(vk::SemaphoreType::eTimeline,
+                                               0);
+  vk::SemaphoreCreateInfo timelineCreateInfo;
+  timelineCreateInfo.setPNext(&timelineTypeInfo);
+  m_timeline = m_device.createSemaphore(timelineCreateInfo);
 
   m_mainDeletionQueue.push_function(
-      [=]() { m_device.destroyFence(m_uploadContext.uploadFence); });
+      [=]() { m_device.destroySemaphore(m_timeline); });
 
   for (FrameData &frame : m_frames) {
-    frame.m_renderFence = m_device.createFence(fenceCreateInfo);
-
-    m_mainDeletionQueue.push_function(
-        [=]() { m_device.destroyFence(frame.m_renderFence); });
-
+    // binary, presentation can't wait on a timeline semaphore
     vk::SemaphoreCreateInfo semaphoreCreateInfo;
     frame.m_presentSemaphore = m_device.createSemaphore(semaphoreCreateInfo);
     frame.m_renderSemaphore = m_device.createSemaphore(semaphoreCreateInfo);
@@ -332,6 +515,36 @@ void VulkanEngine::init_sync_structures() {
   }
 }
 
+void VulkanEngine::init_queries() {
+  // needs the feature even if it's never used
+  if (m_capabilities.pipelineStatistics) {
+    vk::QueryPoolCreateInfo queryPoolInfo;
+    queryPoolInfo.setQueryType(vk::QueryType::ePipelineStatistics);
+    queryPoolInfo.setQueryCount(FRAME_OVERLAP);
+    queryPoolInfo.setPipelineStatistics(
+        vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations);
+    m_statsQueryPool = m_device.createQueryPool(queryPoolInfo);
+  }
+
+  // one slot per frame in flight and per upload context. frame timing runs
+  // even with profiling off, dynamic resolution and the hud depend on it
+  uint32_t timestampValidBits =
+      m_physicalDevice.getQueueFamilyProperties()[m_graphicsQueueFamily]
+          .timestampValidBits;
+  m_profiler.init(m_device, m_gpuProperties.limits.timestampPeriod,
+                  timestampValidBits, FRAME_OVERLAP + UPLOAD_CONTEXT_COUNT,
+                  m_config.profiling);
+  if (m_config.profiling) {
+    m_profiler.set_thread_name("render");
+  }
+
+  m_mainDeletionQueue.push_function([=]() {
+    m_profiler.destroy();
+    m_device.destroyQueryPool(m_statsQueryPool);
+  });
+  spdlog::info("Initialized pipeline statistics and timestamp queries");
+}
+
 // TODO: move this to utils and make generic (don't depend on engine?)
 size_t VulkanEngine::pad_uniform_buffer_size(size_t originalSize) {
   // Calculate required alignment based on minimum device offset alignment
@@ -358,22 +571,20 @@ void VulkanEngine::init_descriptors() {
 
   m_descriptorPool = m_device.createDescriptorPool(poolInfo, nullptr);
 
-  // camera data at 0
-  vk::DescriptorSetLayoutBinding camBufferBinding;
-  camBufferBinding.setBinding(0);
-  camBufferBinding.setDescriptorCount(1);
-  camBufferBinding.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic);
-  camBufferBinding.setStageFlags(vk::ShaderStageFlagBits::eVertex);
-  // scene data at 1
-  vk::DescriptorSetLayoutBinding sceneBind(
-      1, vk::DescriptorType::eUniformBufferDynamic, 1,
-      vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
-
-  vk::DescriptorSetLayoutBinding bindings[] = {camBufferBinding, sceneBind};
-
-  vk::DescriptorSetLayoutCreateInfo setInfo;
-  setInfo.setBindings(bindings);
-  m_globalSetLayout = m_device.createDescriptorSetLayout(setInfo, nullptr);
+  m_layoutCache.init(m_device, MAX_BINDLESS_TEXTURES);
+  m_mainDeletionQueue.push_function([=]() { m_layoutCache.destroy(); });
+
+  // sets 0 and 1 are bound once per pass for every mesh pipeline, so their
+  // layouts come from all mesh vertex shaders at once. mesh_untextured.frag
+  // is the fragment side of set 0, every mesh.frag variant shares it
+  ShaderReflection meshSets =
+      m_shaderReflections.at("basic_normalcolor_mesh.vert");
+  meshSets.merge(m_shaderReflections.at("depth_only.vert"));
+  meshSets.merge(m_shaderReflections.at("mesh_untextured.frag"));
+  // camera data at 0 and scene data at 1, both offset per frame
+  meshSets.override_type(0, 0, vk::DescriptorType::eUniformBufferDynamic);
+  meshSets.override_type(0, 1, vk::DescriptorType::eUniformBufferDynamic);
+  m_globalSetLayout = m_layoutCache.set_layout(meshSets.sets.at(0));
 
   // allocate global descriptor set
   vk::DescriptorSetAllocateInfo allocInfo;
@@ -403,33 +614,14 @@ void VulkanEngine::init_descriptors() {
   sceneInfo.setRange(sizeof(GPUSceneData));
 
   // per-object bindings
-  vk::DescriptorSetLayoutBinding objectBind(
-      0, vk::DescriptorType::eStorageBuffer, 1,
-      vk::ShaderStageFlagBits::eVertex);
-  vk::DescriptorSetLayoutBinding objectLightingBind(
-      1, vk::DescriptorType::eStorageBuffer, 1,
-      vk::ShaderStageFlagBits::eVertex);
-  vk::DescriptorSetLayoutBinding objectBindings[] = {objectBind,
-                                                     objectLightingBind};
-  vk::DescriptorSetLayoutCreateInfo objectSetInfo;
-  objectSetInfo.setBindings(objectBindings);
-  m_objectSetLayout = m_device.createDescriptorSetLayout(objectSetInfo);
+  m_objectSetLayout = m_layoutCache.set_layout(meshSets.sets.at(1));
 
   // single texture set
-  vk::DescriptorSetLayoutBinding textureBind(
-      0, vk::DescriptorType::eCombinedImageSampler, 1,
-      vk::ShaderStageFlagBits::eFragment);
-
-  vk::DescriptorSetLayoutCreateInfo textureSetInfo;
-  textureSetInfo.setBindings(textureBind);
-  m_singleTextureSetLayout = m_device.createDescriptorSetLayout(textureSetInfo);
+  m_singleTextureSetLayout = m_layoutCache.set_layout(
+      m_shaderReflections.at("mesh_single.frag").sets.at(2));
 
-  m_mainDeletionQueue.push_function([&]() {
-    m_device.destroyDescriptorSetLayout(m_globalSetLayout);
-    m_device.destroyDescriptorSetLayout(m_objectSetLayout);
-    m_device.destroyDescriptorSetLayout(m_singleTextureSetLayout);
-    m_device.destroyDescriptorPool(m_descriptorPool);
-  });
+  m_mainDeletionQueue.push_function(
+      [&]() { m_device.destroyDescriptorPool(m_descriptorPool); });
 
   size_t i = 0;
   for (FrameData &frame : m_frames) {
@@ -440,7 +632,6 @@ void VulkanEngine::init_descriptors() {
         m_device.allocateDescriptorSets(objectSetAlloc)[0];
 
     // allocate ssbo buffer for object data
-    const int MAX_OBJECTS = 10000;
     frame.objectBuffer = create_buffer(
         sizeof(GPUObjectData) * MAX_OBJECTS,
         vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eAuto,
@@ -486,6 +677,78 @@ void VulkanEngine::init_descriptors() {
     });
     i++;
   }
+
+  init_bindless_descriptors();
+}
+
+void VulkanEngine::init_bindless_descriptors() {
+  // material ssbo, indexed by Material::materialIndex in the shaders
+  m_materialBuffer = create_buffer(
+      sizeof(GPUMaterialData) * MAX_MATERIALS,
+      vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eAuto,
+      vma::AllocationCreateFlagBits::eHostAccessSequentialWrite);
+  m_mainDeletionQueue.push_function([&]() {
+    m_allocator.destroyBuffer(m_materialBuffer.buffer,
+                              m_materialBuffer.allocation);
+  });
+
+  if (!m_config.bindless) {
+    spdlog::info("Bindless textures disabled, using per material sets");
+    return;
+  }
+
+  // update after bind so textures can be registered while frames that already
+  // bound the set are still in flight
+  std::vector<vk::DescriptorPoolSize> sizes = {
+      {vk::DescriptorType::eStorageBuffer, 1},
+      {vk::DescriptorType::eCombinedImageSampler, MAX_BINDLESS_TEXTURES}};
+  vk::DescriptorPoolCreateInfo poolInfo;
+  poolInfo.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind);
+  poolInfo.setMaxSets(1);
+  poolInfo.setPoolSizes(sizes);
+  m_bindlessDescriptorPool = m_device.createDescriptorPool(poolInfo);
+
+  // materials at 0, texture array at 1 (variable count must be last). the
+  // layout cache makes the runtime sized array MAX_BINDLESS_TEXTURES long,
+  // partially bound and update after bind
+  m_bindlessSetLayout = m_layoutCache.set_layout(
+      m_shaderReflections.at("mesh.frag").sets.at(2));
+
+  uint32_t variableCount = MAX_BINDLESS_TEXTURES;
+  vk::DescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo(
+      1, &variableCount);
+  vk::DescriptorSetAllocateInfo allocInfo(m_bindlessDescriptorPool, 1,
+                                          &m_bindlessSetLayout);
+  allocInfo.setPNext(&variableCountInfo);
+  m_bindlessDescriptorSet = m_device.allocateDescriptorSets(allocInfo)[0];
+
+  vk::DescriptorBufferInfo materialInfo(m_materialBuffer.buffer, 0,
+                                        sizeof(GPUMaterialData) *
+                                            MAX_MATERIALS);
+  vk::WriteDescriptorSet materialWrite(m_bindlessDescriptorSet, 0, 0, 1,
+                                       vk::DescriptorType::eStorageBuffer,
+                                       nullptr, &materialInfo, nullptr);
+  m_device.updateDescriptorSets(materialWrite, nullptr);
+
+  m_mainDeletionQueue.push_function([&]() {
+    m_device.destroyDescriptorPool(m_bindlessDescriptorPool);
+  });
+
+  spdlog::info("Initialized bindless descriptors with {} texture slots",
+               MAX_BINDLESS_TEXTURES);
+}
+
+void VulkanEngine::init_pipeline_cache() {
+  m_pipelineCache.init(m_device, m_physicalDevice.getProperties(),
+                       "pipeline_cache.bin");
+  m_mainDeletionQueue.push_function([=]() {
+    m_pipelineCache.save();
+    m_pipelineCache.destroy();
+  });
+
+  m_pipelineStates.init(m_device, m_pipelineCache.handle());
+  // the cleanup of init_pipelines waits for the jobs before this runs
+  m_mainDeletionQueue.push_function([=]() { m_pipelineStates.destroy(); });
 }
 
 void VulkanEngine::init_pipelines() {
@@ -509,6 +772,9 @@ void VulkanEngine::init_pipelines() {
 
   pipelineBuilder.scissor.setOffset({0, 0});
   pipelineBuilder.scissor.setExtent(m_windowExtent);
+  // follows the render scale, see set_render_viewport
+  pipelineBuilder.dynamicStates = {vk::DynamicState::eViewport,
+                                   vk::DynamicState::eScissor};
 
   pipelineBuilder.rasterizer =
       PipelineBuilder::default_rasterization_state_create_info(
@@ -519,34 +785,18 @@ void VulkanEngine::init_pipelines() {
   pipelineBuilder.colorBlendAttachment =
       PipelineBuilder::default_color_blend_attachment_state();
 
-  vk::PipelineLayoutCreateInfo meshPipelineLayoutInfo =
-      PipelineBuilder::default_pipeline_layout_create_info();
-  // push constant setup
-  vk::PushConstantRange pushConstant;
-  pushConstant.setSize(sizeof(MeshPushConstants))
-      .setOffset(0)
-      .setStageFlags(vk::ShaderStageFlagBits::eVertex);
-  meshPipelineLayoutInfo.setPushConstantRanges(pushConstant);
-
-  vk::DescriptorSetLayout setLayouts[] = {m_globalSetLayout, m_objectSetLayout};
-  meshPipelineLayoutInfo.setSetLayouts(setLayouts);
-  m_meshPipelineLayout = m_device.createPipelineLayout(meshPipelineLayoutInfo);
-
-  // setup textured pipeline layout
-  vk::PipelineLayoutCreateInfo texturedPipelineCreateInfo =
-      meshPipelineLayoutInfo;
-  vk::DescriptorSetLayout texturedSetLayouts[] = {
-      m_globalSetLayout, m_objectSetLayout, m_singleTextureSetLayout};
-  texturedPipelineCreateInfo.setSetLayouts(texturedSetLayouts);
-  vk::PipelineLayout texturedPipelineLayout =
-      m_device.createPipelineLayout(texturedPipelineCreateInfo);
-
-  // default vertices
-  VertexInputDescription vertexDescription = Vertex::get_vertex_description();
+  // in bindless mode every mesh.frag variant is the same one, so every mesh
+  // pipeline gets the same layout and all 3 sets stay bound across pipeline
+  // switches
+  m_meshPipelineLayout = mesh_pipeline_layout(
+      m_config.bindless ? "mesh.frag" : "mesh_untextured.frag");
+
+  // default vertices, jobs keep pointing at these
+  m_vertexDescription = Vertex::get_vertex_description();
   pipelineBuilder.vertexInputInfo.setVertexAttributeDescriptions(
-      vertexDescription.attributes);
+      m_vertexDescription.attributes);
   pipelineBuilder.vertexInputInfo.setVertexBindingDescriptions(
-      vertexDescription.bindings);
+      m_vertexDescription.bindings);
 
   // default depth
   pipelineBuilder.pipelineLayout = m_meshPipelineLayout;
@@ -554,7 +804,9 @@ void VulkanEngine::init_pipelines() {
       PipelineBuilder::default_depth_stencil_create_info(
           true, true, vk::CompareOp::eLessOrEqual);
 
-  // create default mesh pipeline
+  // the only pipeline built here, every material draws with it until its own
+  // pipelines are installed by poll_pipeline_jobs. its layout shares sets 0
+  // and 1 and the push constants with every material layout
   pipelineBuilder.shaderStages.clear();
   pipelineBuilder.shaderStages.push_back(
       PipelineBuilder::default_pipeline_shader_stage_create_info(
@@ -563,35 +815,114 @@ void VulkanEngine::init_pipelines() {
   pipelineBuilder.shaderStages.push_back(
       PipelineBuilder::default_pipeline_shader_stage_create_info(
           vk::ShaderStageFlagBits::eFragment,
-          m_shaderModules["basic_flat_mesh.frag"]));
+          m_shaderModules["placeholder.frag"]));
+  m_placeholderPipeline = pipelineBuilder.build(m_pipelineStates, m_renderPass);
+  m_meshPipelineBuilder = pipelineBuilder;
 
-  m_meshPipeline = pipelineBuilder.build(m_device, m_renderPass);
-  create_material(m_meshPipeline, m_meshPipelineLayout, "defaultmesh");
+  // vertex color plus ambient, the flat look untextured meshes always had
+  request_material("defaultmesh", MATERIAL_VERTEX_COLOR | MATERIAL_LIT);
+  request_material("texturedmesh", MATERIAL_TEXTURED);
 
-  // create pipeline for textured drawing
-  pipelineBuilder.pipelineLayout = texturedPipelineLayout;
+  // depth prepass, positions only and no color writes
+  m_positionVertexDescription = Vertex::get_position_vertex_description();
+  pipelineBuilder.vertexInputInfo.setVertexAttributeDescriptions(
+      m_positionVertexDescription.attributes);
+  pipelineBuilder.vertexInputInfo.setVertexBindingDescriptions(
+      m_positionVertexDescription.bindings);
+  pipelineBuilder.pipelineLayout = m_meshPipelineLayout;
+  pipelineBuilder.depthStencil =
+      PipelineBuilder::default_depth_stencil_create_info(
+          true, true, vk::CompareOp::eLessOrEqual);
+  pipelineBuilder.colorBlendAttachment.setColorWriteMask({});
   pipelineBuilder.shaderStages.clear();
   pipelineBuilder.shaderStages.push_back(
       PipelineBuilder::default_pipeline_shader_stage_create_info(
-          vk::ShaderStageFlagBits::eVertex,
-          m_shaderModules["basic_normalcolor_mesh.vert"]));
-  pipelineBuilder.shaderStages.push_back(
-      PipelineBuilder::default_pipeline_shader_stage_create_info(
-          vk::ShaderStageFlagBits::eFragment,
-          m_shaderModules["textured_lit.frag"]));
-  vk::Pipeline texPipeline = pipelineBuilder.build(m_device, m_renderPass);
-  create_material(texPipeline, texturedPipelineLayout, "texturedmesh");
+          vk::ShaderStageFlagBits::eVertex, m_shaderModules["depth_only.vert"]));
+  submit_pipeline_job(
+      pipelineBuilder, m_renderPass,
+      [this](vk::Pipeline pipeline) { m_depthPrepassPipeline = pipeline; });
 
-  //
+  spdlog::info("Started {} mesh pipeline jobs", m_pipelineJobs.size());
+}
 
-  m_mainDeletionQueue.push_function([=]() {
-    m_device.destroyPipeline(m_meshPipeline);
-    m_device.destroyPipeline(texPipeline);
-    m_device.destroyPipelineLayout(m_meshPipelineLayout);
-    m_device.destroyPipelineLayout(texturedPipelineLayout);
+vk::PipelineLayout
+VulkanEngine::mesh_pipeline_layout(const std::string &fragment) {
+  ShaderReflection reflection =
+      m_shaderReflections.at("basic_normalcolor_mesh.vert");
+  reflection.merge(m_shaderReflections.at(fragment));
+
+  // sets 0 and 1 are the shared ones from init_descriptors, what the shaders
+  // declare there is already part of them
+  std::vector<vk::DescriptorSetLayout> setLayouts = {m_globalSetLayout,
+                                                     m_objectSetLayout};
+  for (const auto &[set, bindings] : reflection.sets) {
+    if (set < setLayouts.size()) {
+      continue;
+    }
+    while (setLayouts.size() < set) {
+      setLayouts.push_back(m_layoutCache.set_layout({}));
+    }
+    setLayouts.push_back(m_layoutCache.set_layout(bindings));
+  }
+  return m_layoutCache.pipeline_layout(setLayouts,
+                                       reflection.push_constant_ranges());
+}
+
+void VulkanEngine::submit_pipeline_job(
+    const PipelineBuilder &builder, vk::RenderPass pass,
+    std::function<void(vk::Pipeline)> &&install) {
+  auto job = std::make_unique<PipelineJob>();
+  job->install = std::move(install);
+  PipelineJob *target = job.get();
+  // the builder is copied, handles and the create info pointers it holds
+  // have to outlive the job
+  job->done = m_compilePool.submit([this, target, builder, pass]() {
+    target->pipeline = builder.build(m_pipelineStates, pass);
   });
+  m_pipelineJobs.push_back(std::move(job));
+}
+
+void VulkanEngine::poll_pipeline_jobs(bool wait) {
+  if (m_pipelineJobs.empty()) {
+    return;
+  }
+  auto install = [&](std::unique_ptr<PipelineJob> &job) {
+    if (!wait && job->done.wait_for(std::chrono::seconds(0)) !=
+                     std::future_status::ready) {
+      return false;
+    }
+    // rethrows what the build threw
+    job->done.get();
+    job->install(job->pipeline);
+    return true;
+  };
+  size_t pending = m_pipelineJobs.size();
+  m_pipelineJobs.erase(std::remove_if(m_pipelineJobs.begin(),
+                                      m_pipelineJobs.end(), install),
+                       m_pipelineJobs.end());
+  if (m_pipelineJobs.size() == pending) {
+    return;
+  }
+  // only a pipeline the cached secondaries were recorded with forces them to
+  // re-record
+  if (static_commands_outdated()) {
+    invalidate_static_commands();
+  }
 
-  spdlog::info("Finished building mesh triangle pipeline");
+  if (m_pipelineJobs.empty()) {
+    PipelineStateCache::Stats stats = m_pipelineStates.stats();
+    spdlog::info("All pipelines compiled {:.1f}ms after they started, from a "
+                 "{} pipeline cache. {} live pipelines, {} of {} builds "
+                 "deduplicated",
+                 std::chrono::duration<double, std::milli>(
+                     std::chrono::high_resolution_clock::now() -
+                     m_pipelinesStart)
+                     .count(),
+                 m_pipelineCache.warm() ? "warm" : "cold", stats.live,
+                 stats.hits, stats.hits + stats.misses);
+    // the next launch starts warm even if this one never exits cleanly
+    m_pipelineCache.save();
+  }
 }
 
 // according to new reference docs, usage should be one of the AUTO enumerations
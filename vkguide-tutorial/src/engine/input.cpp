@@ -2,11 +2,14 @@
 
 #include <glm/ext/matrix_transform.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 #include "engine.hpp"
 
 namespace vkr {
 void VulkanEngine::input_handle_keydown(SDL_Scancode &key) {
-  spdlog::info("Keydown on key {}", key);
+  VKR_LOG_INFO(LOG_INPUT, "Keydown on key {}", key);
 
   float translateCameraSpeed = 0.1;
   glm::vec3 translateCameraDirection = glm::vec3(0.);
@@ -39,7 +42,105 @@ void VulkanEngine::input_handle_keydown(SDL_Scancode &key) {
 }
 
 void VulkanEngine::input_handle_keyup(SDL_Scancode &key) {
-  spdlog::info("Keyup on key {}", key);
+  VKR_LOG_INFO(LOG_INPUT, "Keyup on key {}", key);
+
+  switch (key) {
+  case SDL_SCANCODE_P:
+    m_config.depthPrepass = !m_config.depthPrepass;
+    spdlog::info("Depth prepass {}", m_config.depthPrepass ? "on" : "off");
+    break;
+  case SDL_SCANCODE_F:
+    m_config.frontToBack = !m_config.frontToBack;
+    spdlog::info("Front to back sorting {}",
+                 m_config.frontToBack ? "on" : "off");
+    break;
+  case SDL_SCANCODE_O:
+    if (!m_capabilities.drawIndirectFirstInstance) {
+      spdlog::warn("Hi-z culling needs draw indirect first instance");
+      return;
+    }
+    m_config.occlusionCulling = !m_config.occlusionCulling;
+    spdlog::info("Occlusion culling {}",
+                 m_config.occlusionCulling ? "on" : "off");
+    m_cullStats = {};
+    m_cullStatsFrames = 0;
+    break;
+  case SDL_SCANCODE_M:
+    m_config.softwareOcclusion = !m_config.softwareOcclusion;
+    spdlog::info("Cpu masked occlusion culling {}",
+                 m_config.softwareOcclusion ? "on" : "off");
+    m_softwareCulled = 0;
+    m_softwareFrames = 0;
+    m_softwareRasterMs = 0.;
+    m_softwareTestMs = 0.;
+    break;
+  case SDL_SCANCODE_C:
+    m_config.staticCommandCache = !m_config.staticCommandCache;
+    spdlog::info("Static command cache {}",
+                 m_config.staticCommandCache ? "on" : "off");
+    break;
+  // a render scale change invalidates cached commands by itself
+  case SDL_SCANCODE_R:
+    m_config.dynamicResolution = !m_config.dynamicResolution;
+    spdlog::info("Dynamic resolution {}",
+                 m_config.dynamicResolution ? "on" : "off");
+    return;
+  case SDL_SCANCODE_U:
+    m_config.upscaleFilter =
+        UpscaleFilter((uint32_t(m_config.upscaleFilter) + 1) %
+                      uint32_t(UpscaleFilter::Count));
+    spdlog::info("Upscale filter {}",
+                 m_config.upscaleFilter == UpscaleFilter::Bilinear
+                     ? "bilinear"
+                     : "catmull-rom");
+    return;
+  // frame pacing, none of these touch the draw path
+  case SDL_SCANCODE_1:
+    set_present_mode(vk::PresentModeKHR::eFifo);
+    return;
+  case SDL_SCANCODE_2:
+    set_present_mode(vk::PresentModeKHR::eFifoRelaxed);
+    return;
+  case SDL_SCANCODE_3:
+    set_present_mode(vk::PresentModeKHR::eMailbox);
+    return;
+  case SDL_SCANCODE_4:
+    set_present_mode(vk::PresentModeKHR::eImmediate);
+    return;
+  case SDL_SCANCODE_L: {
+    // cycles through unlimited and a few common refresh rates
+    constexpr double limits[] = {0., 30., 60., 144.};
+    const double *current = std::find(std::begin(limits), std::end(limits),
+                                      m_framePacer.target_fps());
+    size_t next = current == std::end(limits)
+                      ? 0
+                      : (current - std::begin(limits) + 1) % std::size(limits);
+    m_config.targetFps = limits[next];
+    m_framePacer.set_target_fps(m_config.targetFps);
+    m_framePacer.reset_stats();
+    spdlog::info("Frame limit {} fps", limits[next]);
+    return;
+  }
+  // the overlay never touches the scene, so nothing below applies
+  case SDL_SCANCODE_H:
+    m_config.hud = !m_config.hud;
+    m_hudLastFrame = {};
+    spdlog::info("Hud {}", m_config.hud ? "on" : "off");
+    return;
+  case SDL_SCANCODE_K:
+    m_config.maxFrameLatency = m_config.maxFrameLatency % FRAME_OVERLAP + 1;
+    m_framePacer.reset_stats();
+    spdlog::info("Max frame latency {}", m_config.maxFrameLatency);
+    return;
+  default:
+    return;
+  }
+
+  // don't average fragment counts across the toggle
+  m_fragmentInvocations = 0;
+  m_statsFrames = 0;
+  // cached commands bake in the draw path
+  invalidate_static_commands();
 }
 
 } // namespace vkr
\ No newline at end of file
@@ -9,11 +9,111 @@ Material *VulkanEngine::create_material(VkPipeline pipeline,
                                         const std::string &name) {
   Material mat;
   mat.pipeline = pipeline;
+  // eLessOrEqual also passes after a prepass, callers can swap in a cheaper
+  // eEqual variant
+  mat.depthEqualPipeline = pipeline;
   mat.pipelineLayout = layout;
+
+  auto existing = m_materials.find(name);
+  if (existing != m_materials.end()) {
+    // keep the ssbo slot when a material is recreated
+    mat.materialIndex = existing->second.materialIndex;
+  } else {
+    if (m_materialData.size() >= MAX_MATERIALS) {
+      throw std::runtime_error(
+          fmt::format("Too many materials, cannot create {}", name));
+    }
+    mat.materialIndex = m_materialData.size();
+    m_materialData.push_back({});
+  }
   m_materials[name] = mat;
+  // cached commands may hold the old pipeline
+  invalidate_static_commands();
+
+  // untextured white until someone says otherwise
+  GPUMaterialData data;
+  data.baseColor = glm::vec4(1.);
+  data.textureIndices = glm::ivec4(-1);
+  update_material_data(m_materials[name], data);
   return &m_materials[name];
 }
 
+void VulkanEngine::update_material_data(const Material &material,
+                                        const GPUMaterialData &data) {
+  m_materialData[material.materialIndex] = data;
+
+  // the material ssbo is not per frame, this is only safe to call while no
+  // frame reading the material is in flight (init time for now)
+  char *gpuData = (char *)m_allocator.mapMemory(m_materialBuffer.allocation);
+  memcpy(gpuData + sizeof(GPUMaterialData) * material.materialIndex, &data,
+         sizeof(GPUMaterialData));
+  m_allocator.unmapMemory(m_materialBuffer.allocation);
+}
+
+Material *VulkanEngine::request_material(const std::string &name,
+                                         MaterialFeatures features) {
+  features &= MATERIAL_FEATURE_MASK;
+  // without bindless only textured materials have a set 2
+  bool textured = features & MATERIAL_TEXTURED;
+  const char *fragment = m_config.bindless ? "mesh.frag"
+                         : textured        ? "mesh_single.frag"
+                                           : "mesh_untextured.frag";
+  vk::PipelineLayout layout = mesh_pipeline_layout(fragment);
+  Material *material = create_material(m_placeholderPipeline, layout, name);
+  material->features = features;
+
+  auto [it, inserted] = m_meshPermutations.try_emplace(features);
+  if (!inserted) {
+    // compiled or on its way, the jobs below pick this material up
+    if (it->second.pipeline) {
+      material->pipeline = it->second.pipeline;
+    }
+    if (it->second.depthEqualPipeline) {
+      material->depthEqualPipeline = it->second.depthEqualPipeline;
+    }
+    return material;
+  }
+
+  PipelineBuilder builder = m_meshPipelineBuilder;
+  builder.pipelineLayout = layout;
+  builder.shaderStages.back() =
+      PipelineBuilder::default_pipeline_shader_stage_create_info(
+          vk::ShaderStageFlagBits::eFragment, m_shaderModules[fragment]);
+  builder.shaderStages.back().setPSpecializationInfo(
+      mesh_specialization(features));
+
+  // installs into every material of the permutation, including the ones
+  // requested while it compiled
+  builder.depthStencil = PipelineBuilder::default_depth_stencil_create_info(
+      true, true, vk::CompareOp::eLessOrEqual);
+  submit_pipeline_job(builder, m_renderPass,
+                      [this, features](vk::Pipeline pipeline) {
+                        m_meshPermutations[features].pipeline = pipeline;
+                        for (auto &[matName, mat] : m_materials) {
+                          if (mat.features == features) {
+                            mat.pipeline = pipeline;
+                          }
+                        }
+                      });
+
+  // variant for after the depth prepass, depth is already final so only shade
+  // the fragments that match it exactly
+  builder.depthStencil = PipelineBuilder::default_depth_stencil_create_info(
+      true, false, vk::CompareOp::eEqual);
+  submit_pipeline_job(
+      builder, m_renderPass, [this, features](vk::Pipeline pipeline) {
+        m_meshPermutations[features].depthEqualPipeline = pipeline;
+        for (auto &[matName, mat] : m_materials) {
+          if (mat.features == features) {
+            mat.depthEqualPipeline = pipeline;
+          }
+        }
+      });
+  spdlog::info("Compiling mesh permutation {} for {}",
+               material_features_name(features), name);
+  return material;
+}
+
 Material *VulkanEngine::get_material(const std::string &name) {
   auto it = m_materials.find(name);
   if (it == m_materials.end()) {
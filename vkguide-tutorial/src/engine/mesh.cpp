@@ -18,6 +18,7 @@ void VulkanEngine::load_obj_mesh(const std::string &path,
     spdlog::info(
         fmt::format("Successfully loaded mesh {} with path {}", name, path));
     m_meshes[name] = tryMesh.value();
+    m_meshes[name].build_occluder(MAX_OCCLUDER_TRIANGLES);
     upload_mesh(m_meshes[name]);
   }
 }
@@ -36,6 +37,7 @@ void VulkanEngine::load_meshes() {
   m_triangleMesh.vertices[0].color = {1, 0, 0};
   m_triangleMesh.vertices[1].color = {0, 1, 0};
   m_triangleMesh.vertices[2].color = {0, 0, 1};
+  m_triangleMesh.compute_bounds();
 
   load_obj_mesh("thirdparty/vulkan-guide/assets/monkey_smooth.obj", "monkey");
   load_obj_mesh("thirdparty/OpenGL/Binaries/bunny.obj", "bunny");
@@ -47,6 +49,7 @@ void VulkanEngine::load_meshes() {
 }
 
 void VulkanEngine::upload_mesh(Mesh &mesh) {
+  VKR_ZONE("upload_mesh");
   // TODO: just use one staging buffer for vertex and index
   // generalize into staging_copy([sources], dest) -> [offsets]?
   size_t vertexBufferSize = mesh.vertices.size() * sizeof(Vertex);
@@ -71,7 +74,9 @@ void VulkanEngine::upload_mesh(Mesh &mesh) {
           vk::BufferUsageFlagBits::eTransferDst,
       vma::MemoryUsage::eAuto, vma::AllocationCreateFlagBits::eDedicatedMemory);
 
-  immediate_submit([&](vk::CommandBuffer cmd) {
+  // frames wait on the upload's timeline value, this only blocks when every
+  // upload context is still in flight
+  submit_upload([&](vk::CommandBuffer cmd) {
     vk::BufferCopy copy_all(0, 0, combinedBufferSize);
     cmd.copyBuffer(combinedStagingBuffer.buffer,
                    mesh.combinedVertexBuffer.buffer, 1, &copy_all);
@@ -81,8 +86,10 @@ void VulkanEngine::upload_mesh(Mesh &mesh) {
     m_allocator.destroyBuffer(mesh.combinedVertexBuffer.buffer,
                               mesh.combinedVertexBuffer.allocation);
   });
-  m_allocator.destroyBuffer(combinedStagingBuffer.buffer,
-                            combinedStagingBuffer.allocation);
+  defer_deletion([=]() {
+    m_allocator.destroyBuffer(combinedStagingBuffer.buffer,
+                              combinedStagingBuffer.allocation);
+  });
 
   spdlog::info("Uploaded mesh of size (bytes): v: {}, i: {}, total: {}",
                vertexBufferSize, indexBufferSize,
@@ -91,23 +98,50 @@ void VulkanEngine::upload_mesh(Mesh &mesh) {
 
 void VulkanEngine::immediate_submit(
     std::function<void(vk::CommandBuffer cmd)> &&function) {
-  vk::CommandBuffer cmd = m_uploadContext.commandBuffer;
+  VKR_ZONE("immediate_submit");
+  wait_timeline(submit_upload(std::move(function)));
+}
+
+uint64_t VulkanEngine::submit_upload(
+    std::function<void(vk::CommandBuffer cmd)> &&function) {
+  uint32_t contextIndex = m_uploadContextIndex;
+  m_uploadContextIndex = (m_uploadContextIndex + 1) % UPLOAD_CONTEXT_COUNT;
+  UploadContext &context = m_uploadContexts[contextIndex];
+  uint32_t profilerSlot = UPLOAD_PROFILER_SLOT + contextIndex;
+  // the context's previous upload may still be executing its command buffer
+  wait_timeline(context.timelineValue);
+  while (!m_pendingUploads.empty() &&
+         timeline_reached(m_pendingUploads.front())) {
+    m_pendingUploads.pop_front();
+  }
+  m_device.resetCommandPool(context.commandPool);
+  m_profiler.collect(profilerSlot);
+
+  vk::CommandBuffer cmd = context.commandBuffer;
 
   vk::CommandBufferBeginInfo cmdBeginInfo(
       vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 
   cmd.begin(cmdBeginInfo);
-  function(cmd);
+  {
+    GpuScope uploadScope(m_profiler, cmd, profilerSlot, "upload");
+    function(cmd);
+  }
   cmd.end();
 
+  context.timelineValue = next_timeline_value();
+  m_uploadTimelineValue = context.timelineValue;
+  vk::TimelineSemaphoreSubmitInfo timelineInfo;
+  timelineInfo.setSignalSemaphoreValues(context.timelineValue);
   vk::SubmitInfo submit;
   submit.setCommandBuffers(cmd);
-  m_graphicsQueue.submit(submit, m_uploadContext.uploadFence);
-
-  (void)m_device.waitForFences(m_uploadContext.uploadFence, true, S_TO_NS);
-  m_device.resetFences(m_uploadContext.uploadFence);
+  submit.setSignalSemaphores(m_timeline);
+  submit.setPNext(&timelineInfo);
+  m_profiler.mark_submit(profilerSlot);
+  m_graphicsQueue.submit(submit);
+  m_pendingUploads.push_back(context.timelineValue);
 
-  m_device.resetCommandPool(m_uploadContext.commandPool);
+  return context.timelineValue;
 }
 
 // Materials and meshes
@@ -0,0 +1,530 @@
+#include "common_includes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "engine.hpp"
+#include "pipeline.hpp"
+
+namespace vkr {
+
+void VulkanEngine::init_hiz() {
+  // previous power of two of the window, every mip then halves exactly
+  m_hizExtent = vk::Extent2D(1, 1);
+  while (m_hizExtent.width * 2 <= m_windowExtent.width) {
+    m_hizExtent.width *= 2;
+  }
+  while (m_hizExtent.height * 2 <= m_windowExtent.height) {
+    m_hizExtent.height *= 2;
+  }
+  m_hizMipCount = 1;
+  while ((std::max(m_hizExtent.width, m_hizExtent.height) >> m_hizMipCount) >
+         0) {
+    m_hizMipCount++;
+  }
+
+  vk::ImageCreateInfo imageInfo;
+  imageInfo.setFormat(vk::Format::eR32Sfloat)
+      .setImageType(vk::ImageType::e2D)
+      .setExtent(vk::Extent3D(m_hizExtent.width, m_hizExtent.height, 1))
+      .setUsage(vk::ImageUsageFlagBits::eStorage |
+                vk::ImageUsageFlagBits::eSampled |
+                vk::ImageUsageFlagBits::eTransferDst)
+      .setMipLevels(m_hizMipCount)
+      .setArrayLayers(1)
+      .setSamples(vk::SampleCountFlagBits::e1)
+      .setTiling(vk::ImageTiling::eOptimal);
+  vma::AllocationCreateInfo imageAllocInfo;
+  imageAllocInfo.setUsage(vma::MemoryUsage::eGpuOnly)
+      .setRequiredFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
+  auto allocatedImage = m_allocator.createImage(imageInfo, imageAllocInfo);
+  m_hizImage.image = allocatedImage.first;
+  m_hizImage.allocation = allocatedImage.second;
+
+  vk::ImageViewCreateInfo viewInfo;
+  viewInfo.setFormat(vk::Format::eR32Sfloat)
+      .setViewType(vk::ImageViewType::e2D)
+      .setImage(m_hizImage.image)
+      .setSubresourceRange(vk::ImageSubresourceRange(
+          vk::ImageAspectFlagBits::eColor, 0, m_hizMipCount, 0, 1));
+  m_hizImageView = m_device.createImageView(viewInfo);
+  for (uint32_t i = 0; i < m_hizMipCount; i++) {
+    viewInfo.setSubresourceRange(
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, i, 1, 0, 1));
+    m_hizMipViews.push_back(m_device.createImageView(viewInfo));
+  }
+
+  vk::SamplerCreateInfo samplerInfo;
+  samplerInfo.setMagFilter(vk::Filter::eNearest)
+      .setMinFilter(vk::Filter::eNearest)
+      .setMipmapMode(vk::SamplerMipmapMode::eNearest)
+      .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+      .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+      .setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
+      .setMaxLod(VK_LOD_CLAMP_NONE);
+  m_hizSampler = m_device.createSampler(samplerInfo);
+
+  m_mainDeletionQueue.push_function([=]() {
+    m_device.destroySampler(m_hizSampler);
+    for (auto view : m_hizMipViews) {
+      m_device.destroyImageView(view);
+    }
+    m_device.destroyImageView(m_hizImageView);
+    m_allocator.destroyImage(m_hizImage.image, m_hizImage.allocation);
+  });
+
+  // the pyramid lives in general layout, start it at the far plane so the
+  // first culled frame keeps everything
+  immediate_submit([&](vk::CommandBuffer cmd) {
+    vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0,
+                                    m_hizMipCount, 0, 1);
+    vk::ImageMemoryBarrier toGeneral;
+    toGeneral.setOldLayout(vk::ImageLayout::eUndefined)
+        .setNewLayout(vk::ImageLayout::eGeneral)
+        .setImage(m_hizImage.image)
+        .setSubresourceRange(range)
+        .setSrcAccessMask({})
+        .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                        vk::PipelineStageFlagBits::eTransfer, {}, nullptr,
+                        nullptr, toGeneral);
+
+    vk::ClearColorValue far;
+    far.setFloat32({1., 1., 1., 1.});
+    cmd.clearColorImage(m_hizImage.image, vk::ImageLayout::eGeneral, far,
+                        range);
+
+    vk::MemoryBarrier toCompute;
+    toCompute.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                        vk::PipelineStageFlagBits::eComputeShader, {},
+                        toCompute, nullptr, nullptr);
+  });
+
+  // descriptors, one reduce set per mip and one cull set per frame
+  std::vector<vk::DescriptorPoolSize> sizes = {
+      {vk::DescriptorType::eCombinedImageSampler,
+       m_hizMipCount + FRAME_OVERLAP},
+      {vk::DescriptorType::eStorageImage, m_hizMipCount},
+      {vk::DescriptorType::eStorageBuffer, 4 * FRAME_OVERLAP}};
+  vk::DescriptorPoolCreateInfo poolInfo;
+  poolInfo.setMaxSets(m_hizMipCount + FRAME_OVERLAP);
+  poolInfo.setPoolSizes(sizes);
+  m_hizDescriptorPool = m_device.createDescriptorPool(poolInfo);
+
+  // source and destination mip
+  const ShaderReflection &reduceReflection =
+      m_shaderReflections.at("hiz_reduce.comp");
+  m_hizReduceSetLayout = m_layoutCache.set_layout(reduceReflection.sets.at(0));
+  // pyramid, cull data, indirect commands, visibility, stats
+  const ShaderReflection &cullReflection =
+      m_shaderReflections.at("hiz_cull.comp");
+  m_hizCullSetLayout = m_layoutCache.set_layout(cullReflection.sets.at(0));
+
+  m_mainDeletionQueue.push_function(
+      [=]() { m_device.destroyDescriptorPool(m_hizDescriptorPool); });
+
+  std::vector<vk::DescriptorSetLayout> reduceLayouts(m_hizMipCount,
+                                                     m_hizReduceSetLayout);
+  vk::DescriptorSetAllocateInfo reduceAlloc;
+  reduceAlloc.setDescriptorPool(m_hizDescriptorPool);
+  reduceAlloc.setSetLayouts(reduceLayouts);
+  m_hizReduceSets = m_device.allocateDescriptorSets(reduceAlloc);
+  for (uint32_t i = 0; i < m_hizMipCount; i++) {
+    // mip 0 is reduced straight from the depth attachment
+    vk::DescriptorImageInfo srcInfo;
+    srcInfo.setSampler(m_hizSampler);
+    if (i == 0) {
+      srcInfo.setImageView(m_depthImageView);
+      srcInfo.setImageLayout(vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+    } else {
+      srcInfo.setImageView(m_hizMipViews[i - 1]);
+      srcInfo.setImageLayout(vk::ImageLayout::eGeneral);
+    }
+    vk::DescriptorImageInfo dstInfo;
+    dstInfo.setImageView(m_hizMipViews[i]);
+    dstInfo.setImageLayout(vk::ImageLayout::eGeneral);
+
+    vk::WriteDescriptorSet srcWrite(m_hizReduceSets[i], 0, 0, 1,
+                                    vk::DescriptorType::eCombinedImageSampler,
+                                    &srcInfo, nullptr, nullptr);
+    vk::WriteDescriptorSet dstWrite(m_hizReduceSets[i], 1, 0, 1,
+                                    vk::DescriptorType::eStorageImage,
+                                    &dstInfo, nullptr, nullptr);
+    vk::WriteDescriptorSet writes[] = {srcWrite, dstWrite};
+    m_device.updateDescriptorSets(std::size(writes), writes, 0, nullptr);
+  }
+
+  for (FrameData &frame : m_frames) {
+    frame.cullDataBuffer = create_buffer(
+        sizeof(GPUCullData) * MAX_OBJECTS,
+        vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eAuto,
+        vma::AllocationCreateFlagBits::eHostAccessSequentialWrite);
+    // first half for the first phase, second half for the second
+    frame.indirectBuffer = create_buffer(
+        sizeof(vk::DrawIndexedIndirectCommand) * MAX_OBJECTS * 2,
+        vk::BufferUsageFlagBits::eIndirectBuffer |
+            vk::BufferUsageFlagBits::eStorageBuffer,
+        vma::MemoryUsage::eAuto,
+        vma::AllocationCreateFlagBits::eHostAccessSequentialWrite);
+    frame.visibilityBuffer = create_buffer(
+        sizeof(uint32_t) * MAX_OBJECTS,
+        vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eAuto, {});
+    // read back every frame
+    frame.cullStatsBuffer = create_buffer(
+        sizeof(GPUCullStats), vk::BufferUsageFlagBits::eStorageBuffer,
+        vma::MemoryUsage::eAuto,
+        vma::AllocationCreateFlagBits::eHostAccessRandom);
+    void *stats = m_allocator.mapMemory(frame.cullStatsBuffer.allocation);
+    memset(stats, 0, sizeof(GPUCullStats));
+    m_allocator.unmapMemory(frame.cullStatsBuffer.allocation);
+
+    vk::DescriptorSetAllocateInfo cullAlloc;
+    cullAlloc.setDescriptorPool(m_hizDescriptorPool);
+    cullAlloc.setSetLayouts(m_hizCullSetLayout);
+    frame.cullDescriptorSet = m_device.allocateDescriptorSets(cullAlloc)[0];
+
+    vk::DescriptorImageInfo pyramidInfo(m_hizSampler, m_hizImageView,
+                                        vk::ImageLayout::eGeneral);
+    vk::DescriptorBufferInfo bufferInfos[] = {
+        {frame.cullDataBuffer.buffer, 0, VK_WHOLE_SIZE},
+        {frame.indirectBuffer.buffer, 0, VK_WHOLE_SIZE},
+        {frame.visibilityBuffer.buffer, 0, VK_WHOLE_SIZE},
+        {frame.cullStatsBuffer.buffer, 0, VK_WHOLE_SIZE}};
+    std::vector<vk::WriteDescriptorSet> writes = {vk::WriteDescriptorSet(
+        frame.cullDescriptorSet, 0, 0, 1,
+        vk::DescriptorType::eCombinedImageSampler, &pyramidInfo, nullptr,
+        nullptr)};
+    for (uint32_t i = 0; i < std::size(bufferInfos); i++) {
+      writes.push_back(vk::WriteDescriptorSet(
+          frame.cullDescriptorSet, i + 1, 0, 1,
+          vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[i],
+          nullptr));
+    }
+    m_device.updateDescriptorSets(writes, nullptr);
+
+    m_mainDeletionQueue.push_function([&]() {
+      m_allocator.destroyBuffer(frame.cullDataBuffer.buffer,
+                                frame.cullDataBuffer.allocation);
+      m_allocator.destroyBuffer(frame.indirectBuffer.buffer,
+                                frame.indirectBuffer.allocation);
+      m_allocator.destroyBuffer(frame.visibilityBuffer.buffer,
+                                frame.visibilityBuffer.allocation);
+      m_allocator.destroyBuffer(frame.cullStatsBuffer.buffer,
+                                frame.cullStatsBuffer.allocation);
+    });
+  }
+
+  // compute pipelines
+  m_hizReduceLayout = m_layoutCache.pipeline_layout(reduceReflection);
+  m_hizCullLayout = m_layoutCache.pipeline_layout(cullReflection);
+
+  vk::ComputePipelineCreateInfo reducePipelineInfo;
+  reducePipelineInfo.setStage(
+      PipelineBuilder::default_pipeline_shader_stage_create_info(
+          vk::ShaderStageFlagBits::eCompute,
+          m_shaderModules["hiz_reduce.comp"]));
+  reducePipelineInfo.setLayout(m_hizReduceLayout);
+  m_hizReducePipeline =
+      m_device
+          .createComputePipeline(m_pipelineCache.handle(), reducePipelineInfo)
+          .value;
+
+  vk::ComputePipelineCreateInfo cullPipelineInfo;
+  cullPipelineInfo.setStage(
+      PipelineBuilder::default_pipeline_shader_stage_create_info(
+          vk::ShaderStageFlagBits::eCompute, m_shaderModules["hiz_cull.comp"]));
+  cullPipelineInfo.setLayout(m_hizCullLayout);
+  m_hizCullPipeline =
+      m_device.createComputePipeline(m_pipelineCache.handle(), cullPipelineInfo)
+          .value;
+
+  m_hizFirstRenderPass = create_hiz_renderpass(false);
+  m_hizSecondRenderPass = create_hiz_renderpass(true);
+
+  m_mainDeletionQueue.push_function([=]() {
+    m_device.destroyRenderPass(m_hizSecondRenderPass);
+    m_device.destroyRenderPass(m_hizFirstRenderPass);
+    m_device.destroyPipeline(m_hizCullPipeline);
+    m_device.destroyPipeline(m_hizReducePipeline);
+  });
+  spdlog::info("Initialized {}x{} hi-z pyramid with {} mips",
+               m_hizExtent.width, m_hizExtent.height, m_hizMipCount);
+}
+
+vk::RenderPass VulkanEngine::create_hiz_renderpass(bool secondPhase) {
+  // same attachments as m_renderPass, the first phase leaves both attachments
+  // for the second to load, depth is sampled by the pyramid build in between
+  vk::AttachmentDescription colorAttachment;
+  colorAttachment.format = m_renderTargetFormat;
+  colorAttachment.samples = vk::SampleCountFlagBits::e1;
+  colorAttachment.loadOp =
+      secondPhase ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear;
+  colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+  colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+  colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+  colorAttachment.initialLayout = secondPhase
+                                      ? vk::ImageLayout::eColorAttachmentOptimal
+                                      : vk::ImageLayout::eUndefined;
+  colorAttachment.finalLayout = secondPhase
+                                    ? vk::ImageLayout::eShaderReadOnlyOptimal
+                                    : vk::ImageLayout::eColorAttachmentOptimal;
+  vk::AttachmentReference colorAttachmentRef(
+      {}, vk::ImageLayout::eColorAttachmentOptimal);
+
+  vk::AttachmentDescription depthAttachment;
+  depthAttachment.setFormat(m_depthFormat)
+      .setSamples(vk::SampleCountFlagBits::e1)
+      .setLoadOp(secondPhase ? vk::AttachmentLoadOp::eLoad
+                             : vk::AttachmentLoadOp::eClear)
+      .setStoreOp(vk::AttachmentStoreOp::eStore)
+      .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+      .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+      .setInitialLayout(secondPhase
+                            ? vk::ImageLayout::eDepthStencilReadOnlyOptimal
+                            : vk::ImageLayout::eUndefined)
+      .setFinalLayout(vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+  vk::AttachmentReference depthAttachmentRef;
+  depthAttachmentRef.setAttachment(1);
+  depthAttachmentRef.setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+  vk::SubpassDescription subpass;
+  subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+      .setColorAttachments(colorAttachmentRef)
+      .setPDepthStencilAttachment(&depthAttachmentRef);
+
+  // includes the previous frame's upscale reading the render target
+  vk::SubpassDependency colorDep;
+  colorDep.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+      .setDstSubpass(0)
+      .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                       vk::PipelineStageFlagBits::eFragmentShader)
+      .setSrcAccessMask({})
+      .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
+
+  // the second phase also waits on the pyramid build reading depth
+  vk::SubpassDependency depthDep;
+  depthDep.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+      .setDstSubpass(0)
+      .setSrcStageMask(vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                       vk::PipelineStageFlagBits::eLateFragmentTests |
+                       vk::PipelineStageFlagBits::eComputeShader)
+      .setSrcAccessMask({})
+      .setDstStageMask(vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                       vk::PipelineStageFlagBits::eLateFragmentTests)
+      .setDstAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                        vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+  // depth writes visible to the pyramid build
+  vk::SubpassDependency outDep;
+  outDep.setSrcSubpass(0)
+      .setDstSubpass(VK_SUBPASS_EXTERNAL)
+      .setSrcStageMask(vk::PipelineStageFlagBits::eLateFragmentTests |
+                       vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                        vk::AccessFlagBits::eColorAttachmentWrite)
+      .setDstStageMask(vk::PipelineStageFlagBits::eComputeShader |
+                       vk::PipelineStageFlagBits::eColorAttachmentOutput)
+      .setDstAccessMask(vk::AccessFlagBits::eShaderRead |
+                        vk::AccessFlagBits::eColorAttachmentWrite);
+
+  auto dependencies = {colorDep, depthDep, outDep};
+
+  vk::RenderPassCreateInfo renderPassInfo;
+  auto attachments = {colorAttachment, depthAttachment};
+  renderPassInfo.setAttachments(attachments)
+      .setSubpasses(subpass)
+      .setDependencies(dependencies);
+  return m_device.createRenderPass(renderPassInfo);
+}
+
+void VulkanEngine::record_hiz_build(vk::CommandBuffer cmd) {
+  GpuScope scope(m_profiler, cmd, m_frameNumber % FRAME_OVERLAP, "hi-z build");
+  // the cull pass may still be reading the pyramid
+  vk::MemoryBarrier readBarrier;
+  readBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+      .setDstAccessMask(vk::AccessFlagBits::eShaderWrite);
+  cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                      vk::PipelineStageFlagBits::eComputeShader, {},
+                      readBarrier, nullptr, nullptr);
+
+  cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_hizReducePipeline);
+  for (uint32_t i = 0; i < m_hizMipCount; i++) {
+    GPUHizReduceConstants constants;
+    if (i == 0) {
+      // only the rendered region of the depth attachment
+      constants.srcSize =
+          glm::ivec2(m_renderExtent.width, m_renderExtent.height);
+    } else {
+      constants.srcSize =
+          glm::ivec2(std::max(m_hizExtent.width >> (i - 1), 1u),
+                     std::max(m_hizExtent.height >> (i - 1), 1u));
+    }
+    constants.dstSize = glm::ivec2(std::max(m_hizExtent.width >> i, 1u),
+                                   std::max(m_hizExtent.height >> i, 1u));
+
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_hizReduceLayout,
+                           0, m_hizReduceSets[i], nullptr);
+    cmd.pushConstants(m_hizReduceLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                      sizeof(GPUHizReduceConstants), &constants);
+    cmd.dispatch((constants.dstSize.x + 7) / 8, (constants.dstSize.y + 7) / 8,
+                 1);
+
+    // next mip reads this one
+    vk::MemoryBarrier mipBarrier;
+    mipBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                        vk::PipelineStageFlagBits::eComputeShader, {},
+                        mipBarrier, nullptr, nullptr);
+  }
+}
+
+void VulkanEngine::record_hiz_cull(vk::CommandBuffer cmd, uint32_t phase) {
+  GpuScope scope(m_profiler, cmd, m_frameNumber % FRAME_OVERLAP, "hi-z cull");
+  // pyramid (possibly built by the previous frame) and first phase visibility
+  vk::MemoryBarrier inputBarrier;
+  inputBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+      .setDstAccessMask(vk::AccessFlagBits::eShaderRead |
+                        vk::AccessFlagBits::eShaderWrite);
+  cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                      vk::PipelineStageFlagBits::eComputeShader, {},
+                      inputBarrier, nullptr, nullptr);
+
+  GPUHizCullConstants constants;
+  constants.viewproj = get_projection_matrix() * m_framePacket->viewMatrix;
+  constants.pyramidSize =
+      glm::vec4(m_hizExtent.width, m_hizExtent.height, m_hizMipCount, 0);
+  constants.params = glm::uvec4(m_drawList.size(), phase, MAX_OBJECTS, 0);
+
+  cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_hizCullPipeline);
+  cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_hizCullLayout, 0,
+                         get_current_frame().cullDescriptorSet, nullptr);
+  cmd.pushConstants(m_hizCullLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                    sizeof(GPUHizCullConstants), &constants);
+  cmd.dispatch((m_drawList.size() + 63) / 64, 1, 1);
+
+  vk::MemoryBarrier commandBarrier;
+  commandBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+      .setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead |
+                        vk::AccessFlagBits::eHostRead);
+  cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                      vk::PipelineStageFlagBits::eDrawIndirect |
+                          vk::PipelineStageFlagBits::eHost,
+                      {}, commandBarrier, nullptr, nullptr);
+}
+
+void VulkanEngine::draw_hiz_culled(vk::CommandBuffer cmd,
+                                   vk::Framebuffer framebuffer) {
+  uint32_t frameIndex = m_frameNumber % FRAME_OVERLAP;
+  vk::ClearValue clearValue;
+  clearValue.color.setFloat32({0., 0., 0., 1.});
+  vk::ClearValue depthClear;
+  depthClear.depthStencil.setDepth(1.f);
+  auto clearValues = {clearValue, depthClear};
+
+  vk::RenderPassBeginInfo rpInfo;
+  rpInfo.renderArea.setOffset({0, 0});
+  rpInfo.renderArea.extent = m_renderExtent;
+  rpInfo.framebuffer = framebuffer;
+  rpInfo.setClearValues(clearValues);
+
+  // first phase: what was visible against last frame's pyramid
+  {
+    GpuScope scope(m_profiler, cmd, frameIndex, "scene (first phase)");
+    record_hiz_cull(cmd, 0);
+    rpInfo.renderPass = m_hizFirstRenderPass;
+    cmd.beginRenderPass(rpInfo, vk::SubpassContents::eInline);
+    record_draws(cmd, frameIndex, m_drawList, 0, m_drawStats);
+    cmd.endRenderPass();
+  }
+
+  // second phase: retest the rest against what the first phase drew
+  {
+    GpuScope scope(m_profiler, cmd, frameIndex, "scene (second phase)");
+    record_hiz_build(cmd);
+    record_hiz_cull(cmd, 1);
+    rpInfo.renderPass = m_hizSecondRenderPass;
+    cmd.beginRenderPass(rpInfo, vk::SubpassContents::eInline);
+    record_draws(cmd, frameIndex, m_drawList, MAX_OBJECTS, m_drawStats);
+    cmd.endRenderPass();
+  }
+
+  // full frame pyramid for the next frame's first phase
+  record_hiz_build(cmd);
+
+  m_frames[frameIndex].cullStatsWritten = true;
+}
+
+void VulkanEngine::read_cull_stats(FrameData &frame) {
+  if (!frame.cullStatsWritten) {
+    return;
+  }
+  frame.cullStatsWritten = false;
+
+  GPUCullStats *stats =
+      (GPUCullStats *)m_allocator.mapMemory(frame.cullStatsBuffer.allocation);
+  // host visible isn't necessarily coherent
+  m_allocator.invalidateAllocation(frame.cullStatsBuffer.allocation, 0,
+                                   VK_WHOLE_SIZE);
+  m_cullStats.culledFirstPhase += stats->culledFirstPhase;
+  m_cullStats.recoveredSecondPhase += stats->recoveredSecondPhase;
+  m_cullStats.culledTotal += stats->culledTotal;
+  m_cullStats.drawCount += stats->drawCount;
+  m_lastCullStats = *stats;
+  m_cullStatsFrames++;
+  // counters are only ever added to on the gpu
+  memset(stats, 0, sizeof(GPUCullStats));
+  m_allocator.flushAllocation(frame.cullStatsBuffer.allocation, 0,
+                              VK_WHOLE_SIZE);
+  m_allocator.unmapMemory(frame.cullStatsBuffer.allocation);
+}
+
+void VulkanEngine::cull_software_occlusion(FramePacket &packet) {
+  CpuScope scope(m_profiler, "cpu occlusion culling");
+  auto start = std::chrono::high_resolution_clock::now();
+  glm::mat4 viewProj = get_projection_matrix() * packet.viewMatrix;
+  const std::vector<RenderObject> &renderables = packet.renderables;
+
+  // large renderables with an occluder lod are both occluders and always drawn
+  m_maskedOcclusion.clear();
+  std::vector<bool> isOccluder(renderables.size(), false);
+  for (size_t i = 0; i < renderables.size(); i++) {
+    const RenderObject &object = renderables[i];
+    if (object.mesh->occluderIndices.empty() ||
+        object.world_bounds().w < MIN_OCCLUDER_RADIUS) {
+      continue;
+    }
+    isOccluder[i] = true;
+    m_maskedOcclusion.add_occluder(viewProj * object.transformMatrix,
+                                   object.mesh->occluderVertices.data(),
+                                   object.mesh->occluderVertices.size(),
+                                   object.mesh->occluderIndices.data(),
+                                   object.mesh->occluderIndices.size());
+  }
+  m_maskedOcclusion.rasterize(&m_threadPool);
+  auto rasterized = std::chrono::high_resolution_clock::now();
+
+  packet.visible.clear();
+  packet.softwareCulled = 0;
+  for (size_t i = 0; i < renderables.size(); i++) {
+    const RenderObject &object = renderables[i];
+    if (!isOccluder[i] &&
+        !m_maskedOcclusion.test_sphere(viewProj, object.world_bounds())) {
+      packet.softwareCulled++;
+      continue;
+    }
+    packet.visible.push_back(object);
+  }
+  auto tested = std::chrono::high_resolution_clock::now();
+
+  packet.softwareRasterMs =
+      std::chrono::duration<double, std::milli>(rasterized - start).count();
+  packet.softwareTestMs =
+      std::chrono::duration<double, std::milli>(tested - rasterized).count();
+}
+
+} // namespace vkr
@@ -0,0 +1,123 @@
+#include "common_includes.h"
+
+#include <map>
+#include <stdexcept>
+
+#include "engine.hpp"
+
+namespace vkr {
+
+void VulkanEngine::init_replay() {
+  if (!replaying()) {
+    if (!m_replay.recordPath.empty()) {
+      spdlog::info("Recording the camera path to {}", m_replay.recordPath);
+    }
+    return;
+  }
+  if (!m_cameraPath.load(m_replay.playPath)) {
+    throw std::runtime_error("Could not load camera path " +
+                             m_replay.playPath);
+  }
+  m_replay.runs = std::max<uint32_t>(m_replay.runs, 1);
+  // one more frame to see the first packet past the last run
+  if (m_headless.enabled) {
+    m_headless.frames = m_replay.runs * m_cameraPath.length() + 1;
+  }
+  m_framePacer.reset_stats();
+  m_profiler.reset_gpu_scope_times();
+  spdlog::info("Replaying {} steps of {} {} times", m_cameraPath.length(),
+               m_replay.playPath, m_replay.runs);
+}
+
+void VulkanEngine::begin_replay_frame(const FramePacket &packet) {
+  if (!replaying() || m_replayDone || packet.replayRun == m_replayRun) {
+    return;
+  }
+  finish_replay_run();
+  m_replayRun = packet.replayRun;
+  m_replayDone = m_replayRun >= m_replay.runs;
+}
+
+void VulkanEngine::end_replay_frame() {
+  if (!replaying() || m_replayDone) {
+    return;
+  }
+  m_replayFrames++;
+  m_replayDrawCalls += m_drawStats.drawCalls;
+  m_replayTriangles += m_drawStats.triangles;
+}
+
+void VulkanEngine::finish_replay_run() {
+  if (m_replayFrames == 0) {
+    return;
+  }
+  ReplayMetrics metrics;
+  FramePercentiles frameTimes = m_framePacer.frame_time_percentiles();
+  metrics.push_back({"frame_ms_p50", frameTimes.p50});
+  metrics.push_back({"frame_ms_p95", frameTimes.p95});
+  metrics.push_back({"frame_ms_p99", frameTimes.p99});
+  metrics.push_back({"frame_ms_max", frameTimes.max});
+  metrics.push_back({"draw_calls", double(m_replayDrawCalls) / m_replayFrames});
+  metrics.push_back({"triangles", double(m_replayTriangles) / m_replayFrames});
+
+  // scopes are read back FRAME_OVERLAP frames late, so the last frames of a
+  // run count towards the next one. that's a handful of frames out of a path
+  std::map<std::string, GpuProfiler::ScopeTime> scopes;
+  for (const GpuProfiler::ScopeTime &time : m_profiler.gpu_scope_times()) {
+    GpuProfiler::ScopeTime &merged = scopes[time.name];
+    merged.totalMs += time.totalMs;
+    merged.count += time.count;
+  }
+  for (const auto &[name, time] : scopes) {
+    metrics.push_back({"gpu_ms/" + name, time.totalMs / time.count});
+  }
+
+  spdlog::info("Replay run {}: {} frames, frame time p50 {:.2f}ms p99 "
+               "{:.2f}ms, {:.0f} draws per frame",
+               m_replayRun, m_replayFrames, frameTimes.p50, frameTimes.p99,
+               double(m_replayDrawCalls) / m_replayFrames);
+  m_replayRuns.push_back(std::move(metrics));
+
+  m_replayFrames = 0;
+  m_replayDrawCalls = 0;
+  m_replayTriangles = 0;
+  m_framePacer.reset_stats();
+  m_profiler.reset_gpu_scope_times();
+}
+
+void VulkanEngine::finish_replay() {
+  if (!replaying()) {
+    return;
+  }
+  // a window closed mid run still reports the runs that finished
+  if (!write_replay_report(m_replay.reportPath, m_replayRuns)) {
+    spdlog::warn("Could not write {}", m_replay.reportPath);
+    return;
+  }
+  spdlog::info("Wrote {} replay runs to {}", m_replayRuns.size(),
+               m_replay.reportPath);
+  if (m_replay.baselinePath.empty()) {
+    return;
+  }
+
+  std::optional<ReplayMetrics> baseline =
+      read_replay_report(m_replay.baselinePath);
+  if (!baseline) {
+    spdlog::warn("Could not read baseline {}", m_replay.baselinePath);
+    return;
+  }
+  std::vector<ReplayRegression> regressions = compare_replay_metrics(
+      *baseline, median_metrics(m_replayRuns), m_replay.tolerance);
+  for (const ReplayRegression &regression : regressions) {
+    spdlog::error("Regression in {}: {:.3f} -> {:.3f} ({:+.1f}%)",
+                  regression.name, regression.baseline, regression.current,
+                  regression.change * 100.);
+  }
+  m_replayRegressed = !regressions.empty();
+  if (!m_replayRegressed) {
+    spdlog::info("No regressions against {} beyond {:.1f}%",
+                 m_replay.baselinePath, m_replay.tolerance * 100.);
+  }
+}
+
+} // namespace vkr
@@ -14,6 +14,13 @@ void VulkanEngine::init_scene() {
   glm::vec3 cameraPosition = {0., -2., -2.};
   m_viewMatrix = glm::translate(glm::mat4(1.), cameraPosition);
 
+  // no fog and a sun with zero power, so lit materials get vertex color plus
+  // the animated ambient like the flat shader they replaced
+  m_sceneParameters.fogColor = {0, 0, 0, 1};
+  m_sceneParameters.fogDistances = {0, 0, 0, 0};
+  m_sceneParameters.sunlightDirection = {0, -1, 0, 0};
+  m_sceneParameters.sunlightColor = {1, 1, 1, 1};
+
   RenderObject monkey;
   monkey.mesh = get_mesh("monkey");
   monkey.material = get_material("defaultmesh");
@@ -48,22 +55,32 @@ void VulkanEngine::init_scene() {
                                  glm::vec3(0., -1., 0.));
     empire.transformMatrix = translate * roty * rotx;
 
-    // allocate descriptor set for single texture for material
-    vk::DescriptorSetAllocateInfo allocInfo(m_descriptorPool, 1,
-                                            &m_singleTextureSetLayout);
-    empire.material->textureSet = m_device.allocateDescriptorSets(allocInfo)[0];
-
-    // point descriptor set to texture
-    vk::DescriptorImageInfo imageBufferInfo(
-        blockySampler, m_loadedTextures["empire_diffuse"].imageView,
-        vk::ImageLayout::eShaderReadOnlyOptimal);
-    vk::WriteDescriptorSet writeTex1;
-    writeTex1.setImageInfo(imageBufferInfo);
-    writeTex1.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
-    writeTex1.setDstSet(empire.material->textureSet.value());
-    writeTex1.setDstBinding(0);
-    writeTex1.setDescriptorCount(1);
-    m_device.updateDescriptorSets(writeTex1, nullptr);
+    if (m_config.bindless) {
+      // material just points at its slot in the texture array
+      GPUMaterialData materialData =
+          m_materialData[empire.material->materialIndex];
+      materialData.textureIndices.x = register_bindless_texture(
+          m_loadedTextures["empire_diffuse"].imageView, blockySampler);
+      update_material_data(*empire.material, materialData);
+    } else {
+      // allocate descriptor set for single texture for material
+      vk::DescriptorSetAllocateInfo allocInfo(m_descriptorPool, 1,
+                                              &m_singleTextureSetLayout);
+      empire.material->textureSet =
+          m_device.allocateDescriptorSets(allocInfo)[0];
+
+      // point descriptor set to texture
+      vk::DescriptorImageInfo imageBufferInfo(
+          blockySampler, m_loadedTextures["empire_diffuse"].imageView,
+          vk::ImageLayout::eShaderReadOnlyOptimal);
+      vk::WriteDescriptorSet writeTex1;
+      writeTex1.setImageInfo(imageBufferInfo);
+      writeTex1.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+      writeTex1.setDstSet(empire.material->textureSet.value());
+      writeTex1.setDstBinding(0);
+      writeTex1.setDescriptorCount(1);
+      m_device.updateDescriptorSets(writeTex1, nullptr);
+    }
 
     m_renderables.push_back(empire);
   }
@@ -81,6 +98,8 @@ void VulkanEngine::init_scene() {
       m_renderables.push_back(tri);
     }
   }
+
+  invalidate_static_commands();
 }
 
 } // namespace vkr
\ No newline at end of file
@@ -1,13 +1,30 @@
 #include "common_includes.h"
 
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 
+#include "embedded_shaders.hpp"
 #include "engine.hpp"
 
 namespace vkr {
 
-std::optional<vk::ShaderModule>
-VulkanEngine::load_shader_module(const char *filePath) {
+vk::ShaderModule VulkanEngine::create_shader_module(const uint32_t *code,
+                                                    size_t wordCount) {
+  vk::ShaderModuleCreateInfo createInfo;
+  createInfo.setCodeSize(wordCount * sizeof(uint32_t));
+  createInfo.setPCode(code);
+
+  auto sm = m_device.createShaderModule(createInfo);
+  // can be deleted right after pipeline is init, but I want to keep them
+  m_mainDeletionQueue.push_function(
+      [=]() { m_device.destroyShaderModule(sm); });
+  return sm;
+}
+
+namespace {
+
+std::optional<std::vector<uint32_t>> read_spirv(const char *filePath) {
   // ate needed for tellg
   std::ifstream file(filePath, std::ios::ate | std::ios::binary);
   if (!file.is_open()) {
@@ -19,37 +36,45 @@ VulkanEngine::load_shader_module(const char *filePath) {
                                sizeof(uint32_t));
   file.seekg(0);
   file.read((char *)buffer.data(), fsize);
-  file.close();
-
-  vk::ShaderModuleCreateInfo createInfo;
-  createInfo.setCode(buffer);
-
-  auto sm = m_device.createShaderModule(createInfo);
-  // can be deleted right after pipeline is init, but I want to keep them
-  m_mainDeletionQueue.push_function(
-      [=]() { m_device.destroyShaderModule(sm); });
-  return sm;
+  return buffer;
 }
 
+} // namespace
+
 void VulkanEngine::init_shader_modules() {
-  m_shaderFiles = {
-      {"basic_flat_mesh.frag", "build/assets/shaders/basic_flat_mesh.frag.spv"},
-      {"basic_normalcolor_mesh.vert",
-       "build/assets/shaders/basic_normalcolor_mesh.vert.spv"},
-      {"basic_vertexcolor_mesh.vert",
-       "build/assets/shaders/basic_vertexcolor_mesh.vert.spv"},
-      {"textured_lit.frag", "build/assets/shaders/textured_lit.frag.spv"}};
-
-  for (auto shader : m_shaderFiles) {
-    auto mod = load_shader_module(shader.second.c_str());
-    if (!mod.has_value()) {
-      spdlog::error("Failed to load {} shader", shader.first);
-      throw std::runtime_error("Cannot continue");
-    } else {
-      spdlog::info("Loaded {} shader successfully", shader.first);
-      m_shaderModules[shader.first] = mod.value();
+  // every shader is linked into the binary. for shader work, VKR_SHADER_DIR
+  // points at a directory of .spv files, e.g. build/assets/shaders, that
+  // replace the embedded ones they have a file for
+  const char *overrideDir = std::getenv("VKR_SHADER_DIR");
+  if (overrideDir) {
+    spdlog::info("Loading shaders from {} over the embedded ones",
+                 overrideDir);
+  }
+
+  for (size_t i = 0; i < EMBEDDED_SHADER_COUNT; i++) {
+    const EmbeddedShader &shader = EMBEDDED_SHADERS[i];
+    const uint32_t *code = shader.code;
+    size_t wordCount = shader.wordCount;
+    std::optional<std::vector<uint32_t>> overrideCode;
+    if (overrideDir) {
+      std::filesystem::path path = std::filesystem::path(overrideDir) /
+                                   (std::string(shader.name) + ".spv");
+      if (std::filesystem::exists(path)) {
+        overrideCode = read_spirv(path.c_str());
+        if (!overrideCode.has_value()) {
+          spdlog::error("Failed to load {} shader", shader.name);
+          throw std::runtime_error("Cannot continue");
+        }
+        spdlog::info("Loaded {} shader from {}", shader.name, path.string());
+        code = overrideCode->data();
+        wordCount = overrideCode->size();
+      }
     }
+    m_shaderModules[shader.name] = create_shader_module(code, wordCount);
+    // layouts are built from this, so a shader edit can't drift from them
+    m_shaderReflections[shader.name] = reflect_spirv(code, wordCount);
   }
+  spdlog::info("Created {} shader modules", m_shaderModules.size());
 }
 
-} // namespace vkr
\ No newline at end of file
+} // namespace vkr
@@ -0,0 +1,131 @@
+#include "common_includes.h"
+
+#include <chrono>
+#include <cmath>
+
+#include "engine.hpp"
+
+namespace vkr {
+
+void VulkanEngine::start_simulation() {
+  // the first step needs input before the first frame samples any
+  m_inputSampleTime = FramePacer::Clock::now();
+  publish_simulation_input();
+  if (m_config.pipelinedSimulation) {
+    m_simulationThread = std::thread([this]() { simulation_loop(); });
+  }
+  spdlog::info("Simulation {}", m_config.pipelinedSimulation
+                                    ? "pipelined on its own thread"
+                                    : "serial with rendering");
+}
+
+void VulkanEngine::stop_simulation() {
+  if (!m_simulationThread.joinable()) {
+    return;
+  }
+  m_simulationStopping.store(true);
+  // wakes the wait in simulation_loop
+  m_packetsConsumed.fetch_add(1, std::memory_order_release);
+  m_packetsConsumed.notify_one();
+  m_simulationThread.join();
+}
+
+void VulkanEngine::simulation_loop() {
+  m_profiler.set_thread_name("simulation");
+  while (true) {
+    // build packet N + 1 only once the render thread has taken packet N
+    uint64_t consumed = m_packetsConsumed.load(std::memory_order_acquire);
+    while (consumed < m_simulationStep && !m_simulationStopping.load()) {
+      m_packetsConsumed.wait(consumed);
+      consumed = m_packetsConsumed.load(std::memory_order_acquire);
+    }
+    if (m_simulationStopping.load()) {
+      return;
+    }
+    produce_frame_packet();
+  }
+}
+
+void VulkanEngine::publish_simulation_input() {
+  SimulationInput &input = m_simulationInputs.write_buffer();
+  input.keyPressed = m_inputs.keyPressed;
+  input.config = m_config;
+  input.inputTime = m_inputSampleTime;
+  m_simulationInputs.publish();
+}
+
+void VulkanEngine::produce_frame_packet() {
+  simulate(m_simulationInputs.read(), m_framePackets.write_buffer());
+  m_framePackets.publish();
+  m_packetsPublished.fetch_add(1, std::memory_order_release);
+  m_packetsPublished.notify_one();
+}
+
+void VulkanEngine::simulate(const SimulationInput &input,
+                            FramePacket &packet) {
+  CpuScope scope(m_profiler, "simulate");
+  auto start = std::chrono::high_resolution_clock::now();
+
+  packet.step = m_simulationStep++;
+  // the scene animates by step within the path, so every run of it renders
+  // the same frames
+  uint64_t animationStep = packet.step;
+  if (replaying()) {
+    packet.replayRun = packet.step / m_cameraPath.length();
+    packet.replayStep = packet.step % m_cameraPath.length();
+    m_viewMatrix = m_cameraPath.view_at(packet.replayStep);
+    animationStep = packet.replayStep;
+  } else {
+    for (SDL_Scancode key : input.keyPressed) {
+      input_handle_keydown(key);
+    }
+    if (!m_replay.recordPath.empty()) {
+      m_cameraPath.record(packet.step, m_viewMatrix);
+    }
+  }
+
+  packet.inputTime = input.inputTime;
+  packet.viewMatrix = m_viewMatrix;
+  float framed = animationStep / 288.;
+  m_sceneParameters.ambientColor = {sin(framed), 0, cos(framed), 1};
+  packet.sceneParameters = m_sceneParameters;
+  // assignment reuses the slot's capacity, so this doesn't allocate once the
+  // three slots have been through a step each
+  packet.renderables = m_renderables;
+
+  packet.softwareOcclusion = input.config.softwareOcclusion;
+  if (packet.softwareOcclusion) {
+    cull_software_occlusion(packet);
+  } else {
+    packet.visible = packet.renderables;
+  }
+
+  packet.simulationMs = std::chrono::duration<double, std::milli>(
+                            std::chrono::high_resolution_clock::now() - start)
+                            .count();
+}
+
+const FramePacket &VulkanEngine::acquire_frame_packet() {
+  uint64_t consumed = m_packetsConsumed.load(std::memory_order_relaxed);
+  uint64_t published = m_packetsPublished.load(std::memory_order_acquire);
+  while (published <= consumed) {
+    m_packetsPublished.wait(published);
+    published = m_packetsPublished.load(std::memory_order_acquire);
+  }
+
+  // the simulation is exactly one packet ahead, so this is the new one
+  const FramePacket &packet = m_framePackets.read();
+  m_packetsConsumed.store(consumed + 1, std::memory_order_release);
+  m_packetsConsumed.notify_one();
+
+  if (packet.softwareOcclusion) {
+    m_softwareCulled += packet.softwareCulled;
+    m_softwareRasterMs += packet.softwareRasterMs;
+    m_softwareTestMs += packet.softwareTestMs;
+    m_softwareFrames++;
+  }
+  m_simulationMs += packet.simulationMs;
+  return packet;
+}
+
+} // namespace vkr
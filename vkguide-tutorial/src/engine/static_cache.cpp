@@ -0,0 +1,121 @@
+#include "common_includes.h"
+
+#include <vector>
+
+#include "draw_sort.hpp"
+#include "engine.hpp"
+
+namespace vkr {
+
+void VulkanEngine::invalidate_static_commands() { m_staticCacheDirty = true; }
+
+bool VulkanEngine::static_commands_outdated() const {
+  if (m_staticCacheDirty) {
+    return false;
+  }
+  // the prepass pipeline compiles in the background like the materials
+  if (depth_prepass_active() != m_staticDepthPrepass) {
+    return true;
+  }
+  for (size_t i = 0; i < m_staticDrawList.size(); i++) {
+    const Material &recorded = m_staticMaterials[i];
+    const Material &current = *m_staticDrawList[i].material;
+    if (current.pipeline != recorded.pipeline ||
+        current.depthEqualPipeline != recorded.depthEqualPipeline ||
+        current.pipelineLayout != recorded.pipelineLayout) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void VulkanEngine::rebuild_static_commands() {
+  CpuScope cpuScope(m_profiler, "rebuild static commands");
+  const std::vector<RenderObject> &renderables = m_framePacket->renderables;
+  // the camera moves after recording, so only sort by material
+  m_staticDrawList.clear();
+  sort_draws(m_staticDrawList, renderables.data(), renderables.size(),
+             m_framePacket->viewMatrix, false);
+  m_staticMaterials.clear();
+  for (const RenderObject &object : m_staticDrawList) {
+    m_staticMaterials.push_back(*object.material);
+  }
+  m_staticDepthPrepass = depth_prepass_active();
+
+  // no wait here, older frames may still be executing their slot's previous
+  // secondary, so each slot re-records once it comes up again
+  m_staticGeneration++;
+  m_staticCacheDirty = false;
+  spdlog::info("Sorted {} static draws, each frame slot re-records them",
+               m_staticDrawList.size());
+}
+
+void VulkanEngine::record_static_commands(uint32_t frameIndex) {
+  CpuScope cpuScope(m_profiler, "record static commands");
+  FrameData &frame = m_frames[frameIndex];
+  write_object_data(frameIndex, m_staticDrawList);
+  // every slot records the same commands
+  m_staticDrawStats = {};
+
+  if (!frame.staticCommandBuffer) {
+    vk::CommandBufferAllocateInfo allocInfo(
+        frame.m_commandPool, vk::CommandBufferLevel::eSecondary, 1);
+    frame.staticCommandBuffer = m_device.allocateCommandBuffers(allocInfo)[0];
+  }
+
+  vk::CommandBufferInheritanceInfo inheritanceInfo;
+  inheritanceInfo.setRenderPass(m_renderPass);
+  inheritanceInfo.setSubpass(0);
+  inheritanceInfo.setFramebuffer(m_sceneFramebuffer);
+  if (m_config.pipelineStatistics && m_capabilities.inheritedQueries) {
+    inheritanceInfo.setPipelineStatistics(
+        vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations);
+  }
+  vk::CommandBufferBeginInfo beginInfo;
+  beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eRenderPassContinue);
+  beginInfo.setPInheritanceInfo(&inheritanceInfo);
+
+  frame.staticCommandBuffer.reset();
+  frame.staticCommandBuffer.begin(beginInfo);
+  record_draws(frame.staticCommandBuffer, frameIndex, m_staticDrawList, -1,
+               m_staticDrawStats);
+  frame.staticCommandBuffer.end();
+  frame.staticGeneration = m_staticGeneration;
+}
+
+void VulkanEngine::draw_static_cached(vk::CommandBuffer cmd) {
+  if (m_staticCacheDirty) {
+    rebuild_static_commands();
+  }
+
+  uint32_t frameIndex = m_frameNumber % FRAME_OVERLAP;
+  FrameData &frame = m_frames[frameIndex];
+  update_camera_scene();
+
+  // draw() waited for the frame that last used this slot
+  if (frame.staticGeneration != m_staticGeneration) {
+    record_static_commands(frameIndex);
+  }
+  // the secondary replays its recorded commands every frame
+  m_drawStats = m_staticDrawStats;
+
+  vk::ClearValue clearValue;
+  clearValue.color.setFloat32({0., 0., 0., 1.});
+  vk::ClearValue depthClear;
+  depthClear.depthStencil.setDepth(1.f);
+
+  vk::RenderPassBeginInfo rpInfo;
+  rpInfo.renderPass = m_renderPass;
+  rpInfo.renderArea.setOffset({0, 0});
+  rpInfo.renderArea.extent = m_renderExtent;
+  rpInfo.framebuffer = m_sceneFramebuffer;
+  auto clearValues = {clearValue, depthClear};
+  rpInfo.setClearValues(clearValues);
+
+  GpuScope scope(m_profiler, cmd, frameIndex, "scene (cached)");
+  cmd.beginRenderPass(rpInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+  cmd.executeCommands(frame.staticCommandBuffer);
+  cmd.endRenderPass();
+}
+
+} // namespace vkr
@@ -110,6 +110,28 @@ VulkanEngine::load_image_from_file(const std::string &path) {
   return newImage;
 }
 
+uint32_t VulkanEngine::register_bindless_texture(vk::ImageView imageView,
+                                                 vk::Sampler sampler) {
+  if (m_bindlessTextureCount >= MAX_BINDLESS_TEXTURES) {
+    throw std::runtime_error("Bindless texture array is full");
+  }
+  uint32_t index = m_bindlessTextureCount++;
+
+  // update after bind, so this is fine even while the set is bound
+  vk::DescriptorImageInfo imageInfo(sampler, imageView,
+                                    vk::ImageLayout::eShaderReadOnlyOptimal);
+  vk::WriteDescriptorSet write;
+  write.setDstSet(m_bindlessDescriptorSet);
+  write.setDstBinding(1);
+  write.setDstArrayElement(index);
+  write.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+  write.setImageInfo(imageInfo);
+  m_device.updateDescriptorSets(write, nullptr);
+
+  spdlog::info("Registered bindless texture at index {}", index);
+  return index;
+}
+
 void VulkanEngine::load_images() {
   Texture lostEmpire;
   lostEmpire.image =
@@ -0,0 +1,50 @@
+#include "common_includes.h"
+
+#include <algorithm>
+
+#include "engine.hpp"
+
+namespace vkr {
+
+uint64_t VulkanEngine::next_timeline_value() { return ++m_timelineValue; }
+
+uint64_t VulkanEngine::completed_timeline_value() {
+  m_timelineCompleted = std::max(m_timelineCompleted,
+                                 m_device.getSemaphoreCounterValue(m_timeline));
+  return m_timelineCompleted;
+}
+
+bool VulkanEngine::timeline_reached(uint64_t value) {
+  return value <= m_timelineCompleted || value <= completed_timeline_value();
+}
+
+void VulkanEngine::wait_timeline(uint64_t value) {
+  if (timeline_reached(value)) {
+    return;
+  }
+  vk::SemaphoreWaitInfo waitInfo;
+  waitInfo.setSemaphores(m_timeline);
+  waitInfo.setValues(value);
+  // no timeout, a value that's never signaled is a bug or a lost device and
+  // both surface as errors from the wait
+  (void)m_device.waitSemaphores(waitInfo, UINT64_MAX);
+  m_timelineCompleted = std::max(m_timelineCompleted, value);
+}
+
+void VulkanEngine::wait_for_frame(uint64_t frameNumber) {
+  if (frameNumber >= m_frameNumber) {
+    spdlog::error("Waiting for frame {} which was never submitted",
+                  frameNumber);
+    return;
+  }
+  const FrameData &frame = m_frames[frameNumber % FRAME_OVERLAP];
+  if (frame.frameNumber == frameNumber) {
+    wait_timeline(frame.timelineValue);
+  }
+}
+
+void VulkanEngine::defer_deletion(std::function<void()> &&function) {
+  m_deferredDeletionQueue.push_function(m_timelineValue, std::move(function));
+}
+
+} // namespace vkr
@@ -0,0 +1,210 @@
+#include "common_includes.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "engine.hpp"
+#include "pipeline.hpp"
+
+namespace vkr {
+
+void VulkanEngine::init_render_target() {
+  // window sized, lower render scales only use the top left corner
+  vk::ImageCreateInfo imageInfo;
+  imageInfo.setFormat(m_renderTargetFormat)
+      .setImageType(vk::ImageType::e2D)
+      .setExtent(vk::Extent3D(m_windowExtent.width, m_windowExtent.height, 1))
+      .setUsage(vk::ImageUsageFlagBits::eColorAttachment |
+                vk::ImageUsageFlagBits::eSampled)
+      .setMipLevels(1)
+      .setArrayLayers(1)
+      .setSamples(vk::SampleCountFlagBits::e1)
+      .setTiling(vk::ImageTiling::eOptimal);
+  vma::AllocationCreateInfo imageAllocInfo;
+  imageAllocInfo.setUsage(vma::MemoryUsage::eGpuOnly)
+      .setRequiredFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
+  auto allocatedImage = m_allocator.createImage(imageInfo, imageAllocInfo);
+  m_renderTarget.image = allocatedImage.first;
+  m_renderTarget.allocation = allocatedImage.second;
+
+  vk::ImageViewCreateInfo viewInfo;
+  viewInfo.setFormat(m_renderTargetFormat)
+      .setViewType(vk::ImageViewType::e2D)
+      .setImage(m_renderTarget.image)
+      .setSubresourceRange(vk::ImageSubresourceRange(
+          vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+  m_renderTargetView = m_device.createImageView(viewInfo);
+
+  vk::FramebufferCreateInfo fbInfo;
+  fbInfo.renderPass = m_renderPass;
+  fbInfo.width = m_windowExtent.width;
+  fbInfo.height = m_windowExtent.height;
+  fbInfo.layers = 1;
+  auto attachments = {m_renderTargetView, m_depthImageView};
+  fbInfo.setAttachments(attachments);
+  m_sceneFramebuffer = m_device.createFramebuffer(fbInfo);
+
+  m_mainDeletionQueue.push_function([=]() {
+    m_device.destroyFramebuffer(m_sceneFramebuffer);
+    m_device.destroyImageView(m_renderTargetView);
+    m_allocator.destroyImage(m_renderTarget.image, m_renderTarget.allocation);
+  });
+
+  m_dynamicResolution.set_budget_ms(m_config.gpuBudgetMs);
+  set_render_scale(1.f);
+  spdlog::info("Initialized {}x{} render target", m_windowExtent.width,
+               m_windowExtent.height);
+}
+
+void VulkanEngine::init_upscale() {
+  vk::SamplerCreateInfo samplerInfo;
+  samplerInfo.setMagFilter(vk::Filter::eLinear)
+      .setMinFilter(vk::Filter::eLinear)
+      .setMipmapMode(vk::SamplerMipmapMode::eNearest)
+      .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+      .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+      .setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+  m_upscaleSampler = m_device.createSampler(samplerInfo);
+
+  vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler,
+                                  1);
+  vk::DescriptorPoolCreateInfo poolInfo;
+  poolInfo.setMaxSets(1);
+  poolInfo.setPoolSizes(poolSize);
+  m_upscaleDescriptorPool = m_device.createDescriptorPool(poolInfo);
+
+  // a new filter only needs its fragment shader here and an UpscaleFilter.
+  // every filter has to bind the same things, merge throws otherwise
+  const char *filterShaders[] = {"upscale_bilinear.frag",
+                                 "upscale_catmull_rom.frag"};
+  static_assert(std::size(filterShaders) == size_t(UpscaleFilter::Count));
+  ShaderReflection reflection = m_shaderReflections.at("fullscreen.vert");
+  for (const char *shader : filterShaders) {
+    reflection.merge(m_shaderReflections.at(shader));
+  }
+  m_upscaleSetLayout = m_layoutCache.set_layout(reflection.sets.at(0));
+  m_upscaleLayout = m_layoutCache.pipeline_layout(reflection);
+
+  vk::DescriptorSetAllocateInfo allocInfo(m_upscaleDescriptorPool, 1,
+                                          &m_upscaleSetLayout);
+  m_upscaleSet = m_device.allocateDescriptorSets(allocInfo)[0];
+  vk::DescriptorImageInfo imageInfo(m_upscaleSampler, m_renderTargetView,
+                                    vk::ImageLayout::eShaderReadOnlyOptimal);
+  vk::WriteDescriptorSet write(m_upscaleSet, 0, 0, 1,
+                               vk::DescriptorType::eCombinedImageSampler,
+                               &imageInfo, nullptr, nullptr);
+  m_device.updateDescriptorSets(write, nullptr);
+
+  // fullscreen triangle from gl_VertexIndex, no vertex input and no depth
+  PipelineBuilder pipelineBuilder;
+  pipelineBuilder.vertexInputInfo =
+      PipelineBuilder::default_vertex_input_state_create_info();
+  pipelineBuilder.inputAssembly =
+      PipelineBuilder::default_pipeline_input_assembly_create_info(
+          vk::PrimitiveTopology::eTriangleList);
+  pipelineBuilder.dynamicStates = {vk::DynamicState::eViewport,
+                                   vk::DynamicState::eScissor};
+  pipelineBuilder.rasterizer =
+      PipelineBuilder::default_rasterization_state_create_info(
+          vk::PolygonMode::eFill);
+  pipelineBuilder.multisampling =
+      PipelineBuilder::default_multisampling_state_create_info();
+  pipelineBuilder.colorBlendAttachment =
+      PipelineBuilder::default_color_blend_attachment_state();
+  pipelineBuilder.depthStencil =
+      PipelineBuilder::default_depth_stencil_create_info(
+          false, false, vk::CompareOp::eAlways);
+  pipelineBuilder.pipelineLayout = m_upscaleLayout;
+
+  for (size_t i = 0; i < m_upscalePipelines.size(); i++) {
+    pipelineBuilder.shaderStages.clear();
+    pipelineBuilder.shaderStages.push_back(
+        PipelineBuilder::default_pipeline_shader_stage_create_info(
+            vk::ShaderStageFlagBits::eVertex,
+            m_shaderModules["fullscreen.vert"]));
+    pipelineBuilder.shaderStages.push_back(
+        PipelineBuilder::default_pipeline_shader_stage_create_info(
+            vk::ShaderStageFlagBits::eFragment,
+            m_shaderModules[filterShaders[i]]));
+    m_upscalePipelines[i] =
+        pipelineBuilder.build(m_pipelineStates, m_upscaleRenderPass);
+  }
+
+  // the pipelines belong to m_pipelineStates, the layouts to m_layoutCache
+  m_mainDeletionQueue.push_function([=]() {
+    m_device.destroyDescriptorPool(m_upscaleDescriptorPool);
+    m_device.destroySampler(m_upscaleSampler);
+  });
+}
+
+void VulkanEngine::update_render_scale(double gpuFrameMs) {
+  if (!m_config.dynamicResolution) {
+    if (m_renderExtent != m_windowExtent) {
+      set_render_scale(1.f);
+    }
+    return;
+  }
+  if (m_dynamicResolution.update(gpuFrameMs)) {
+    set_render_scale(m_dynamicResolution.scale());
+    spdlog::info("Render scale {:.2f} ({}x{}), smoothed gpu time over a "
+                 "{:.2f}ms budget",
+                 m_dynamicResolution.scale(), m_renderExtent.width,
+                 m_renderExtent.height, m_dynamicResolution.budget_ms());
+  }
+}
+
+void VulkanEngine::set_render_scale(float scale) {
+  m_dynamicResolution.reset(scale);
+  vk::Extent2D extent(
+      std::max(uint32_t(std::lround(m_windowExtent.width * scale)), 1u),
+      std::max(uint32_t(std::lround(m_windowExtent.height * scale)), 1u));
+  if (extent == m_renderExtent) {
+    return;
+  }
+  m_renderExtent = extent;
+  // cached secondaries bake in the viewport
+  invalidate_static_commands();
+}
+
+void VulkanEngine::set_render_viewport(vk::CommandBuffer cmd) {
+  vk::Viewport viewport(0.f, 0.f, m_renderExtent.width, m_renderExtent.height,
+                        0.f, 1.f);
+  cmd.setViewport(0, viewport);
+  cmd.setScissor(0, vk::Rect2D({0, 0}, m_renderExtent));
+}
+
+void VulkanEngine::record_upscale(vk::CommandBuffer cmd,
+                                  uint32_t swapchainImageIndex) {
+  GpuScope scope(m_profiler, cmd, m_frameNumber % FRAME_OVERLAP, "upscale");
+  vk::RenderPassBeginInfo rpInfo;
+  rpInfo.renderPass = m_upscaleRenderPass;
+  rpInfo.renderArea.setOffset({0, 0});
+  rpInfo.renderArea.extent = m_windowExtent;
+  rpInfo.framebuffer = m_framebuffers[swapchainImageIndex];
+  cmd.beginRenderPass(rpInfo, vk::SubpassContents::eInline);
+
+  vk::Viewport viewport(0.f, 0.f, m_windowExtent.width, m_windowExtent.height,
+                        0.f, 1.f);
+  cmd.setViewport(0, viewport);
+  cmd.setScissor(0, vk::Rect2D({0, 0}, m_windowExtent));
+
+  // the rendered region and the center of its last texel, so filters never
+  // read stale texels outside of it
+  GPUUpscaleConstants constants;
+  glm::vec2 targetSize(m_windowExtent.width, m_windowExtent.height);
+  glm::vec2 renderSize(m_renderExtent.width, m_renderExtent.height);
+  constants.uvScale =
+      glm::vec4(renderSize / targetSize, (renderSize - 0.5f) / targetSize);
+  constants.texelSize = glm::vec4(1.f / targetSize, 0.f, 0.f);
+
+  cmd.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                   m_upscalePipelines[size_t(m_config.upscaleFilter)]);
+  cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_upscaleLayout, 0,
+                         m_upscaleSet, nullptr);
+  cmd.pushConstants(m_upscaleLayout, vk::ShaderStageFlagBits::eFragment, 0,
+                    sizeof(GPUUpscaleConstants), &constants);
+  cmd.draw(3, 1, 0, 0);
+  cmd.endRenderPass();
+}
+
+} // namespace vkr
@@ -0,0 +1,118 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+namespace vkr {
+
+void FramePacer::set_target_fps(double fps) {
+  m_targetFps = std::max(fps, 0.);
+  m_period = m_targetFps > 0.
+                 ? std::chrono::duration_cast<Clock::duration>(
+                       std::chrono::duration<double>(1. / m_targetFps))
+                 : Clock::duration{};
+  m_deadline = Clock::time_point{};
+}
+
+void FramePacer::wait_for_next_frame() {
+  if (m_targetFps <= 0.) {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+  if (m_deadline == Clock::time_point{} || now - m_deadline >= m_period) {
+    m_deadline = now + m_period;
+    return;
+  }
+  if (now >= m_deadline) {
+    m_deadline += m_period;
+    return;
+  }
+
+  Clock::duration remaining = m_deadline - now;
+  if (remaining > m_spinThreshold) {
+    std::this_thread::sleep_for(remaining - m_spinThreshold);
+  }
+  while (Clock::now() < m_deadline) {
+    // busy wait, costs one core for at most m_spinThreshold
+  }
+  m_deadline += m_period;
+}
+
+void FramePacer::record_frame(Clock::time_point now) {
+  if (m_lastFrame != Clock::time_point{}) {
+    double ms =
+        std::chrono::duration<double, std::milli>(now - m_lastFrame).count();
+    push_sample(m_frameTimesMs, m_frameTimeNext, ms);
+  }
+  m_lastFrame = now;
+}
+
+void FramePacer::record_latency(double ms) {
+  push_sample(m_latenciesMs, m_latencyNext, ms);
+}
+
+FramePercentiles FramePacer::frame_time_percentiles() const {
+  return percentiles(m_frameTimesMs);
+}
+
+FramePercentiles FramePacer::latency_percentiles() const {
+  return percentiles(m_latenciesMs);
+}
+
+void FramePacer::reset_stats() {
+  m_frameTimesMs.clear();
+  m_latenciesMs.clear();
+  m_frameTimeNext = 0;
+  m_latencyNext = 0;
+  m_lastFrame = Clock::time_point{};
+}
+
+bool FramePacer::write_csv(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file) {
+    return false;
+  }
+  file << "metric,samples,p50_ms,p95_ms,p99_ms,max_ms\n";
+  auto writeRow = [&](const char *name, const FramePercentiles &p) {
+    file << name << "," << p.samples << "," << p.p50 << "," << p.p95 << ","
+         << p.p99 << "," << p.max << "\n";
+  };
+  writeRow("frame_time", frame_time_percentiles());
+  writeRow("input_latency", latency_percentiles());
+  return file.good();
+}
+
+void FramePacer::push_sample(std::vector<double> &history, size_t &next,
+                             double sample) {
+  if (history.size() < HISTORY_SIZE) {
+    history.push_back(sample);
+  } else {
+    history[next] = sample;
+  }
+  next = (next + 1) % HISTORY_SIZE;
+}
+
+FramePercentiles FramePacer::percentiles(std::vector<double> samples) {
+  FramePercentiles result;
+  result.samples = samples.size();
+  if (samples.empty()) {
+    return result;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  // nearest rank
+  auto rank = [&](double p) {
+    size_t index = std::ceil(p * samples.size());
+    return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+  };
+  result.p50 = rank(0.50);
+  result.p95 = rank(0.95);
+  result.p99 = rank(0.99);
+  result.max = samples.back();
+  return result;
+}
+
+} // namespace vkr
@@ -0,0 +1,270 @@
+#include "gpu_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace vkr {
+
+void GpuProfiler::init(vk::Device device, float timestampPeriod,
+                       uint32_t timestampValidBits, uint32_t slotCount,
+                       bool tracing) {
+  m_device = device;
+  m_timestampPeriod = timestampPeriod;
+  m_timestampMask = timestampValidBits >= 64
+                        ? ~uint64_t(0)
+                        : (uint64_t(1) << timestampValidBits) - 1;
+  m_tracing = tracing;
+  m_slots.assign(slotCount, Slot{});
+  for (Slot &slot : m_slots) {
+    slot.scopes.reserve(MAX_SCOPES);
+  }
+
+  // every slot's scope queries, then every slot's frame pair
+  vk::QueryPoolCreateInfo poolInfo;
+  poolInfo.setQueryType(vk::QueryType::eTimestamp);
+  poolInfo.setQueryCount(slotCount * (MAX_SCOPES + 1) * 2);
+  m_queryPool = m_device.createQueryPool(poolInfo);
+  if (m_tracing) {
+    m_device.resetQueryPool(m_queryPool, 0, slotCount * MAX_SCOPES * 2);
+    m_epoch = Clock::now();
+    m_events.reserve(MAX_EVENTS);
+  }
+}
+
+void GpuProfiler::destroy() {
+  if (m_queryPool) {
+    m_device.destroyQueryPool(m_queryPool);
+    m_queryPool = nullptr;
+  }
+}
+
+int64_t GpuProfiler::ticks_to_ns(uint64_t ticks) const {
+  return int64_t(ticks * double(m_timestampPeriod));
+}
+
+uint64_t GpuProfiler::elapsed_ticks(uint64_t begin, uint64_t end) const {
+  return ((end & m_timestampMask) - (begin & m_timestampMask)) &
+         m_timestampMask;
+}
+
+uint32_t GpuProfiler::frame_query(uint32_t slot) const {
+  return (m_slots.size() * MAX_SCOPES + slot) * 2;
+}
+
+void GpuProfiler::begin_frame(vk::CommandBuffer cmd, uint32_t slot) {
+  if (!m_queryPool || m_timestampMask == 0) {
+    return;
+  }
+  cmd.resetQueryPool(m_queryPool, frame_query(slot), 2);
+  cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_queryPool,
+                     frame_query(slot));
+}
+
+void GpuProfiler::end_frame(vk::CommandBuffer cmd, uint32_t slot) {
+  if (!m_queryPool || m_timestampMask == 0) {
+    return;
+  }
+  cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_queryPool,
+                     frame_query(slot) + 1);
+  m_slots[slot].frameWritten = true;
+}
+
+double GpuProfiler::collect(uint32_t slotIndex) {
+  if (!m_queryPool) {
+    return -1.;
+  }
+  Slot &slot = m_slots[slotIndex];
+  double frameMs = -1.;
+  // earliest begin of the slot's work, anchors the gpu clock
+  int64_t firstNs = INT64_MAX;
+
+  if (slot.frameWritten) {
+    slot.frameWritten = false;
+    uint64_t ticks[2] = {0, 0};
+    vk::Result result = m_device.getQueryPoolResults(
+        m_queryPool, frame_query(slotIndex), 2, sizeof(ticks), ticks,
+        sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result == vk::Result::eSuccess) {
+      int64_t durationNs = ticks_to_ns(elapsed_ticks(ticks[0], ticks[1]));
+      frameMs = durationNs / 1e6;
+      if (m_tracing) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        TraceEvent event;
+        event.name = "frame";
+        event.track = 0;
+        event.beginNs = ticks_to_ns(ticks[0] & m_timestampMask);
+        event.endNs = event.beginNs + durationNs;
+        firstNs = event.beginNs;
+        push_event(event);
+
+        ScopeTime &time = m_scopeTimes[event.name];
+        time.name = event.name;
+        time.totalMs += frameMs;
+        time.count++;
+      }
+    }
+  }
+  if (!m_tracing) {
+    return frameMs;
+  }
+
+  uint32_t base = slotIndex * MAX_SCOPES * 2;
+  uint32_t queryCount = slot.scopes.size() * 2;
+  if (queryCount > 0) {
+    m_ticks.resize(queryCount);
+    vk::Result result = m_device.getQueryPoolResults(
+        m_queryPool, base, queryCount, m_ticks.size() * sizeof(uint64_t),
+        m_ticks.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result == vk::Result::eSuccess) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (const PendingScope &scope : slot.scopes) {
+        uint32_t index = scope.query - base;
+        TraceEvent event;
+        event.name = scope.name;
+        event.track = 0;
+        event.beginNs = ticks_to_ns(m_ticks[index] & m_timestampMask);
+        event.endNs = event.beginNs + ticks_to_ns(elapsed_ticks(
+                                          m_ticks[index], m_ticks[index + 1]));
+        firstNs = std::min(firstNs, event.beginNs);
+        push_event(event);
+
+        ScopeTime &time = m_scopeTimes[scope.name];
+        time.name = scope.name;
+        time.totalMs += (event.endNs - event.beginNs) / 1e6;
+        time.count++;
+      }
+    }
+  }
+
+  if (slot.submitted && firstNs != INT64_MAX) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t submitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           slot.submitTime - m_epoch)
+                           .count();
+    int64_t offset = submitNs - firstNs;
+    if (!m_haveGpuOffset || offset > m_gpuToCpuNs) {
+      m_gpuToCpuNs = offset;
+      m_haveGpuOffset = true;
+    }
+  }
+
+  slot.scopes.clear();
+  slot.submitted = false;
+  m_device.resetQueryPool(m_queryPool, base, MAX_SCOPES * 2);
+  return frameMs;
+}
+
+void GpuProfiler::mark_submit(uint32_t slotIndex,
+                              Clock::time_point submitTime) {
+  if (!enabled()) {
+    return;
+  }
+  m_slots[slotIndex].submitTime = submitTime;
+  m_slots[slotIndex].submitted = true;
+}
+
+uint32_t GpuProfiler::begin_gpu_scope(vk::CommandBuffer cmd,
+                                      uint32_t slotIndex, const char *name) {
+  if (!enabled() || m_slots[slotIndex].scopes.size() >= MAX_SCOPES) {
+    return UINT32_MAX;
+  }
+  Slot &slot = m_slots[slotIndex];
+  uint32_t query = (slotIndex * MAX_SCOPES + slot.scopes.size()) * 2;
+  slot.scopes.push_back({name, query});
+  cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_queryPool,
+                     query);
+  return query;
+}
+
+void GpuProfiler::end_gpu_scope(vk::CommandBuffer cmd, uint32_t slotIndex,
+                                uint32_t scope) {
+  if (scope == UINT32_MAX) {
+    return;
+  }
+  cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_queryPool,
+                     scope + 1);
+}
+
+void GpuProfiler::record_cpu_scope(const char *name, Clock::time_point begin,
+                                   Clock::time_point end) {
+  if (!enabled()) {
+    return;
+  }
+  TraceEvent event;
+  event.name = name;
+  event.beginNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(begin - m_epoch)
+          .count();
+  event.endNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_epoch)
+          .count();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  event.track = thread_track();
+  push_event(event);
+}
+
+void GpuProfiler::set_thread_name(const std::string &name) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_trackNames[thread_track()] = name;
+}
+
+std::vector<GpuProfiler::ScopeTime> GpuProfiler::gpu_scope_times() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<ScopeTime> times;
+  times.reserve(m_scopeTimes.size());
+  for (const auto &[name, time] : m_scopeTimes) {
+    times.push_back(time);
+  }
+  return times;
+}
+
+void GpuProfiler::reset_gpu_scope_times() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_scopeTimes.clear();
+}
+
+uint32_t GpuProfiler::thread_track() {
+  auto [it, inserted] = m_threadTracks.try_emplace(std::this_thread::get_id(),
+                                                   m_trackNames.size());
+  if (inserted) {
+    m_trackNames.push_back("thread " + std::to_string(it->second));
+  }
+  return it->second;
+}
+
+void GpuProfiler::push_event(const TraceEvent &event) {
+  if (m_events.size() < MAX_EVENTS) {
+    m_events.push_back(event);
+  }
+}
+
+bool GpuProfiler::write_chrome_trace(const std::string &path) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::ofstream file(path);
+  if (!file) {
+    return false;
+  }
+
+  // complete events in microseconds, one thread per track
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  for (size_t track = 0; track < m_trackNames.size(); track++) {
+    file << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+         << "\"tid\": " << track << ", \"args\": {\"name\": \""
+         << m_trackNames[track] << "\"}},\n";
+  }
+  for (size_t i = 0; i < m_events.size(); i++) {
+    const TraceEvent &event = m_events[i];
+    int64_t offset = event.track == 0 ? m_gpuToCpuNs : 0;
+    file << "  {\"name\": \"" << event.name
+         << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.track
+         << ", \"ts\": " << (event.beginNs + offset) / 1000.
+         << ", \"dur\": " << (event.endNs - event.beginNs) / 1000. << "}"
+         << (i + 1 < m_events.size() ? ",\n" : "\n");
+  }
+  file << "]}\n";
+  return file.good();
+}
+
+} // namespace vkr
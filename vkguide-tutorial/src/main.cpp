@@ -1,19 +1,63 @@
 #include <glm/common.hpp>
+#include <exception>
 #include <iostream>
 #include <spdlog/spdlog.h>
+#include <string>
 #define VULKAN_HPP_FLAGS_MASK_TYPE_AS_PUBLIC
 #include <vulkan/vulkan.hpp>
 
 #include "engine.hpp"
 
-int main() {
+int main(int argc, char *argv[]) {
   spdlog::info("Hello world!");
 
-  vkr::VulkanEngine engine;
+  constexpr const char *USAGE =
+      "engine [--headless] [--frames n] [--timings path] [--screenshot path]\n"
+      "       [--record-path path] [--play-path path] [--runs n]\n"
+      "       [--report path] [--baseline path] [--tolerance fraction]";
+  vkr::HeadlessConfig headless;
+  vkr::ReplayConfig replay;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    // stoul and stod throw on anything that isn't a number
+    try {
+      if (arg == "--headless") {
+        headless.enabled = true;
+      } else if (arg == "--frames" && hasValue) {
+        headless.frames = std::stoul(argv[++i]);
+      } else if (arg == "--timings" && hasValue) {
+        headless.timingsPath = argv[++i];
+      } else if (arg == "--screenshot" && hasValue) {
+        headless.screenshotPath = argv[++i];
+      } else if (arg == "--record-path" && hasValue) {
+        replay.recordPath = argv[++i];
+      } else if (arg == "--play-path" && hasValue) {
+        replay.playPath = argv[++i];
+      } else if (arg == "--runs" && hasValue) {
+        replay.runs = std::stoul(argv[++i]);
+      } else if (arg == "--report" && hasValue) {
+        replay.reportPath = argv[++i];
+      } else if (arg == "--baseline" && hasValue) {
+        replay.baselinePath = argv[++i];
+      } else if (arg == "--tolerance" && hasValue) {
+        replay.tolerance = std::stod(argv[++i]);
+      } else {
+        spdlog::error("Unknown argument {}\nusage: {}", arg, USAGE);
+        return 1;
+      }
+    } catch (const std::exception &) {
+      spdlog::error("Invalid value {} for {}\nusage: {}", argv[i], arg, USAGE);
+      return 1;
+    }
+  }
+
+  vkr::VulkanEngine engine(headless, replay);
   engine.init();
   engine.run();
   engine.cleanup();
 
   spdlog::info("Shutdown complete");
-  return 0;
+  // lets scripts fail on a slowdown against --baseline
+  return engine.replay_regressed() ? 2 : 0;
 }
@@ -0,0 +1,321 @@
+#include "masked_occlusion.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+namespace vkr {
+
+namespace {
+// anything closer to the camera plane is dropped instead of clipped
+// vulkan also clips clip z < 0, both are handled the same way
+constexpr float MIN_W = 1e-3f;
+constexpr uint32_t FULL_ROW = ~0u;
+
+// coverage of one 32 pixel row, edges are A*x + (B*y + C) with the row term
+// already folded in. strictly inside only, occluders must never overcover
+inline uint32_t row_coverage(const float edgeA[3], const float edgeRow[3],
+                             float x0) {
+  uint32_t mask = 0;
+#if defined(__AVX2__)
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 offsets =
+      _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+  for (uint32_t chunk = 0; chunk < 4; chunk++) {
+    __m256 x = _mm256_add_ps(_mm256_set1_ps(x0 + chunk * 8.f), offsets);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int e = 0; e < 3; e++) {
+      __m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeA[e]), x),
+                                   _mm256_set1_ps(edgeRow[e]));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(value, zero, _CMP_GT_OQ));
+    }
+    mask |= (uint32_t)_mm256_movemask_ps(inside) << (chunk * 8);
+  }
+#elif defined(__SSE4_1__)
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 offsets = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+  for (uint32_t chunk = 0; chunk < 8; chunk++) {
+    __m128 x = _mm_add_ps(_mm_set1_ps(x0 + chunk * 4.f), offsets);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int e = 0; e < 3; e++) {
+      __m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[e]), x),
+                                _mm_set1_ps(edgeRow[e]));
+      inside = _mm_and_ps(inside, _mm_cmpgt_ps(value, zero));
+    }
+    mask |= (uint32_t)_mm_movemask_ps(inside) << (chunk * 4);
+  }
+#else
+  for (uint32_t i = 0; i < MaskedOcclusionBuffer::TILE_WIDTH; i++) {
+    float x = x0 + i;
+    bool inside = true;
+    for (int e = 0; e < 3; e++) {
+      inside &= edgeA[e] * x + edgeRow[e] > 0.f;
+    }
+    mask |= (uint32_t)inside << i;
+  }
+#endif
+  return mask;
+}
+
+// bits [begin, end) of a 32 bit row
+inline uint32_t span_mask(uint32_t begin, uint32_t end) {
+  uint32_t high = end >= 32 ? FULL_ROW : (1u << end) - 1;
+  return high & ~((1u << begin) - 1);
+}
+} // namespace
+
+MaskedOcclusionBuffer::MaskedOcclusionBuffer(uint32_t width, uint32_t height) {
+  resize(width, height);
+}
+
+void MaskedOcclusionBuffer::resize(uint32_t width, uint32_t height) {
+  m_tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+  m_tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+  m_width = m_tilesX * TILE_WIDTH;
+  m_height = m_tilesY * TILE_HEIGHT;
+  m_tiles.resize(m_tilesX * m_tilesY);
+  clear();
+}
+
+void MaskedOcclusionBuffer::clear() {
+  for (auto &tile : m_tiles) {
+    std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+    tile.zMax0 = FLT_MAX;
+    tile.zMax1 = -FLT_MAX;
+  }
+  m_triangles.clear();
+}
+
+void MaskedOcclusionBuffer::add_occluder(const glm::mat4 &modelViewProj,
+                                         const glm::vec3 *vertices,
+                                         size_t vertexCount,
+                                         const uint32_t *indices,
+                                         size_t indexCount) {
+  m_clipScratch.resize(vertexCount);
+  for (size_t i = 0; i < vertexCount; i++) {
+    m_clipScratch[i] = modelViewProj * glm::vec4(vertices[i], 1.f);
+  }
+
+  for (size_t i = 0; i + 2 < indexCount; i += 3) {
+    Triangle triangle;
+    bool behind = false;
+    triangle.zMax = -FLT_MAX;
+    for (int v = 0; v < 3; v++) {
+      const glm::vec4 &clip = m_clipScratch[indices[i + v]];
+      if (clip.w < MIN_W || clip.z < 0.f) {
+        behind = true;
+        break;
+      }
+      glm::vec3 ndc = glm::vec3(clip) / clip.w;
+      triangle.v[v] = glm::vec2((ndc.x * .5f + .5f) * m_width,
+                                (ndc.y * .5f + .5f) * m_height);
+      triangle.zMax = std::max(triangle.zMax, ndc.z);
+    }
+    if (behind) {
+      continue;
+    }
+
+    // double sided, flip clockwise triangles
+    glm::vec2 e1 = triangle.v[1] - triangle.v[0];
+    glm::vec2 e2 = triangle.v[2] - triangle.v[0];
+    float area = e1.x * e2.y - e1.y * e2.x;
+    if (area == 0.f) {
+      continue;
+    }
+    if (area < 0.f) {
+      std::swap(triangle.v[1], triangle.v[2]);
+    }
+
+    glm::vec2 pMin =
+        glm::min(triangle.v[0], glm::min(triangle.v[1], triangle.v[2]));
+    glm::vec2 pMax =
+        glm::max(triangle.v[0], glm::max(triangle.v[1], triangle.v[2]));
+    if (pMax.x <= 0.f || pMax.y <= 0.f || pMin.x >= m_width ||
+        pMin.y >= m_height) {
+      continue;
+    }
+    triangle.tileMinX = std::max(pMin.x, 0.f) / TILE_WIDTH;
+    triangle.tileMinY = std::max(pMin.y, 0.f) / TILE_HEIGHT;
+    triangle.tileMaxX = std::min(pMax.x, (float)m_width - 1.f) / TILE_WIDTH;
+    triangle.tileMaxY = std::min(pMax.y, (float)m_height - 1.f) / TILE_HEIGHT;
+    m_triangles.push_back(triangle);
+  }
+}
+
+void MaskedOcclusionBuffer::rasterize(ThreadPool *pool) {
+  // bands own disjoint tile rows, so workers never share a tile
+  if (pool != nullptr) {
+    pool->parallel_for(m_tilesY, [this](uint32_t begin, uint32_t end) {
+      rasterize_rows(begin, end);
+    });
+  } else {
+    rasterize_rows(0, m_tilesY);
+  }
+  m_triangles.clear();
+}
+
+void MaskedOcclusionBuffer::rasterize_rows(uint32_t tileRowBegin,
+                                           uint32_t tileRowEnd) {
+  for (const auto &triangle : m_triangles) {
+    if (triangle.tileMaxY < tileRowBegin || triangle.tileMinY >= tileRowEnd) {
+      continue;
+    }
+
+    // edge i runs v[i] -> v[i + 1], positive inside: A*x + B*y + C
+    float edges[3][3];
+    for (int e = 0; e < 3; e++) {
+      glm::vec2 a = triangle.v[e];
+      glm::vec2 b = triangle.v[(e + 1) % 3];
+      edges[e][0] = -(b.y - a.y);
+      edges[e][1] = b.x - a.x;
+      edges[e][2] = -(edges[e][0] * a.x + edges[e][1] * a.y);
+    }
+
+    uint32_t rowBegin = std::max(triangle.tileMinY, tileRowBegin);
+    uint32_t rowEnd = std::min(triangle.tileMaxY + 1, tileRowEnd);
+    for (uint32_t tileY = rowBegin; tileY < rowEnd; tileY++) {
+      for (uint32_t tileX = triangle.tileMinX; tileX <= triangle.tileMaxX;
+           tileX++) {
+        rasterize_tile(triangle, edges, tileX, tileY);
+      }
+    }
+  }
+}
+
+void MaskedOcclusionBuffer::rasterize_tile(const Triangle &triangle,
+                                           const float edges[3][3],
+                                           uint32_t tileX, uint32_t tileY) {
+  Tile &tile = m_tiles[tileY * m_tilesX + tileX];
+  // behind everything already known to cover the tile
+  if (triangle.zMax >= tile.zMax0) {
+    return;
+  }
+
+  float x0 = tileX * TILE_WIDTH + .5f;
+  float y0 = tileY * TILE_HEIGHT + .5f;
+  float x1 = x0 + TILE_WIDTH - 1.f;
+  float y1 = y0 + TILE_HEIGHT - 1.f;
+
+  // corners of the pixel centers decide empty / full tiles without the
+  // per row work
+  bool full = true;
+  for (int e = 0; e < 3; e++) {
+    float c00 = edges[e][0] * x0 + edges[e][1] * y0 + edges[e][2];
+    float c10 = edges[e][0] * x1 + edges[e][1] * y0 + edges[e][2];
+    float c01 = edges[e][0] * x0 + edges[e][1] * y1 + edges[e][2];
+    float c11 = edges[e][0] * x1 + edges[e][1] * y1 + edges[e][2];
+    if (c00 <= 0.f && c10 <= 0.f && c01 <= 0.f && c11 <= 0.f) {
+      return;
+    }
+    full &= c00 > 0.f && c10 > 0.f && c01 > 0.f && c11 > 0.f;
+  }
+
+  uint32_t coverage[TILE_HEIGHT];
+  uint32_t any = 0;
+  for (uint32_t row = 0; row < TILE_HEIGHT; row++) {
+    if (full) {
+      coverage[row] = FULL_ROW;
+    } else {
+      float y = y0 + row;
+      float edgeRow[3] = {edges[0][1] * y + edges[0][2],
+                          edges[1][1] * y + edges[1][2],
+                          edges[2][1] * y + edges[2][2]};
+      float edgeA[3] = {edges[0][0], edges[1][0], edges[2][0]};
+      coverage[row] = row_coverage(edgeA, edgeRow, x0);
+    }
+    any |= coverage[row];
+  }
+  if (any == 0) {
+    return;
+  }
+
+  // merge into the working layer, promote it once it covers the whole tile
+  uint32_t merged = FULL_ROW;
+  for (uint32_t row = 0; row < TILE_HEIGHT; row++) {
+    tile.mask[row] |= coverage[row];
+    merged &= tile.mask[row];
+  }
+  tile.zMax1 = std::max(tile.zMax1, triangle.zMax);
+  if (merged == FULL_ROW) {
+    tile.zMax0 = tile.zMax1;
+    tile.zMax1 = -FLT_MAX;
+    std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+  }
+}
+
+bool MaskedOcclusionBuffer::test_rect(glm::vec2 ndcMin, glm::vec2 ndcMax,
+                                      float nearestDepth) const {
+  float minX = std::floor((ndcMin.x * .5f + .5f) * m_width);
+  float minY = std::floor((ndcMin.y * .5f + .5f) * m_height);
+  float maxX = std::ceil((ndcMax.x * .5f + .5f) * m_width);
+  float maxY = std::ceil((ndcMax.y * .5f + .5f) * m_height);
+  if (maxX <= 0.f || maxY <= 0.f || minX >= m_width || minY >= m_height) {
+    return false;
+  }
+  uint32_t pixelMinX = std::max(minX, 0.f);
+  uint32_t pixelMinY = std::max(minY, 0.f);
+  uint32_t pixelMaxX = std::min(maxX, (float)m_width);
+  uint32_t pixelMaxY = std::min(maxY, (float)m_height);
+
+  for (uint32_t tileY = pixelMinY / TILE_HEIGHT;
+       tileY <= (pixelMaxY - 1) / TILE_HEIGHT; tileY++) {
+    uint32_t rowBegin = std::max(pixelMinY, tileY * TILE_HEIGHT) -
+                        tileY * TILE_HEIGHT;
+    uint32_t rowEnd =
+        std::min(pixelMaxY, (tileY + 1) * TILE_HEIGHT) - tileY * TILE_HEIGHT;
+    for (uint32_t tileX = pixelMinX / TILE_WIDTH;
+         tileX <= (pixelMaxX - 1) / TILE_WIDTH; tileX++) {
+      const Tile &tile = m_tiles[tileY * m_tilesX + tileX];
+      if (nearestDepth >= tile.zMax0) {
+        continue;
+      }
+      // only the pixels in the working layer can still hide it
+      if (nearestDepth < tile.zMax1) {
+        return true;
+      }
+      uint32_t columns = span_mask(
+          std::max(pixelMinX, tileX * TILE_WIDTH) - tileX * TILE_WIDTH,
+          std::min(pixelMaxX, (tileX + 1) * TILE_WIDTH) - tileX * TILE_WIDTH);
+      for (uint32_t row = rowBegin; row < rowEnd; row++) {
+        if ((columns & ~tile.mask[row]) != 0) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+bool MaskedOcclusionBuffer::test_sphere(const glm::mat4 &viewProj,
+                                        const glm::vec4 &sphere) const {
+  // screen space bounds of the box around the sphere
+  glm::vec3 ndcMin = glm::vec3(FLT_MAX);
+  glm::vec3 ndcMax = glm::vec3(-FLT_MAX);
+  for (int i = 0; i < 8; i++) {
+    glm::vec3 corner =
+        glm::vec3(sphere) + sphere.w * glm::vec3(i & 1 ? 1.f : -1.f,
+                                                 i & 2 ? 1.f : -1.f,
+                                                 i & 4 ? 1.f : -1.f);
+    glm::vec4 clip = viewProj * glm::vec4(corner, 1.f);
+    // crosses the camera or near plane, can't be bounded on screen
+    if (clip.w < MIN_W || clip.z < 0.f) {
+      return true;
+    }
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    ndcMin = glm::min(ndcMin, ndc);
+    ndcMax = glm::max(ndcMax, ndc);
+  }
+  if (ndcMax.x < -1.f || ndcMax.y < -1.f || ndcMin.x > 1.f || ndcMin.y > 1.f ||
+      ndcMin.z > 1.f) {
+    return false;
+  }
+  return test_rect(glm::vec2(ndcMin), glm::vec2(ndcMax), ndcMin.z);
+}
+
+} // namespace vkr
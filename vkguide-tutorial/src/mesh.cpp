@@ -1,7 +1,11 @@
 #include "mesh.hpp"
+#include "zone_profiler.hpp"
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <filesystem>
 #include <glm/common.hpp>
+#include <glm/geometric.hpp>
 #include <spdlog/spdlog.h>
 #include <unordered_map>
 #include <vulkan/vulkan.hpp>
@@ -38,7 +42,26 @@ VertexInputDescription Vertex::get_vertex_description() {
   return description;
 }
 
+VertexInputDescription Vertex::get_position_vertex_description() {
+  VertexInputDescription description;
+
+  // still strided over the whole vertex, shares the buffers of the full
+  // description
+  vk::VertexInputBindingDescription mainBinding;
+  mainBinding.setBinding(0)
+      .setInputRate(vk::VertexInputRate::eVertex)
+      .setStride(sizeof(Vertex));
+  description.bindings.push_back(mainBinding);
+
+  vk::VertexInputAttributeDescription positionAttribute(
+      0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, position));
+  description.attributes.push_back(positionAttribute);
+
+  return description;
+}
+
 std::optional<Mesh> Mesh::load_from_obj(const char *fileName) {
+  VKR_ZONE("load_from_obj");
   // attrib will contain the vertex arrays of the file
   tinyobj::attrib_t attrib;
   // shapes contains the info for each separate object in the file
@@ -64,9 +87,8 @@ std::optional<Mesh> Mesh::load_from_obj(const char *fileName) {
     return {};
   }
 
-  Mesh m;
+  std::vector<Vertex> triangleVertices;
   glm::vec3 centroid = glm::vec3(0.);
-  std::unordered_map<Vertex, uint32_t> dedupVertices;
   for (const auto &s : shapes) {
     for (const auto &idx : s.mesh.indices) {
       Vertex new_vert;
@@ -86,24 +108,106 @@ std::optional<Mesh> Mesh::load_from_obj(const char *fileName) {
         new_vert.uv.y = 1 - uy;
       }
       centroid += new_vert.position;
-
-      auto existingVert = dedupVertices.find(new_vert);
-      if (existingVert != dedupVertices.end()) {
-        // exists, use the known index
-        m.indices.push_back(existingVert->second);
-      } else {
-        // doesn't exist, put it in dedup and push back
-        m.vertices.push_back(new_vert);
-        dedupVertices[new_vert] = m.vertices.size() - 1;
-        m.indices.push_back(dedupVertices[new_vert]);
-      }
+      triangleVertices.push_back(new_vert);
     }
   }
+  Mesh m = from_triangles(triangleVertices);
   // center the mesh
   centroid /= (double)m.indices.size();
   for (auto &v : m.vertices) {
     v.position -= centroid;
   }
+  m.compute_bounds();
+
+  return m;
+}
 
+Mesh Mesh::from_triangles(const std::vector<Vertex> &triangleVertices) {
+  Mesh m;
+  std::unordered_map<Vertex, uint32_t> dedupVertices;
+  m.indices.reserve(triangleVertices.size());
+  for (const Vertex &vertex : triangleVertices) {
+    // a new vertex gets the next index, a known one reuses its index
+    auto [existing, inserted] =
+        dedupVertices.try_emplace(vertex, m.vertices.size());
+    if (inserted) {
+      m.vertices.push_back(vertex);
+    }
+    m.indices.push_back(existing->second);
+  }
   return m;
-}
\ No newline at end of file
+}
+
+void Mesh::compute_bounds() {
+  if (vertices.empty()) {
+    bounds = glm::vec4(0.);
+    return;
+  }
+
+  // sphere around the aabb center, tighter than the aabb's own sphere
+  glm::vec3 aabbMin = vertices[0].position;
+  glm::vec3 aabbMax = vertices[0].position;
+  for (const auto &v : vertices) {
+    aabbMin = glm::min(aabbMin, v.position);
+    aabbMax = glm::max(aabbMax, v.position);
+  }
+  glm::vec3 center = (aabbMin + aabbMax) * 0.5f;
+  float radius2 = 0.;
+  for (const auto &v : vertices) {
+    glm::vec3 d = v.position - center;
+    radius2 = std::max(radius2, glm::dot(d, d));
+  }
+  bounds = glm::vec4(center, std::sqrt(radius2));
+}
+
+glm::vec4 Mesh::world_bounds(const glm::mat4 &transform) const {
+  float scale = std::max({glm::length(glm::vec3(transform[0])),
+                          glm::length(glm::vec3(transform[1])),
+                          glm::length(glm::vec3(transform[2]))});
+  glm::vec3 center = transform * glm::vec4(glm::vec3(bounds), 1.f);
+  return glm::vec4(center, bounds.w * scale);
+}
+
+void Mesh::build_occluder(uint32_t maxTriangles) {
+  occluderVertices.clear();
+  occluderIndices.clear();
+  if (indices.size() / 3 <= maxTriangles) {
+    for (const auto &v : vertices) {
+      occluderVertices.push_back(v.position);
+    }
+    occluderIndices = indices;
+    return;
+  }
+
+  // keep the largest triangles of the mesh itself. moving or merging vertices
+  // can push an edge outwards, a subset of the source triangles never covers
+  // more than the source, which the occlusion buffer relies on
+  size_t triangleCount = indices.size() / 3;
+  std::vector<float> areas(triangleCount);
+  std::vector<uint32_t> order(triangleCount);
+  for (size_t t = 0; t < triangleCount; t++) {
+    const glm::vec3 &a = vertices[indices[t * 3]].position;
+    const glm::vec3 &b = vertices[indices[t * 3 + 1]].position;
+    const glm::vec3 &c = vertices[indices[t * 3 + 2]].position;
+    areas[t] = glm::length(glm::cross(b - a, c - a));
+    order[t] = t;
+  }
+  std::partial_sort(
+      order.begin(), order.begin() + maxTriangles, order.end(),
+      [&](uint32_t lhs, uint32_t rhs) { return areas[lhs] > areas[rhs]; });
+  // back to mesh order, which keeps the vertex compaction below cache friendly
+  std::sort(order.begin(), order.begin() + maxTriangles);
+
+  std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+  occluderIndices.reserve(maxTriangles * 3);
+  for (uint32_t i = 0; i < maxTriangles; i++) {
+    for (uint32_t corner = 0; corner < 3; corner++) {
+      uint32_t index = indices[order[i] * 3 + corner];
+      if (remap[index] == UINT32_MAX) {
+        remap[index] = occluderVertices.size();
+        occluderVertices.push_back(vertices[index].position);
+      }
+      occluderIndices.push_back(remap[index]);
+    }
+  }
+}
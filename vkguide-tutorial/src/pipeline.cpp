@@ -1,4 +1,6 @@
 #include "pipeline.hpp"
+#include <cstring>
+#include <type_traits>
 #include <spdlog/spdlog.h>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_core.h>
@@ -6,11 +8,186 @@
 
 namespace vkr {
 
-vk::Pipeline PipelineBuilder::build(vk::Device device, vk::RenderPass pass) {
+namespace {
+
+// appends plain values field by field, struct bytes would pull in padding
+// and pNext pointers
+class KeyWriter {
+public:
+  template <typename T> KeyWriter &operator<<(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    m_key.append(bytes, sizeof(T));
+    return *this;
+  }
+  KeyWriter &write(const void *data, size_t size) {
+    *this << size;
+    m_key.append(static_cast<const char *>(data), size);
+    return *this;
+  }
+  std::string take() { return std::move(m_key); }
+
+private:
+  std::string m_key;
+};
+
+} // namespace
+
+std::string PipelineBuilder::state_key(vk::RenderPass pass) const {
+  KeyWriter key;
+  // subpass is always 0
+  key << VkRenderPass(pass) << VkPipelineLayout(pipelineLayout);
+
+  key << shaderStages.size();
+  for (const vk::PipelineShaderStageCreateInfo &stage : shaderStages) {
+    key << stage.flags << stage.stage << VkShaderModule(stage.module);
+    key.write(stage.pName, strlen(stage.pName));
+    const vk::SpecializationInfo *specialization =
+        stage.pSpecializationInfo;
+    key << uint32_t(specialization ? specialization->mapEntryCount : 0);
+    if (specialization) {
+      for (uint32_t i = 0; i < specialization->mapEntryCount; i++) {
+        const vk::SpecializationMapEntry &entry =
+            specialization->pMapEntries[i];
+        key << entry.constantID << entry.offset << entry.size;
+      }
+      key.write(specialization->pData, specialization->dataSize);
+    }
+  }
+
+  key << vertexInputInfo.vertexBindingDescriptionCount;
+  for (uint32_t i = 0; i < vertexInputInfo.vertexBindingDescriptionCount;
+       i++) {
+    const vk::VertexInputBindingDescription &binding =
+        vertexInputInfo.pVertexBindingDescriptions[i];
+    key << binding.binding << binding.stride << binding.inputRate;
+  }
+  key << vertexInputInfo.vertexAttributeDescriptionCount;
+  for (uint32_t i = 0; i < vertexInputInfo.vertexAttributeDescriptionCount;
+       i++) {
+    const vk::VertexInputAttributeDescription &attribute =
+        vertexInputInfo.pVertexAttributeDescriptions[i];
+    key << attribute.location << attribute.binding << attribute.format
+        << attribute.offset;
+  }
+  key << inputAssembly.topology << inputAssembly.primitiveRestartEnable;
+
+  key << dynamicStates.size();
+  bool dynamicViewport = false, dynamicScissor = false;
+  for (vk::DynamicState state : dynamicStates) {
+    key << state;
+    dynamicViewport |= state == vk::DynamicState::eViewport;
+    dynamicScissor |= state == vk::DynamicState::eScissor;
+  }
+  if (!dynamicViewport) {
+    key << viewport.x << viewport.y << viewport.width << viewport.height
+        << viewport.minDepth << viewport.maxDepth;
+  }
+  if (!dynamicScissor) {
+    key << scissor.offset.x << scissor.offset.y << scissor.extent.width
+        << scissor.extent.height;
+  }
+
+  key << rasterizer.depthClampEnable << rasterizer.rasterizerDiscardEnable
+      << rasterizer.polygonMode << rasterizer.cullMode << rasterizer.frontFace
+      << rasterizer.depthBiasEnable << rasterizer.depthBiasConstantFactor
+      << rasterizer.depthBiasClamp << rasterizer.depthBiasSlopeFactor
+      << rasterizer.lineWidth;
+
+  key << colorBlendAttachment.blendEnable
+      << colorBlendAttachment.srcColorBlendFactor
+      << colorBlendAttachment.dstColorBlendFactor
+      << colorBlendAttachment.colorBlendOp
+      << colorBlendAttachment.srcAlphaBlendFactor
+      << colorBlendAttachment.dstAlphaBlendFactor
+      << colorBlendAttachment.alphaBlendOp
+      << colorBlendAttachment.colorWriteMask;
+
+  key << multisampling.rasterizationSamples
+      << multisampling.sampleShadingEnable << multisampling.minSampleShading
+      << multisampling.alphaToCoverageEnable
+      << multisampling.alphaToOneEnable;
+  // one word covers up to 32 samples
+  key << (multisampling.pSampleMask ? *multisampling.pSampleMask
+                                    : ~vk::SampleMask(0));
+
+  key << depthStencil.depthTestEnable << depthStencil.depthWriteEnable
+      << depthStencil.depthCompareOp << depthStencil.depthBoundsTestEnable
+      << depthStencil.stencilTestEnable << depthStencil.front
+      << depthStencil.back << depthStencil.minDepthBounds
+      << depthStencil.maxDepthBounds;
+  return key.take();
+}
+
+vk::Pipeline PipelineBuilder::build(PipelineStateCache &states,
+                                    vk::RenderPass pass) const {
+  return states.get(*this, pass);
+}
+
+void PipelineStateCache::init(vk::Device device, vk::PipelineCache cache) {
+  m_device = device;
+  m_cache = cache;
+}
+
+void PipelineStateCache::destroy() {
+  std::lock_guard lock(m_mutex);
+  for (auto &[key, pipeline] : m_pipelines) {
+    try {
+      m_device.destroyPipeline(pipeline.get());
+    } catch (const std::exception &) {
+      // the build failed, nothing to destroy
+    }
+  }
+  m_pipelines.clear();
+  m_stats = {};
+}
+
+vk::Pipeline PipelineStateCache::get(const PipelineBuilder &builder,
+                                     vk::RenderPass pass) {
+  std::string key = builder.state_key(pass);
+  std::promise<vk::Pipeline> promise;
+  std::shared_future<vk::Pipeline> existing;
+  {
+    std::lock_guard lock(m_mutex);
+    auto [it, inserted] =
+        m_pipelines.try_emplace(std::move(key), promise.get_future().share());
+    if (inserted) {
+      m_stats.misses++;
+      m_stats.live = m_pipelines.size();
+    } else {
+      m_stats.hits++;
+      existing = it->second;
+    }
+  }
+  if (existing.valid()) {
+    // may wait for another thread building the same state
+    return existing.get();
+  }
+
+  try {
+    vk::Pipeline pipeline = builder.build(m_device, pass, m_cache);
+    promise.set_value(pipeline);
+    return pipeline;
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+}
+
+PipelineStateCache::Stats PipelineStateCache::stats() const {
+  std::lock_guard lock(m_mutex);
+  return m_stats;
+}
+
+vk::Pipeline PipelineBuilder::build(vk::Device device, vk::RenderPass pass,
+                                    vk::PipelineCache cache) const {
   vk::PipelineViewportStateCreateInfo viewportState;
   viewportState.setViewports(viewport);
   viewportState.setScissors(scissor);
 
+  vk::PipelineDynamicStateCreateInfo dynamicState;
+  dynamicState.setDynamicStates(dynamicStates);
+
   // dummy color blending
   vk::PipelineColorBlendStateCreateInfo colorBlending;
   colorBlending.setLogicOpEnable(false);
@@ -29,9 +206,10 @@ vk::Pipeline PipelineBuilder::build(vk::Device device, vk::RenderPass pass) {
   pipelineInfo.subpass = 0;
   pipelineInfo.setBasePipelineHandle(VK_NULL_HANDLE);
   pipelineInfo.setPDepthStencilState(&depthStencil);
+  pipelineInfo.setPDynamicState(&dynamicState);
 
   vk::Pipeline pipeline =
-      device.createGraphicsPipeline(VK_NULL_HANDLE, pipelineInfo).value;
+      device.createGraphicsPipeline(cache, pipelineInfo).value;
   spdlog::info("Successfully created pipeline");
   return pipeline;
 }
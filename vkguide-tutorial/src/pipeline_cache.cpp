@@ -0,0 +1,155 @@
+#include "pipeline_cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace vkr {
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x43504b56; // "VKPC"
+constexpr uint32_t VERSION = 1;
+
+// fnv-1a, catches truncated and corrupt files before the driver sees them
+uint64_t hash_data(const std::vector<uint8_t> &data) {
+  uint64_t hash = 14695981039346656037ull;
+  for (uint8_t byte : data) {
+    hash = (hash ^ byte) * 1099511628211ull;
+  }
+  return hash;
+}
+
+} // namespace
+
+void PipelineCache::init(vk::Device device,
+                         const vk::PhysicalDeviceProperties &properties,
+                         std::string path) {
+  m_device = device;
+  m_properties = properties;
+  m_path = std::move(path);
+  m_lastSave = Clock::now();
+
+  std::vector<uint8_t> data;
+  std::error_code sizeError;
+  uint64_t fileSize = std::filesystem::file_size(m_path, sizeError);
+  std::ifstream file(m_path, std::ios::binary);
+  FileHeader header = {};
+  if (!sizeError &&
+      file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    FileHeader expected = expected_header();
+    if (header.magic == expected.magic && header.version == expected.version &&
+        header.vendorID == expected.vendorID &&
+        header.deviceID == expected.deviceID &&
+        header.driverVersion == expected.driverVersion &&
+        std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID,
+                    VK_UUID_SIZE) == 0) {
+      // the size is checked before it's trusted with an allocation
+      if (header.dataSize == fileSize - sizeof(header)) {
+        data.resize(header.dataSize);
+      }
+      if (data.empty() ||
+          !file.read(reinterpret_cast<char *>(data.data()), data.size()) ||
+          hash_data(data) != header.dataHash || !matches_device(data)) {
+        spdlog::warn("Pipeline cache {} is corrupt, starting cold", m_path);
+        data.clear();
+      }
+    } else {
+      spdlog::info("Pipeline cache {} is from another device or driver, "
+                   "starting cold",
+                   m_path);
+    }
+  }
+
+  vk::PipelineCacheCreateInfo cacheInfo;
+  cacheInfo.setInitialDataSize(data.size());
+  cacheInfo.setPInitialData(data.data());
+  m_cache = m_device.createPipelineCache(cacheInfo);
+  m_warm = !data.empty();
+  m_savedSize = data.size();
+  if (m_warm) {
+    spdlog::info("Loaded {} byte pipeline cache from {}", data.size(),
+                 m_path);
+  }
+}
+
+void PipelineCache::destroy() {
+  if (m_cache) {
+    m_device.destroyPipelineCache(m_cache);
+    m_cache = nullptr;
+  }
+}
+
+bool PipelineCache::save() {
+  if (!m_cache) {
+    return false;
+  }
+  m_lastSave = Clock::now();
+  std::vector<uint8_t> data = m_device.getPipelineCacheData(m_cache);
+  // caches only grow while pipelines are added
+  if (data.size() == m_savedSize) {
+    return true;
+  }
+
+  FileHeader header = expected_header();
+  header.dataSize = data.size();
+  header.dataHash = hash_data(data);
+
+  std::string tempPath = m_path + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    if (!file.flush()) {
+      spdlog::warn("Could not write {}", tempPath);
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tempPath, m_path, error);
+  if (error) {
+    spdlog::warn("Could not replace {}: {}", m_path, error.message());
+    return false;
+  }
+  m_savedSize = data.size();
+  spdlog::info("Saved {} byte pipeline cache to {}", data.size(), m_path);
+  return true;
+}
+
+void PipelineCache::save_periodically(Clock::time_point now) {
+  if (m_cache && now - m_lastSave >= SAVE_INTERVAL) {
+    save();
+  }
+}
+
+PipelineCache::FileHeader PipelineCache::expected_header() const {
+  FileHeader header = {};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.vendorID = m_properties.vendorID;
+  header.deviceID = m_properties.deviceID;
+  header.driverVersion = m_properties.driverVersion;
+  std::memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID.data(),
+              VK_UUID_SIZE);
+  return header;
+}
+
+bool PipelineCache::matches_device(const std::vector<uint8_t> &data) const {
+  // the driver's own header at the start of the data
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == m_properties.vendorID &&
+         header.deviceID == m_properties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID,
+                     m_properties.pipelineCacheUUID.data(),
+                     VK_UUID_SIZE) == 0;
+}
+
+} // namespace vkr
@@ -0,0 +1,128 @@
+#include "replay_report.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace vkr {
+
+namespace {
+
+// the metric's value in every run that has it
+std::vector<double> metric_values(const std::vector<ReplayMetrics> &runs,
+                                  const std::string &name) {
+  std::vector<double> values;
+  for (const ReplayMetrics &run : runs) {
+    auto it = std::find_if(run.begin(), run.end(),
+                           [&](const ReplayMetric &metric) {
+                             return metric.name == name;
+                           });
+    if (it != run.end()) {
+      values.push_back(it->value);
+    }
+  }
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+double median(const std::vector<double> &sorted) {
+  size_t middle = sorted.size() / 2;
+  return sorted.size() % 2 == 1
+             ? sorted[middle]
+             : (sorted[middle - 1] + sorted[middle]) / 2.;
+}
+
+} // namespace
+
+ReplayMetrics median_metrics(const std::vector<ReplayMetrics> &runs) {
+  ReplayMetrics medians;
+  if (runs.empty()) {
+    return medians;
+  }
+  for (const ReplayMetric &metric : runs.front()) {
+    medians.push_back({metric.name, median(metric_values(runs, metric.name))});
+  }
+  return medians;
+}
+
+bool write_replay_report(const std::string &path,
+                         const std::vector<ReplayMetrics> &runs) {
+  std::ofstream file(path);
+  if (!file || runs.empty()) {
+    return false;
+  }
+
+  file << "metric,median,min,max";
+  for (size_t run = 0; run < runs.size(); run++) {
+    file << ",run " << run;
+  }
+  file << "\n";
+  for (const ReplayMetric &metric : runs.front()) {
+    std::vector<double> values = metric_values(runs, metric.name);
+    file << metric.name << "," << median(values) << "," << values.front()
+         << "," << values.back();
+    for (const ReplayMetrics &run : runs) {
+      auto it = std::find_if(run.begin(), run.end(),
+                             [&](const ReplayMetric &other) {
+                               return other.name == metric.name;
+                             });
+      file << ",";
+      if (it != run.end()) {
+        file << it->value;
+      }
+    }
+    file << "\n";
+  }
+  return file.good();
+}
+
+std::optional<ReplayMetrics> read_replay_report(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  if (!std::getline(file, line) || line.rfind("metric,median", 0) != 0) {
+    return std::nullopt;
+  }
+
+  ReplayMetrics metrics;
+  while (std::getline(file, line)) {
+    std::istringstream row(line);
+    ReplayMetric metric;
+    std::string value;
+    if (!std::getline(row, metric.name, ',') ||
+        !std::getline(row, value, ',')) {
+      return std::nullopt;
+    }
+    try {
+      metric.value = std::stod(value);
+    } catch (const std::exception &) {
+      return std::nullopt;
+    }
+    metrics.push_back(std::move(metric));
+  }
+  return metrics;
+}
+
+std::vector<ReplayRegression> compare_replay_metrics(
+    const ReplayMetrics &baseline, const ReplayMetrics &current,
+    double tolerance) {
+  std::unordered_map<std::string, double> baselineValues;
+  for (const ReplayMetric &metric : baseline) {
+    baselineValues[metric.name] = metric.value;
+  }
+
+  std::vector<ReplayRegression> regressions;
+  for (const ReplayMetric &metric : current) {
+    auto it = baselineValues.find(metric.name);
+    if (it == baselineValues.end() || it->second <= 0.) {
+      continue;
+    }
+    double change = metric.value / it->second - 1.;
+    if (change > tolerance) {
+      regressions.push_back({metric.name, it->second, metric.value, change});
+    }
+  }
+  return regressions;
+}
+
+} // namespace vkr
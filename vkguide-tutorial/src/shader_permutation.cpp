@@ -0,0 +1,55 @@
+#include "shader_permutation.hpp"
+
+#include <array>
+
+namespace vkr {
+
+namespace {
+
+struct Permutation {
+  std::array<vk::Bool32, MATERIAL_FEATURE_COUNT> values;
+  std::array<vk::SpecializationMapEntry, MATERIAL_FEATURE_COUNT> entries;
+  vk::SpecializationInfo info;
+};
+
+// every permutation up front, there are only 16. filled in place, the infos
+// point into their own entries and values
+void init_permutations(
+    std::array<Permutation, MATERIAL_FEATURE_MASK + 1> &permutations) {
+  for (uint32_t features = 0; features < permutations.size(); features++) {
+    Permutation &permutation = permutations[features];
+    for (uint32_t i = 0; i < MATERIAL_FEATURE_COUNT; i++) {
+      permutation.values[i] = (features >> i) & 1;
+      permutation.entries[i] = vk::SpecializationMapEntry(
+          i, i * sizeof(vk::Bool32), sizeof(vk::Bool32));
+    }
+    permutation.info.setMapEntries(permutation.entries);
+    permutation.info.setDataSize(sizeof(permutation.values));
+    permutation.info.setPData(permutation.values.data());
+  }
+}
+
+} // namespace
+
+const vk::SpecializationInfo *mesh_specialization(MaterialFeatures features) {
+  // never moves. statics initialize once even with several threads racing
+  // here, so the first caller fills it in place
+  static std::array<Permutation, MATERIAL_FEATURE_MASK + 1> permutations;
+  static const bool initialized = (init_permutations(permutations), true);
+  (void)initialized;
+  return &permutations[features & MATERIAL_FEATURE_MASK].info;
+}
+
+std::string material_features_name(MaterialFeatures features) {
+  constexpr const char *NAMES[MATERIAL_FEATURE_COUNT] = {
+      "textured", "lit", "fog", "vertex color"};
+  std::string name;
+  for (uint32_t i = 0; i < MATERIAL_FEATURE_COUNT; i++) {
+    if (features & (1u << i)) {
+      name += name.empty() ? NAMES[i] : std::string("|") + NAMES[i];
+    }
+  }
+  return name.empty() ? "none" : name;
+}
+
+} // namespace vkr
@@ -0,0 +1,505 @@
+#include "shader_reflection.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace vkr {
+
+namespace {
+
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+// the subset of the spir-v spec reflection needs
+enum Op : uint32_t {
+  OP_ENTRY_POINT = 15,
+  OP_TYPE_BOOL = 20,
+  OP_TYPE_INT = 21,
+  OP_TYPE_FLOAT = 22,
+  OP_TYPE_VECTOR = 23,
+  OP_TYPE_MATRIX = 24,
+  OP_TYPE_IMAGE = 25,
+  OP_TYPE_SAMPLER = 26,
+  OP_TYPE_SAMPLED_IMAGE = 27,
+  OP_TYPE_ARRAY = 28,
+  OP_TYPE_RUNTIME_ARRAY = 29,
+  OP_TYPE_STRUCT = 30,
+  OP_TYPE_POINTER = 32,
+  OP_CONSTANT = 43,
+  OP_VARIABLE = 59,
+  OP_DECORATE = 71,
+  OP_MEMBER_DECORATE = 72,
+  OP_TYPE_ACCELERATION_STRUCTURE = 5341,
+};
+
+enum Decoration : uint32_t {
+  DECORATION_BLOCK = 2,
+  DECORATION_BUFFER_BLOCK = 3,
+  DECORATION_ARRAY_STRIDE = 6,
+  DECORATION_MATRIX_STRIDE = 7,
+  DECORATION_BINDING = 33,
+  DECORATION_DESCRIPTOR_SET = 34,
+  DECORATION_OFFSET = 35,
+};
+
+enum StorageClass : uint32_t {
+  STORAGE_UNIFORM_CONSTANT = 0,
+  STORAGE_UNIFORM = 2,
+  STORAGE_PUSH_CONSTANT = 9,
+  STORAGE_STORAGE_BUFFER = 12,
+};
+
+constexpr uint32_t DIM_BUFFER = 5;
+constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+struct Decorations {
+  std::optional<uint32_t> set;
+  std::optional<uint32_t> binding;
+  bool block = false;
+  bool bufferBlock = false;
+  uint32_t arrayStride = 0;
+};
+
+struct MemberDecorations {
+  uint32_t offset = 0;
+  uint32_t matrixStride = 0;
+};
+
+struct Variable {
+  uint32_t id;
+  uint32_t pointerType;
+  uint32_t storageClass;
+};
+
+class Module {
+public:
+  Module(const uint32_t *code, size_t wordCount) {
+    if (wordCount < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+      throw std::runtime_error("Not a spir-v module");
+    }
+    for (size_t i = SPIRV_HEADER_WORDS; i < wordCount;) {
+      uint32_t length = code[i] >> 16;
+      uint32_t op = code[i] & 0xffff;
+      if (length == 0 || i + length > wordCount) {
+        throw std::runtime_error(
+            fmt::format("Truncated spir-v instruction at word {}", i));
+      }
+      parse(op, code + i + 1, length - 1);
+      i += length;
+    }
+  }
+
+  vk::ShaderStageFlags stage() const { return m_stage; }
+  const std::vector<Variable> &variables() const { return m_variables; }
+
+  const Decorations &decorations(uint32_t id) const {
+    static const Decorations NONE;
+    auto it = m_decorations.find(id);
+    return it == m_decorations.end() ? NONE : it->second;
+  }
+
+  const std::vector<uint32_t> &type(uint32_t id) const {
+    auto it = m_types.find(id);
+    if (it == m_types.end()) {
+      throw std::runtime_error(fmt::format("Unknown spir-v type %{}", id));
+    }
+    return it->second;
+  }
+
+  uint32_t constant(uint32_t id) const {
+    auto it = m_constants.find(id);
+    if (it == m_constants.end()) {
+      // e.g. a specialization constant sized array
+      throw std::runtime_error(
+          fmt::format("Array length %{} is not a constant", id));
+    }
+    return it->second;
+  }
+
+  // in bytes, as laid out by the offsets and strides of the block
+  uint32_t size_of(uint32_t typeId, uint32_t matrixStride = 0) const {
+    const std::vector<uint32_t> &t = type(typeId);
+    switch (t[0]) {
+    case OP_TYPE_BOOL:
+      return 4;
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT:
+      return t[2] / 8;
+    case OP_TYPE_VECTOR:
+      return t[3] * size_of(t[2]);
+    case OP_TYPE_MATRIX:
+      return t[3] * (matrixStride ? matrixStride : size_of(t[2]));
+    case OP_TYPE_ARRAY: {
+      uint32_t stride = decorations(t[1]).arrayStride;
+      return constant(t[3]) * (stride ? stride : size_of(t[2]));
+    }
+    case OP_TYPE_RUNTIME_ARRAY:
+      return 0;
+    case OP_TYPE_STRUCT: {
+      uint32_t size = 0;
+      for (uint32_t member = 0; member + 2 < t.size(); member++) {
+        MemberDecorations layout = member_decorations(t[1], member);
+        size = std::max(size, layout.offset + size_of(t[member + 2],
+                                                      layout.matrixStride));
+      }
+      return size;
+    }
+    default:
+      throw std::runtime_error(
+          fmt::format("No size for spir-v type op {}", t[0]));
+    }
+  }
+
+private:
+  // operands without the opcode word, a type is kept as its op followed by
+  // its operands, starting with its own id
+  void parse(uint32_t op, const uint32_t *operands, uint32_t count) {
+    switch (op) {
+    case OP_ENTRY_POINT:
+      if (!m_stage) {
+        m_stage = stage_of(operands[0]);
+      }
+      break;
+    case OP_TYPE_BOOL:
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT:
+    case OP_TYPE_VECTOR:
+    case OP_TYPE_MATRIX:
+    case OP_TYPE_IMAGE:
+    case OP_TYPE_SAMPLER:
+    case OP_TYPE_SAMPLED_IMAGE:
+    case OP_TYPE_ARRAY:
+    case OP_TYPE_RUNTIME_ARRAY:
+    case OP_TYPE_STRUCT:
+    case OP_TYPE_POINTER:
+    case OP_TYPE_ACCELERATION_STRUCTURE: {
+      std::vector<uint32_t> &t = m_types[operands[0]];
+      t.push_back(op);
+      t.insert(t.end(), operands, operands + count);
+      break;
+    }
+    case OP_CONSTANT:
+      // result type, id, low word of the value
+      if (count >= 3) {
+        m_constants[operands[1]] = operands[2];
+      }
+      break;
+    case OP_VARIABLE:
+      m_variables.push_back({operands[1], operands[0], operands[2]});
+      break;
+    case OP_DECORATE: {
+      Decorations &d = m_decorations[operands[0]];
+      switch (operands[1]) {
+      case DECORATION_BLOCK:
+        d.block = true;
+        break;
+      case DECORATION_BUFFER_BLOCK:
+        d.bufferBlock = true;
+        break;
+      case DECORATION_ARRAY_STRIDE:
+        d.arrayStride = operands[2];
+        break;
+      case DECORATION_BINDING:
+        d.binding = operands[2];
+        break;
+      case DECORATION_DESCRIPTOR_SET:
+        d.set = operands[2];
+        break;
+      }
+      break;
+    }
+    case OP_MEMBER_DECORATE: {
+      MemberDecorations &d = m_memberDecorations[member_key(operands[0],
+                                                            operands[1])];
+      if (operands[2] == DECORATION_OFFSET) {
+        d.offset = operands[3];
+      } else if (operands[2] == DECORATION_MATRIX_STRIDE) {
+        d.matrixStride = operands[3];
+      }
+      break;
+    }
+    }
+  }
+
+  static vk::ShaderStageFlags stage_of(uint32_t executionModel) {
+    switch (executionModel) {
+    case 0:
+      return vk::ShaderStageFlagBits::eVertex;
+    case 1:
+      return vk::ShaderStageFlagBits::eTessellationControl;
+    case 2:
+      return vk::ShaderStageFlagBits::eTessellationEvaluation;
+    case 3:
+      return vk::ShaderStageFlagBits::eGeometry;
+    case 4:
+      return vk::ShaderStageFlagBits::eFragment;
+    case 5:
+      return vk::ShaderStageFlagBits::eCompute;
+    default:
+      throw std::runtime_error(
+          fmt::format("Unsupported execution model {}", executionModel));
+    }
+  }
+
+  static uint64_t member_key(uint32_t structId, uint32_t member) {
+    return uint64_t(structId) << 32 | member;
+  }
+
+  MemberDecorations member_decorations(uint32_t structId,
+                                       uint32_t member) const {
+    auto it = m_memberDecorations.find(member_key(structId, member));
+    return it == m_memberDecorations.end() ? MemberDecorations{} : it->second;
+  }
+
+  vk::ShaderStageFlags m_stage;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> m_types;
+  std::unordered_map<uint32_t, uint32_t> m_constants;
+  std::unordered_map<uint32_t, Decorations> m_decorations;
+  std::unordered_map<uint64_t, MemberDecorations> m_memberDecorations;
+  std::vector<Variable> m_variables;
+};
+
+// the descriptor a variable of storage class storageClass and type typeId
+// needs, after its array wrappers were stripped
+vk::DescriptorType descriptor_type(const Module &module, uint32_t typeId,
+                                   uint32_t storageClass) {
+  const std::vector<uint32_t> &t = module.type(typeId);
+  switch (t[0]) {
+  case OP_TYPE_SAMPLED_IMAGE:
+    return vk::DescriptorType::eCombinedImageSampler;
+  case OP_TYPE_SAMPLER:
+    return vk::DescriptorType::eSampler;
+  case OP_TYPE_ACCELERATION_STRUCTURE:
+    return vk::DescriptorType::eAccelerationStructureKHR;
+  case OP_TYPE_IMAGE: {
+    // id, sampled type, dim, depth, arrayed, ms, sampled
+    uint32_t dim = t[3];
+    bool storage = t[7] == 2;
+    if (dim == DIM_SUBPASS_DATA) {
+      return vk::DescriptorType::eInputAttachment;
+    }
+    if (dim == DIM_BUFFER) {
+      return storage ? vk::DescriptorType::eStorageTexelBuffer
+                     : vk::DescriptorType::eUniformTexelBuffer;
+    }
+    return storage ? vk::DescriptorType::eStorageImage
+                   : vk::DescriptorType::eSampledImage;
+  }
+  case OP_TYPE_STRUCT:
+    if (storageClass == STORAGE_STORAGE_BUFFER ||
+        module.decorations(t[1]).bufferBlock) {
+      return vk::DescriptorType::eStorageBuffer;
+    }
+    return vk::DescriptorType::eUniformBuffer;
+  default:
+    throw std::runtime_error(
+        fmt::format("No descriptor type for spir-v type op {}", t[0]));
+  }
+}
+
+void add_binding(std::vector<ReflectedBinding> &bindings,
+                 const ReflectedBinding &binding, uint32_t set) {
+  auto it = std::lower_bound(bindings.begin(), bindings.end(), binding.binding,
+                             [](const ReflectedBinding &b, uint32_t index) {
+                               return b.binding < index;
+                             });
+  if (it == bindings.end() || it->binding != binding.binding) {
+    bindings.insert(it, binding);
+    return;
+  }
+  if (it->type != binding.type || it->count != binding.count) {
+    throw std::runtime_error(fmt::format(
+        "Set {} binding {} is {} x{} in one shader and {} x{} in another", set,
+        binding.binding, vk::to_string(it->type), it->count,
+        vk::to_string(binding.type), binding.count));
+  }
+  it->stages |= binding.stages;
+}
+
+// appends plain values, a key per distinct create info
+template <typename T> void append_key(std::string &key, const T &value) {
+  key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+} // namespace
+
+ShaderReflection reflect_spirv(const uint32_t *code, size_t wordCount) {
+  Module module(code, wordCount);
+  ShaderReflection reflection;
+  reflection.stages = module.stage();
+
+  for (const Variable &variable : module.variables()) {
+    bool descriptor = variable.storageClass == STORAGE_UNIFORM_CONSTANT ||
+                      variable.storageClass == STORAGE_UNIFORM ||
+                      variable.storageClass == STORAGE_STORAGE_BUFFER;
+    if (!descriptor && variable.storageClass != STORAGE_PUSH_CONSTANT) {
+      continue;
+    }
+    // pointer: id, storage class, pointee
+    uint32_t typeId = module.type(variable.pointerType)[3];
+    if (variable.storageClass == STORAGE_PUSH_CONSTANT) {
+      reflection.pushConstantSize =
+          std::max(reflection.pushConstantSize, module.size_of(typeId));
+      reflection.pushConstantStages |= module.stage();
+      continue;
+    }
+
+    const Decorations &decorations = module.decorations(variable.id);
+    if (!decorations.set || !decorations.binding) {
+      continue;
+    }
+    uint32_t count = 1;
+    for (const std::vector<uint32_t> *t = &module.type(typeId);
+         (*t)[0] == OP_TYPE_ARRAY || (*t)[0] == OP_TYPE_RUNTIME_ARRAY;
+         t = &module.type(typeId)) {
+      count = (*t)[0] == OP_TYPE_ARRAY ? count * module.constant((*t)[3]) : 0;
+      typeId = (*t)[2];
+    }
+    ReflectedBinding binding;
+    binding.binding = *decorations.binding;
+    binding.type = descriptor_type(module, typeId, variable.storageClass);
+    binding.count = count;
+    binding.stages = module.stage();
+    add_binding(reflection.sets[*decorations.set], binding, *decorations.set);
+  }
+  return reflection;
+}
+
+void ShaderReflection::merge(const ShaderReflection &other) {
+  stages |= other.stages;
+  for (const auto &[set, bindings] : other.sets) {
+    for (const ReflectedBinding &binding : bindings) {
+      add_binding(sets[set], binding, set);
+    }
+  }
+  pushConstantSize = std::max(pushConstantSize, other.pushConstantSize);
+  pushConstantStages |= other.pushConstantStages;
+}
+
+void ShaderReflection::override_type(uint32_t set, uint32_t binding,
+                                     vk::DescriptorType type) {
+  auto it = sets.find(set);
+  if (it != sets.end()) {
+    for (ReflectedBinding &b : it->second) {
+      if (b.binding == binding) {
+        b.type = type;
+        return;
+      }
+    }
+  }
+  throw std::runtime_error(
+      fmt::format("No set {} binding {} to override", set, binding));
+}
+
+std::vector<vk::PushConstantRange>
+ShaderReflection::push_constant_ranges() const {
+  if (pushConstantSize == 0) {
+    return {};
+  }
+  return {vk::PushConstantRange(pushConstantStages, 0, pushConstantSize)};
+}
+
+void LayoutCache::init(vk::Device device, uint32_t runtimeArraySize) {
+  m_device = device;
+  m_runtimeArraySize = runtimeArraySize;
+}
+
+void LayoutCache::destroy() {
+  for (auto &[key, layout] : m_pipelineLayouts) {
+    m_device.destroyPipelineLayout(layout);
+  }
+  for (auto &[key, layout] : m_setLayouts) {
+    m_device.destroyDescriptorSetLayout(layout);
+  }
+  m_pipelineLayouts.clear();
+  m_setLayouts.clear();
+}
+
+vk::DescriptorSetLayout
+LayoutCache::set_layout(const std::vector<ReflectedBinding> &bindings) {
+  std::string key;
+  for (const ReflectedBinding &binding : bindings) {
+    append_key(key, binding.binding);
+    append_key(key, binding.type);
+    append_key(key, binding.count);
+    append_key(key, binding.stages);
+  }
+  auto it = m_setLayouts.find(key);
+  if (it != m_setLayouts.end()) {
+    return it->second;
+  }
+
+  std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+  std::vector<vk::DescriptorBindingFlags> bindingFlags;
+  bool runtimeArray = false;
+  for (const ReflectedBinding &binding : bindings) {
+    layoutBindings.emplace_back(
+        binding.binding, binding.type,
+        binding.count ? binding.count : m_runtimeArraySize, binding.stages);
+    // a variable count only goes on the last binding
+    if (binding.count == 0) {
+      bindingFlags.push_back(
+          vk::DescriptorBindingFlagBits::ePartiallyBound |
+          vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+          vk::DescriptorBindingFlagBits::eVariableDescriptorCount);
+      runtimeArray = true;
+    } else {
+      bindingFlags.push_back({});
+    }
+  }
+
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+  bindingFlagsInfo.setBindingFlags(bindingFlags);
+  vk::DescriptorSetLayoutCreateInfo setInfo;
+  setInfo.setBindings(layoutBindings);
+  if (runtimeArray) {
+    setInfo.setFlags(
+        vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool);
+    setInfo.setPNext(&bindingFlagsInfo);
+  }
+  vk::DescriptorSetLayout layout = m_device.createDescriptorSetLayout(setInfo);
+  m_setLayouts.emplace(std::move(key), layout);
+  return layout;
+}
+
+vk::PipelineLayout LayoutCache::pipeline_layout(
+    const std::vector<vk::DescriptorSetLayout> &setLayouts,
+    const std::vector<vk::PushConstantRange> &pushConstants) {
+  std::string key;
+  for (vk::DescriptorSetLayout setLayout : setLayouts) {
+    append_key(key, VkDescriptorSetLayout(setLayout));
+  }
+  for (const vk::PushConstantRange &range : pushConstants) {
+    append_key(key, range.stageFlags);
+    append_key(key, range.offset);
+    append_key(key, range.size);
+  }
+  auto it = m_pipelineLayouts.find(key);
+  if (it != m_pipelineLayouts.end()) {
+    return it->second;
+  }
+
+  vk::PipelineLayoutCreateInfo layoutInfo;
+  layoutInfo.setSetLayouts(setLayouts);
+  layoutInfo.setPushConstantRanges(pushConstants);
+  vk::PipelineLayout layout = m_device.createPipelineLayout(layoutInfo);
+  m_pipelineLayouts.emplace(std::move(key), layout);
+  return layout;
+}
+
+vk::PipelineLayout
+LayoutCache::pipeline_layout(const ShaderReflection &reflection) {
+  std::vector<vk::DescriptorSetLayout> setLayouts;
+  for (const auto &[set, bindings] : reflection.sets) {
+    while (setLayouts.size() < set) {
+      setLayouts.push_back(set_layout({}));
+    }
+    setLayouts.push_back(set_layout(bindings));
+  }
+  return pipeline_layout(setLayouts, reflection.push_constant_ranges());
+}
+
+} // namespace vkr
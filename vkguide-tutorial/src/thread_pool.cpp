@@ -0,0 +1,73 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace vkr {
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+  for (uint32_t i = 0; i < threadCount; i++) {
+    m_workers.emplace_back([this]() {
+      while (true) {
+        std::packaged_task<void()> task;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_condition.wait(lock,
+                           [this]() { return m_stopping || !m_tasks.empty(); });
+          if (m_stopping && m_tasks.empty()) {
+            return;
+          }
+          task = std::move(m_tasks.front());
+          m_tasks.pop_front();
+        }
+        task();
+      }
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_condition.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> &&task) {
+  std::packaged_task<void()> packaged(std::move(task));
+  std::future<void> future = packaged.get_future();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(std::move(packaged));
+  }
+  m_condition.notify_one();
+  return future;
+}
+
+void ThreadPool::parallel_for(
+    uint32_t count, const std::function<void(uint32_t, uint32_t)> &function) {
+  uint32_t chunks = std::min(std::max(size(), 1u), count);
+  if (chunks <= 1) {
+    function(0, count);
+    return;
+  }
+
+  std::vector<std::future<void>> futures;
+  futures.reserve(chunks - 1);
+  for (uint32_t i = 1; i < chunks; i++) {
+    uint32_t begin = count * i / chunks;
+    uint32_t end = count * (i + 1) / chunks;
+    futures.push_back(
+        submit([&function, begin, end]() { function(begin, end); }));
+  }
+  function(0, count / chunks);
+  // get() rethrows anything a worker threw
+  for (auto &future : futures) {
+    future.get();
+  }
+}
+
+} // namespace vkr
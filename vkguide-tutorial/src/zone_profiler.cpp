@@ -0,0 +1,173 @@
+#include "zone_profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+namespace vkr {
+
+namespace {
+
+int64_t to_ns(ZoneProfiler::Clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+      .count();
+}
+
+} // namespace
+
+ZoneProfiler &ZoneProfiler::instance() {
+  static ZoneProfiler profiler;
+  return profiler;
+}
+
+void ZoneProfiler::start() {
+  if (m_collector.joinable()) {
+    return;
+  }
+  m_stopping = false;
+  m_collector = std::thread([this]() { collect_loop(); });
+}
+
+void ZoneProfiler::stop() {
+  if (!m_collector.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_stopMutex);
+    m_stopping = true;
+  }
+  m_stopCondition.notify_one();
+  m_collector.join();
+}
+
+void ZoneProfiler::record(const char *name, Clock::time_point begin,
+                          Clock::time_point end) {
+  ZoneRing &ring = thread_ring();
+  uint64_t head = ring.head.load(std::memory_order_relaxed);
+  if (head - ring.tail.load(std::memory_order_acquire) >= RING_SIZE) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring.records[head % RING_SIZE] = {name, to_ns(begin - m_epoch),
+                                    to_ns(end - m_epoch)};
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+void ZoneProfiler::frame_mark(Clock::time_point now) {
+  if (++m_frames % FRAMES_PER_SUMMARY != 0) {
+    return;
+  }
+  m_windowEndNs.store(to_ns(now - m_epoch), std::memory_order_relaxed);
+  m_windowsClosed.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<ZoneSummary> ZoneProfiler::last_summary() {
+  std::lock_guard<std::mutex> lock(m_summaryMutex);
+  return m_summary;
+}
+
+ZoneProfiler::ZoneRing &ZoneProfiler::thread_ring() {
+  // rings outlive their threads, a late drain still finds the last zones
+  thread_local ZoneRing *ring = nullptr;
+  if (!ring) {
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    m_rings.push_back(std::make_unique<ZoneRing>());
+    ring = m_rings.back().get();
+  }
+  return *ring;
+}
+
+void ZoneProfiler::collect_loop() {
+  std::unique_lock<std::mutex> lock(m_stopMutex);
+  while (!m_stopping) {
+    m_stopCondition.wait_for(lock, std::chrono::milliseconds(5));
+    lock.unlock();
+
+    // before draining, so every zone published before the window closed is
+    // part of the drain
+    uint64_t closed = m_windowsClosed.load(std::memory_order_acquire);
+    int64_t windowEndNs = m_windowEndNs.load(std::memory_order_relaxed);
+    drain_rings();
+    if (closed > m_windowsSummarized) {
+      summarize(windowEndNs,
+                (closed - m_windowsSummarized) * FRAMES_PER_SUMMARY);
+      m_windowsSummarized = closed;
+    }
+
+    lock.lock();
+  }
+}
+
+void ZoneProfiler::drain_rings() {
+  std::lock_guard<std::mutex> lock(m_ringsMutex);
+  for (const auto &ring : m_rings) {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    for (; tail < head; tail++) {
+      m_pending.push_back(ring->records[tail % RING_SIZE]);
+    }
+    ring->tail.store(tail, std::memory_order_release);
+  }
+}
+
+void ZoneProfiler::summarize(int64_t windowEndNs, uint64_t frames) {
+  // zones still running at the end of the window count towards the next one
+  auto windowEnd = std::partition(
+      m_pending.begin(), m_pending.end(),
+      [&](const ZoneRecord &zone) { return zone.endNs <= windowEndNs; });
+
+  std::unordered_map<std::string_view, std::vector<double>> durations;
+  for (auto it = m_pending.begin(); it != windowEnd; it++) {
+    durations[it->name].push_back((it->endNs - it->beginNs) / 1e6);
+  }
+  m_pending.erase(m_pending.begin(), windowEnd);
+
+  std::vector<ZoneSummary> summary;
+  for (auto &[name, samples] : durations) {
+    std::sort(samples.begin(), samples.end());
+    // nearest rank
+    auto rank = [&](double p) {
+      size_t index = std::ceil(p * samples.size());
+      return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+    };
+    double total = 0.;
+    for (double sample : samples) {
+      total += sample;
+    }
+
+    ZoneSummary zone;
+    zone.name = name;
+    zone.mean = total / samples.size();
+    zone.p50 = rank(0.50);
+    zone.p99 = rank(0.99);
+    zone.callsPerFrame = double(samples.size()) / frames;
+    summary.push_back(zone);
+  }
+  std::sort(summary.begin(), summary.end(),
+            [](const ZoneSummary &a, const ZoneSummary &b) {
+              return a.mean * a.callsPerFrame > b.mean * b.callsPerFrame;
+            });
+
+  uint64_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for (const auto &ring : m_rings) {
+      dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+  }
+  spdlog::info("Cpu zones over {} frames{}", frames,
+               dropped > 0 ? fmt::format(", {} dropped", dropped) : "");
+  for (const ZoneSummary &zone : summary) {
+    spdlog::info("  {}: {:.3f}ms mean, {:.3f}ms p50, {:.3f}ms p99, {:.2f} "
+                 "calls per frame",
+                 zone.name, zone.mean, zone.p50, zone.p99, zone.callsPerFrame);
+  }
+
+  std::lock_guard<std::mutex> lock(m_summaryMutex);
+  m_summary = std::move(summary);
+}
+
+} // namespace vkr
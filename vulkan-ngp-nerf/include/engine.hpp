@@ -15,6 +15,7 @@
 #include "common_includes.h"
 #include <vulkan/vulkan.hpp>
 
+#include "event_log.hpp"
 #include "mesh.hpp"
 #include "textures.hpp"
 #include "types.hpp"
@@ -92,6 +93,11 @@ struct UploadContext {
 
 constexpr unsigned int FRAME_OVERLAP = 3;
 
+// event log categories for per frame paths, limits are events per second
+inline LogCategory LOG_INPUT{"input", 10};
+inline LogCategory LOG_CAMERA{"camera", 2};
+inline LogCategory LOG_NERF{"nerf", 2};
+
 class VulkanEngine {
 public:
   VulkanEngine();
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vkr {
+
+enum class LogLevel : uint8_t { Trace, Debug, Info, Warn, Error };
+
+// events of one category beyond maxPerSecond within a second are dropped and
+// counted, so a diagnostic in a per frame path can stay on without flooding
+// the log. categories register themselves and have to outlive the log, so
+// they are meant to be globals
+class LogCategory {
+public:
+  LogCategory(const char *name, uint32_t maxPerSecond);
+  LogCategory(const LogCategory &) = delete;
+  LogCategory &operator=(const LogCategory &) = delete;
+
+  const char *name() const { return m_name; }
+  // lock free, safe from any thread. the window restarts with the first
+  // event after it ends, so a burst is capped rather than smoothed
+  bool admit(int64_t nowNs);
+  uint64_t take_suppressed() {
+    return m_suppressed.exchange(0, std::memory_order_relaxed);
+  }
+
+private:
+  const char *m_name;
+  uint32_t m_maxPerSecond;
+  // timestamps count from the log's epoch, the first window starts with it
+  std::atomic<int64_t> m_windowStartNs = 0;
+  std::atomic<uint32_t> m_windowCount = 0;
+  std::atomic<uint64_t> m_suppressed = 0;
+};
+
+// one argument captured as is, strings are copied and cut at
+// STRING_SIZE - 1 bytes
+struct LogArg {
+  static constexpr size_t STRING_SIZE = 32;
+  enum class Type : uint8_t { Int, Uint, Double, Bool, String };
+
+  Type type = Type::Int;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+    bool b;
+    char s[STRING_SIZE];
+  };
+
+  LogArg() : i(0) {}
+
+  template <typename T> static LogArg capture(const T &value) {
+    LogArg arg;
+    if constexpr (std::is_same_v<T, bool>) {
+      arg.type = Type::Bool;
+      arg.b = value;
+    } else if constexpr (std::is_enum_v<T>) {
+      arg.type = Type::Int;
+      arg.i = int64_t(value);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      arg.type = Type::Int;
+      arg.i = value;
+    } else if constexpr (std::is_integral_v<T>) {
+      arg.type = Type::Uint;
+      arg.u = value;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      arg.type = Type::Double;
+      arg.d = value;
+    } else {
+      std::string_view view(value);
+      size_t size = std::min(view.size(), STRING_SIZE - 1);
+      arg.type = Type::String;
+      std::memcpy(arg.s, view.data(), size);
+      arg.s[size] = '\0';
+    }
+    return arg;
+  }
+};
+
+// binary structured log for hot paths. a call captures a format string
+// literal and its arguments unformatted into a per thread single producer
+// ring, registered on the thread's first event, and a background thread
+// formats them into spdlog with their original timestamps. without a running
+// log thread events are formatted on the calling thread instead
+class EventLog {
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr size_t MAX_ARGS = 8;
+  // per thread, events are dropped while the log thread is behind
+  static constexpr size_t RING_SIZE = 1 << 12;
+
+  static EventLog &instance();
+
+  void start();
+  // formats everything still queued
+  void stop();
+
+  // runtime floor on top of the compile time VKR_LOG_LEVEL, start() takes
+  // spdlog's
+  void set_level(LogLevel level) {
+    m_level.store(level, std::memory_order_relaxed);
+  }
+
+  // lock free, safe from any thread. format has to be a string literal
+  template <typename... Args>
+  void log(LogCategory &category, LogLevel level, const char *format,
+           const Args &...args) {
+    static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+    if (level < m_level.load(std::memory_order_relaxed)) {
+      return;
+    }
+    int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        Clock::now() - m_epoch)
+                        .count();
+    if (!category.admit(nowNs)) {
+      return;
+    }
+    Event event;
+    event.format = format;
+    event.category = &category;
+    event.timeNs = nowNs;
+    event.level = level;
+    event.argCount = sizeof...(Args);
+    [[maybe_unused]] size_t index = 0;
+    ((event.args[index++] = LogArg::capture(args)), ...);
+    push(event);
+  }
+
+  void add_category(LogCategory *category);
+
+private:
+  struct Event {
+    const char *format;
+    const LogCategory *category;
+    int64_t timeNs;
+    LogLevel level;
+    uint8_t argCount;
+    std::array<LogArg, MAX_ARGS> args;
+  };
+  struct EventRing {
+    std::array<Event, RING_SIZE> events;
+    // written by the owning thread only
+    std::atomic<uint64_t> head = 0;
+    // written by the log thread only
+    std::atomic<uint64_t> tail = 0;
+    std::atomic<uint64_t> dropped = 0;
+  };
+
+  void push(const Event &event);
+  EventRing &thread_ring();
+  void log_loop();
+  // formats what the rings hold in time order, on the log thread
+  void drain_rings();
+  void write(const Event &event);
+
+  Clock::time_point m_epoch = Clock::now();
+  std::chrono::system_clock::time_point m_systemEpoch =
+      std::chrono::system_clock::now();
+  std::atomic<LogLevel> m_level = LogLevel::Info;
+  std::atomic<bool> m_running = false;
+
+  // registration is the only locked part of logging, once per thread
+  std::mutex m_ringsMutex;
+  std::vector<std::unique_ptr<EventRing>> m_rings;
+  std::mutex m_categoriesMutex;
+  std::vector<LogCategory *> m_categories;
+
+  // log thread side
+  std::thread m_thread;
+  std::mutex m_stopMutex;
+  std::condition_variable m_stopCondition;
+  bool m_stopping = false;
+  std::vector<Event> m_pending;
+};
+
+} // namespace vkr
+
+// levels below VKR_LOG_LEVEL compile to nothing, their arguments are never
+// evaluated. 0 is trace, 4 error, cmake sets it from VKR_LOG_LEVEL
+#ifndef VKR_LOG_LEVEL
+#define VKR_LOG_LEVEL 1
+#endif
+
+#define VKR_LOG(level, category, ...)                                          \
+  do {                                                                         \
+    if constexpr (int(level) >= VKR_LOG_LEVEL) {                               \
+      ::vkr::EventLog::instance().log(category, level, __VA_ARGS__);           \
+    }                                                                          \
+  } while (0)
+#define VKR_LOG_TRACE(category, ...)                                           \
+  VKR_LOG(::vkr::LogLevel::Trace, category, __VA_ARGS__)
+#define VKR_LOG_DEBUG(category, ...)                                           \
+  VKR_LOG(::vkr::LogLevel::Debug, category, __VA_ARGS__)
+#define VKR_LOG_INFO(category, ...)                                            \
+  VKR_LOG(::vkr::LogLevel::Info, category, __VA_ARGS__)
+#define VKR_LOG_WARN(category, ...)                                            \
+  VKR_LOG(::vkr::LogLevel::Warn, category, __VA_ARGS__)
+#define VKR_LOG_ERROR(category, ...)                                           \
+  VKR_LOG(::vkr::LogLevel::Error, category, __VA_ARGS__)
@@ -7,7 +7,6 @@
 #include <SDL_vulkan.h>
 
 #include <glm/common.hpp>
-#include <glm/gtx/string_cast.hpp>
 
 #include "constants.h"
 #include "engine.hpp"
@@ -47,7 +46,8 @@ void VulkanEngine::run() {
       input_handle_keydown(sc);
     }
 
-    spdlog::info("glm viewmat:\n{}", glm::to_string(m_viewMatrix).c_str());
+    VKR_LOG_DEBUG(LOG_CAMERA, "View translation {} {} {}", m_viewMatrix[3][0],
+                  m_viewMatrix[3][1], m_viewMatrix[3][2]);
     update_scene();
     draw();
   }
@@ -71,6 +71,7 @@ void VulkanEngine::cleanup() {
   SDL_DestroyWindow(m_window);
 
   spdlog::info("Engine cleaned up");
+  EventLog::instance().stop();
 }
 
 } // namespace vkr
\ No newline at end of file
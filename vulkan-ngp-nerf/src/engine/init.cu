@@ -31,6 +31,7 @@ namespace vkr {
 VulkanEngine::VulkanEngine() {}
 
 void VulkanEngine::init() {
+  EventLog::instance().start();
   // We initialize SDL and create a window with it.
   SDL_Init(SDL_INIT_VIDEO);
 
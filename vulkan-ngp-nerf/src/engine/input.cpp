@@ -6,7 +6,7 @@
 
 namespace vkr {
 void VulkanEngine::input_handle_keydown(SDL_Scancode &key) {
-  spdlog::info("Keydown on key {}", key);
+  VKR_LOG_INFO(LOG_INPUT, "Keydown on key {}", key);
 
   float translateCameraSpeed = 0.1;
   glm::vec3 translateCameraDirection = glm::vec3(0.);
@@ -39,7 +39,7 @@ void VulkanEngine::input_handle_keydown(SDL_Scancode &key) {
 }
 
 void VulkanEngine::input_handle_keyup(SDL_Scancode &key) {
-  spdlog::info("Keyup on key {}", key);
+  VKR_LOG_INFO(LOG_INPUT, "Keyup on key {}", key);
 }
 
 } // namespace vkr
\ No newline at end of file
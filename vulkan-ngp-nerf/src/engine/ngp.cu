@@ -88,7 +88,7 @@ namespace vkr {
     // Eigen::Affine3f centerShift(-bbCenter);
     // camera_matrix = camera_matrix * centerShift.matrix();
     Eigen::Vector4f rolling_shutter = Eigen::Vector4f::Zero();
-    spdlog::info("Rendering nerf frame... ");
+    VKR_LOG_DEBUG(LOG_NERF, "Rendering nerf frame...");
     testbed.m_fov_axis=1;
     // testbed.m_zoom=1.f;
 	  testbed.m_screen_center = Eigen::Vector2f::Constant(0.5f);
@@ -98,7 +98,7 @@ namespace vkr {
       camera_matrix,
       rolling_shutter,
       *cudaRenderBuffer);
-    spdlog::info("Finished rendering nerf frame.");
+    VKR_LOG_DEBUG(LOG_NERF, "Finished rendering nerf frame.");
 
     engine.immediate_submit([&](vk::CommandBuffer cmd) {
       vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
@@ -0,0 +1,227 @@
+#include "event_log.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+#include <spdlog/spdlog.h>
+#ifdef SPDLOG_FMT_EXTERNAL
+#include <fmt/args.h>
+#else
+#include <spdlog/fmt/bundled/args.h>
+#endif
+
+namespace vkr {
+
+namespace {
+
+constexpr int64_t NS_PER_SECOND = 1000000000;
+
+spdlog::level::level_enum to_spdlog(LogLevel level) {
+  switch (level) {
+  case LogLevel::Trace:
+    return spdlog::level::trace;
+  case LogLevel::Debug:
+    return spdlog::level::debug;
+  case LogLevel::Info:
+    return spdlog::level::info;
+  case LogLevel::Warn:
+    return spdlog::level::warn;
+  case LogLevel::Error:
+    return spdlog::level::err;
+  }
+  return spdlog::level::info;
+}
+
+LogLevel from_spdlog(spdlog::level::level_enum level) {
+  switch (level) {
+  case spdlog::level::trace:
+    return LogLevel::Trace;
+  case spdlog::level::debug:
+    return LogLevel::Debug;
+  case spdlog::level::info:
+    return LogLevel::Info;
+  case spdlog::level::warn:
+    return LogLevel::Warn;
+  default:
+    return LogLevel::Error;
+  }
+}
+
+} // namespace
+
+LogCategory::LogCategory(const char *name, uint32_t maxPerSecond)
+    : m_name(name), m_maxPerSecond(maxPerSecond) {
+  EventLog::instance().add_category(this);
+}
+
+bool LogCategory::admit(int64_t nowNs) {
+  int64_t windowStart = m_windowStartNs.load(std::memory_order_relaxed);
+  // a timestamp taken before another thread restarted the window is older
+  // than the new start and must not restart it again
+  if (nowNs > windowStart &&
+      uint64_t(nowNs) - uint64_t(windowStart) >= uint64_t(NS_PER_SECOND) &&
+      m_windowStartNs.compare_exchange_strong(windowStart, nowNs,
+                                              std::memory_order_relaxed)) {
+    m_windowCount.store(0, std::memory_order_relaxed);
+  }
+  if (m_windowCount.fetch_add(1, std::memory_order_relaxed) >=
+      m_maxPerSecond) {
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+EventLog &EventLog::instance() {
+  static EventLog log;
+  return log;
+}
+
+void EventLog::start() {
+  if (m_thread.joinable()) {
+    return;
+  }
+  set_level(from_spdlog(spdlog::get_level()));
+  m_stopping = false;
+  m_thread = std::thread([this]() { log_loop(); });
+  m_running.store(true, std::memory_order_release);
+}
+
+void EventLog::stop() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  m_running.store(false, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(m_stopMutex);
+    m_stopping = true;
+  }
+  m_stopCondition.notify_one();
+  m_thread.join();
+}
+
+void EventLog::add_category(LogCategory *category) {
+  std::lock_guard<std::mutex> lock(m_categoriesMutex);
+  m_categories.push_back(category);
+}
+
+void EventLog::push(const Event &event) {
+  if (!m_running.load(std::memory_order_acquire)) {
+    write(event);
+    return;
+  }
+  EventRing &ring = thread_ring();
+  uint64_t head = ring.head.load(std::memory_order_relaxed);
+  if (head - ring.tail.load(std::memory_order_acquire) >= RING_SIZE) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring.events[head % RING_SIZE] = event;
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+EventLog::EventRing &EventLog::thread_ring() {
+  // rings outlive their threads, a late drain still finds the last events
+  thread_local EventRing *ring = nullptr;
+  if (!ring) {
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    m_rings.push_back(std::make_unique<EventRing>());
+    ring = m_rings.back().get();
+  }
+  return *ring;
+}
+
+void EventLog::log_loop() {
+  std::unique_lock<std::mutex> lock(m_stopMutex);
+  while (!m_stopping) {
+    m_stopCondition.wait_for(lock, std::chrono::milliseconds(2));
+    lock.unlock();
+    drain_rings();
+    lock.lock();
+  }
+  // a thread that saw m_running before stop() cleared it may still publish,
+  // the final drain is best effort for those
+  lock.unlock();
+  drain_rings();
+}
+
+void EventLog::drain_rings() {
+  uint64_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for (const auto &ring : m_rings) {
+      uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+      uint64_t head = ring->head.load(std::memory_order_acquire);
+      for (; tail < head; tail++) {
+        m_pending.push_back(ring->events[tail % RING_SIZE]);
+      }
+      ring->tail.store(tail, std::memory_order_release);
+      dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+  }
+
+  // every ring is in order on its own, interleave them by capture time
+  std::stable_sort(m_pending.begin(), m_pending.end(),
+                   [](const Event &a, const Event &b) {
+                     return a.timeNs < b.timeNs;
+                   });
+  for (const Event &event : m_pending) {
+    write(event);
+  }
+  m_pending.clear();
+
+  if (dropped > 0) {
+    spdlog::warn("Event log fell behind, dropped {} events", dropped);
+  }
+  std::lock_guard<std::mutex> lock(m_categoriesMutex);
+  for (LogCategory *category : m_categories) {
+    uint64_t suppressed = category->take_suppressed();
+    if (suppressed > 0) {
+      spdlog::info("[{}] {} events over the rate limit suppressed",
+                   category->name(), suppressed);
+    }
+  }
+}
+
+void EventLog::write(const Event &event) {
+  fmt::dynamic_format_arg_store<fmt::format_context> store;
+  for (uint8_t i = 0; i < event.argCount; i++) {
+    const LogArg &arg = event.args[i];
+    switch (arg.type) {
+    case LogArg::Type::Int:
+      store.push_back(arg.i);
+      break;
+    case LogArg::Type::Uint:
+      store.push_back(arg.u);
+      break;
+    case LogArg::Type::Double:
+      store.push_back(arg.d);
+      break;
+    case LogArg::Type::Bool:
+      store.push_back(arg.b);
+      break;
+    case LogArg::Type::String:
+      store.push_back(std::string_view(arg.s));
+      break;
+    }
+  }
+
+  std::string message = fmt::format("[{}] ", event.category->name());
+  size_t prefixSize = message.size();
+  try {
+    fmt::vformat_to(std::back_inserter(message), event.format, store);
+  } catch (const fmt::format_error &error) {
+    message.resize(prefixSize);
+    fmt::format_to(std::back_inserter(message), "{} (bad format: {})",
+                   event.format, error.what());
+  }
+
+  auto time = m_systemEpoch +
+              std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                  std::chrono::nanoseconds(event.timeNs));
+  spdlog::default_logger_raw()->log(time, spdlog::source_loc{},
+                                    to_spdlog(event.level), message);
+}
+
+} // namespace vkr